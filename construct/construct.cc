@@ -35,6 +35,7 @@ bool no6;
 bool yes6;
 bool norun;
 bool read_only;
+bool secondary;
 bool write_avoid;
 std::array<bool, 7> smoketest;
 bool soft_assert;
@@ -66,6 +67,7 @@ lgetopt opts[]
 	{ "norun",      &norun,         lgetopt::BOOL,    "[debug & testing only] Initialize but never run the event loop" },
 	{ "ro",         &read_only,     lgetopt::BOOL,    "Read-only mode. No writes to database allowed" },
 	{ "wa",         &write_avoid,   lgetopt::BOOL,    "Like read-only mode, but writes permitted if triggered" },
+	{ "secondary",  &secondary,     lgetopt::BOOL,    "Read-only mode following a running primary's database" },
 	{ "smoketest",  &smoketest[0],  lgetopt::BOOL,    "Starts and stops the daemon to return success" },
 	{ "sassert",    &soft_assert,   lgetopt::BOOL,    "Softens assertion effects in debug mode" },
 	{ "nomatrix",   &nomatrix,      lgetopt::BOOL,    "Prevent loading the matrix application module" },
@@ -476,7 +478,11 @@ applyargs()
 	if(defaults)
 		ircd::defaults.set("true");
 
-	if(read_only)
+	if(secondary)
+		ircd::secondary.set("true");
+
+	// secondary implies read_only.
+	if(read_only || secondary)
 		ircd::read_only.set("true");
 
 	// read_only implies write_avoid.
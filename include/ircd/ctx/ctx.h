@@ -52,6 +52,7 @@ namespace ircd::ctx
 	const ulong &cycles(const ctx &) noexcept;      // Accumulated tsc (not counting cur slice)
 	const int8_t &ionice(const ctx &) noexcept;     // IO priority nice-value
 	const int8_t &nice(const ctx &) noexcept;       // Scheduling priority nice-value
+	const ulong &budget(const ctx &) noexcept;      // CPU budget (tsc per period; 0 = none)
 	bool interruptible(const ctx &) noexcept;       // Context can throw at interruption point
 	bool interruption(const ctx &) noexcept;        // Context was marked for interruption
 	bool termination(const ctx &) noexcept;         // Context was marked for termination
@@ -63,6 +64,7 @@ namespace ircd::ctx
 
 	int8_t ionice(ctx &, const int8_t &);           // IO priority nice-value
 	int8_t nice(ctx &, const int8_t &);             // Scheduling priority nice-value
+	ulong budget(ctx &, const ulong &);             // CPU budget (tsc per period; 0 = none)
 	void interruptible(ctx &, const bool &);        // False for interrupt suppression.
 	void interrupt(ctx &);                          // Interrupt the context.
 	void terminate(ctx &);                          // Interrupt for termination.
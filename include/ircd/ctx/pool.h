@@ -31,6 +31,7 @@ struct ircd::ctx::pool
 	const opts *opt {&default_opts};
 	size_t running {0};
 	size_t working {0};
+	prof::budget budget;
 	dock q_max;
 	queue<closure> q;
 	std::vector<context> ctxs;
@@ -114,6 +115,10 @@ struct ircd::ctx::pool::opts
 
 	/// Scheduler priority nice value for contexts in this pool.
 	int8_t nice {0};
+
+	/// CPU budget shared by all contexts in this pool, in tsc cycles per
+	/// prof::settings::budget_period. Default is 0, unlimited.
+	ulong budget {0};
 };
 
 template<class F,
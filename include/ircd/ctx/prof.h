@@ -31,6 +31,8 @@ namespace ircd::ctx::prof
 {
 	enum class event :uint8_t;
 	struct ticker;
+	struct budget;
+	struct sched;
 
 	ulong cycles() noexcept;
 	string_view reflect(const event &);
@@ -47,6 +49,11 @@ namespace ircd::ctx::prof
 	const ulong &cur_slice_start() noexcept;
 	ulong cur_slice_cycles() noexcept;
 
+	// scheduling priority classes
+	uint sched_class(const ctx &) noexcept;
+	const sched &get_sched(const uint &sched_class);
+	bool budget_exceeded(const budget &) noexcept;
+
 	// test accessors
 	bool slice_exceeded_warning(const ulong &cycles) noexcept;
 	bool slice_exceeded_assertion(const ulong &cycles) noexcept;
@@ -63,6 +70,10 @@ namespace ircd::ctx::prof::settings
 	extern conf::item<ulong> slice_warning;     // Warn when the yield-to-yield cycles exceeds
 	extern conf::item<ulong> slice_interrupt;   // Interrupt exception when exceeded (not a signal)
 	extern conf::item<ulong> slice_assertion;   // abort() when exceeded (not a signal, must yield)
+
+	extern conf::item<bool> sched_enable;               // Defer lower classes behind higher
+	extern conf::item<size_t> sched_defer_max;          // Deferrals of one resumption
+	extern conf::item<milliseconds> budget_period;      // Period CPU budgets are counted over
 }
 
 /// Profiling events for marking. These are currently used internally at the
@@ -85,6 +96,35 @@ enum class ircd::ctx::prof::event
 	_NUM_
 };
 
+/// CPU budget for a context, or shared by the contexts of a pool. The
+/// cycles of each execution slice are charged when the slice ends; once the
+/// limit for the current period is reached the context is deferred at its
+/// next yield point until the period rolls over.
+struct ircd::ctx::prof::budget
+{
+	ulong limit {0};                   // tsc cycles per period; 0 is unlimited
+	ulong used {0};                    // tsc cycles used in the current period
+	ulong period {0};                  // the current period
+	ulong throttled {0};               // times a context was deferred over budget
+};
+
+/// Scheduling statistics for one priority class. A context with a negative
+/// nice-value is in the high class (0), zero is normal (1) and positive is
+/// low (2). A context of a lower class resuming while a higher class has
+/// contexts queued requeues itself behind them.
+struct ircd::ctx::prof::sched
+{
+	static constexpr size_t CLASSES {3};
+	static constexpr size_t BUCKETS {6};
+	static const std::array<microseconds, BUCKETS> bucket;
+
+	std::array<uint64_t, BUCKETS> delay {{0}}; // histogram of time queued to resumed
+	uint64_t queued {0};                       // contexts queued and not yet resumed
+	uint64_t resumed {0};                      // resumptions after being queued
+	uint64_t deferred {0};                     // resumptions deferred behind higher class
+	uint64_t throttled {0};                    // resumptions deferred over budget
+};
+
 /// structure aggregating any profiling related state for a ctx
 struct ircd::ctx::prof::ticker
 {
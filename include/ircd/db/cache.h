@@ -21,10 +21,19 @@
 
 namespace ircd::db
 {
+	struct cache_admission;
+
 	// Get our stats; refer to db/stats.h for ticker ID related.
 	const uint64_t &ticker(const rocksdb::Cache &, const uint32_t &ticker_id);
 	uint64_t ticker(const rocksdb::Cache *const &, const uint32_t &ticker_id);
 
+	// Get the admission policy stats; zero'ed if the cache has no policy.
+	cache_admission admission(const rocksdb::Cache &);
+	cache_admission admission(const rocksdb::Cache *const &);
+
+	// Self-test of the admission policy on a scratch cache; false on failure.
+	bool cache_check();
+
 	// Get capacity
 	size_t capacity(const rocksdb::Cache &);
 	size_t capacity(const rocksdb::Cache *const &);
@@ -71,6 +80,16 @@ namespace ircd::db
 	void clear(rocksdb::Cache *const &);
 }
 
+/// Counters for the frequency-sketch admission policy of a cache; see
+/// descriptor::cache_admit.
+struct ircd::db::cache_admission
+{
+	uint64_t admit {0};                ///< Entries allowed into the cache
+	uint64_t reject {0};               ///< Entries served without caching
+	uint64_t promote {0};              ///< Entries admitted at high priority
+	uint64_t aging {0};                ///< Times the sketch was decayed
+};
+
 inline void
 ircd::db::clear(rocksdb::Cache *const &cache)
 {
@@ -176,3 +195,11 @@ ircd::db::ticker(const rocksdb::Cache *const &cache,
 		ticker(*cache, ticker_id):
 		0UL;
 }
+
+inline ircd::db::cache_admission
+ircd::db::admission(const rocksdb::Cache *const &cache)
+{
+	return cache?
+		admission(*cache):
+		cache_admission{};
+}
@@ -60,6 +60,8 @@ namespace ircd::db
 	void sort(database &, const bool &blocking = true, const bool &now = true);
 	void flush(database &, const bool &sync = false);
 	void sync(database &);
+	bool refresh(database &);
+	size_t refresh();
 }
 
 /// Database instance
@@ -104,7 +106,7 @@ struct ircd::db::database
 	uint64_t checkpoint;
 	std::string path;
 	std::string optstr;
-	bool fsck, read_only;
+	bool fsck, read_only, secondary;
 	std::shared_ptr<struct env> env;
 	std::shared_ptr<struct stats> stats;
 	std::shared_ptr<struct logger> logger;
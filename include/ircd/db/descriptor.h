@@ -118,4 +118,12 @@ struct ircd::db::descriptor
 		{      0L,  15L }, // max_bytes_for_level[5]
 		{      0L,  31L }, // max_bytes_for_level[6]
 	};
+
+	/// Admission policy for the uncompressed block cache. When true, a
+	/// frequency sketch of recent block accesses decides if a new block may
+	/// displace resident blocks once the cache is full; blocks which fail
+	/// are served to the reader without being cached. Blocks seen often are
+	/// inserted into the cache's high-priority segment. This makes the cache
+	/// resistant to being flushed by one-off scans over the column.
+	bool cache_admit { false };
 };
@@ -22,16 +22,36 @@ struct ircd::db::prefetcher
 	struct request;
 	using closure = std::function<bool (request &)>;
 
+	/// Priority classes. Requests are dispatched from the queue in class
+	/// order; within a class they are dispatched in arrival order. Only the
+	/// INTERACTIVE class is exempt from the concurrency window and expiration.
+	enum prio :uint8_t
+	{
+		INTERACTIVE,       ///< Latency-critical; gopts w/ get::PRIO_HIGH
+		BACKGROUND,        ///< Default speculative prefetching.
+		BULK,              ///< Large scans; gopts w/ get::PRIO_LOW
+		_NUM_
+	};
+
+	static conf::item<seconds> ttl_background;
+	static conf::item<seconds> ttl_bulk;
+	static conf::item<microseconds> latency_target;
+	static conf::item<size_t> queue_depth_max;
+
 	ctx::dock dock;
 	std::deque<request> queue;
 	std::unique_ptr<ticker> ticker;
 	ctx::context context;
 	size_t request_workers {0};
+	size_t concurrency {1};
 
 	size_t wait_pending();
+	size_t request_expire() noexcept;
+	void request_adapt() noexcept;
 	void request_handle(request &);
 	size_t request_cleanup() noexcept;
 	void request_worker();
+	bool wouldblock(const prio &) const noexcept;
 	void handle();
 	void worker();
 
@@ -56,11 +76,12 @@ struct ircd::db::prefetcher::request
 	steady_point snd;                  // submitted by user
 	steady_point req;                  // request sent to database
 	steady_point fin;                  // result from database
+	enum prio prio {BACKGROUND};       // priority class
 	key_buf key alignas(16);           // key buffer
 
 	explicit operator string_view() const noexcept;
 
-	request(database &d, const column &c, const string_view &key) noexcept;
+	request(database &d, const column &c, const string_view &key, const enum prio &) noexcept;
 	request() = default;
 };
 
@@ -94,4 +115,13 @@ struct ircd::db::prefetcher::ticker
 	// accumulated latency totals
 	microseconds accum_snd_req {0us};
 	microseconds accum_req_fin {0us};
+
+	// moving average of database operation latency
+	microseconds avg_req_fin {0us};
+
+	// per priority class; indexed by prefetcher::prio
+	size_t class_request[prio::_NUM_] {0};  ///< Requests added to the queue
+	size_t class_fetched[prio::_NUM_] {0};  ///< Requests completed
+	size_t class_expired[prio::_NUM_] {0};  ///< Stale requests canceled
+	microseconds class_accum_snd_fin[prio::_NUM_] {0us}; ///< Total latency
 };
@@ -26,6 +26,9 @@ namespace ircd::db
 	void for_each(database &d, const uint64_t &seq, const seq_closure &);
 	void get(database &d, const uint64_t &seq, const seq_closure &);
 	std::string debug(const txn &);
+
+	// Write the txn as external SST files and ingest instead of committing.
+	void ingest(const txn &, const string_view &dir = {});
 }
 
 struct ircd::db::txn
@@ -102,6 +102,8 @@ struct ircd::ios::descriptor
 
 	static void *default_allocator(handler &, const size_t &);
 	static void default_deallocator(handler &, void *const &, const size_t &) noexcept;
+	static void *pool_allocator(handler &, const size_t &);
+	static void pool_deallocator(handler &, void *const &, const size_t &) noexcept;
 
 	string_view name;
 	uint64_t id {++ids};
@@ -129,6 +131,7 @@ struct ircd::ios::descriptor::stats
 	uint64_t alloc_bytes{0};
 	uint64_t frees {0};
 	uint64_t free_bytes{0};
+	uint64_t pool_hits {0};
 	uint64_t slice_total {0};
 	uint64_t slice_last {0};
 	uint64_t latency_total {0};
@@ -82,6 +82,7 @@
 #include "http2/http2.h"
 #include "conf.h"
 #include "magic.h"
+#include "lz4.h"
 #include "stats.h"
 #include "prof/prof.h"
 #include "fs/fs.h"
@@ -109,6 +110,7 @@ namespace ircd
 	extern conf::item<bool> restart;
 	extern conf::item<bool> debugmode;
 	extern conf::item<bool> read_only;
+	extern conf::item<bool> secondary;
 	extern conf::item<bool> write_avoid;
 	extern conf::item<bool> soft_assert;
 	extern conf::item<bool> defaults;
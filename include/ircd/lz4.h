@@ -0,0 +1,23 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_LZ4_H
+
+/// LZ4 block compression. When built without liblz4, compress() returns an
+/// empty buffer and the input is expected to be kept as it is.
+namespace ircd::lz4
+{
+	IRCD_EXCEPTION(ircd::error, error)
+
+	size_t compress_bound(const size_t &) noexcept;
+	const_buffer compress(const mutable_buffer &out, const const_buffer &in) noexcept;
+	const_buffer decompress(const mutable_buffer &out, const const_buffer &in);
+}
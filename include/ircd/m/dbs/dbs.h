@@ -55,8 +55,11 @@ namespace ircd::m::dbs::appendix
 #include "room_type.h"              // room_id | type, depth, event_idx
 #include "room_state.h"             // room_id | type, state_key => event_idx
 #include "room_state_space.h"       // room_id | type, state_key, depth, event_idx
+#include "room_state_snapshot.h"    // room_id | depth => state
 #include "room_joined.h"            // room_id | origin, member => event_idx
 #include "room_head.h"              // room_id | event_id => event_idx
+#include "user_mitsein.h"           // user_id | other_id => count
+#include "room_member_count.h"      // room_id | membership, host => count
 
 /// Options that affect the dbs::write() of an event to the transaction.
 struct ircd::m::dbs::write_opts
@@ -186,6 +189,15 @@ enum ircd::m::dbs::appendix::index
 
 	/// Take branch to handle room redaction events.
 	ROOM_REDACT,
+
+	/// Involves user_mitsein table; maintained along with room_joined.
+	USER_MITSEIN,
+
+	/// Involves room_member_count table; maintained along with room_joined.
+	ROOM_MEMBER_COUNT,
+
+	/// Involves room_state_snapshot table; maintained along with room_space.
+	ROOM_STATE_SNAPSHOT,
 };
 
 struct ircd::m::dbs::init
@@ -202,4 +214,6 @@ struct ircd::m::dbs::init
 namespace ircd::m::dbs
 {
 	event::idx find_event_idx(const event::id &, const write_opts &);
+	event::idx find_state_idx(const id::room &, const string_view &type, const string_view &state_key, const write_opts &);
+	bool find_pending(const db::txn &, const string_view &col, const string_view &key, string_view &val);
 }
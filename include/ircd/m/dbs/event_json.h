@@ -26,5 +26,6 @@ namespace ircd::m::dbs::desc
 	extern conf::item<size_t> event_json__cache__size;
 	extern conf::item<size_t> event_json__cache_comp__size;
 	extern conf::item<size_t> event_json__bloom__bits;
+	extern conf::item<bool> event_json__cache__admit;
 	extern const db::descriptor event_json;
 }
@@ -0,0 +1,47 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_M_DBS_ROOM_MEMBER_COUNT_H
+
+namespace ircd::m::dbs
+{
+	constexpr size_t ROOM_MEMBER_COUNT_KEY_MAX_SIZE
+	{
+		id::MAX_SIZE + 1 + 32 + 1 + event::ORIGIN_MAX_SIZE
+	};
+
+	string_view room_member_count_key(const mutable_buffer &out, const id::room &, const string_view &membership, const string_view &host);
+	string_view room_member_count_key(const mutable_buffer &out, const id::room &, const string_view &membership);
+	string_view room_member_count_key(const mutable_buffer &out, const id::room &);
+	std::tuple<string_view, string_view> room_member_count_key(const string_view &amalgam);
+	bool room_member_count_get(const id::room &, const string_view &membership, const string_view &host, size_t &count);
+	bool room_member_count_built();
+	void room_member_count_built(db::txn &, const bool &);
+
+	void _index_room_member_count(db::txn &, const event &, const write_opts &);
+	void _index_room_member_count(db::txn &, const write_opts &, const id::room &, const string_view &membership, const string_view &host, const int64_t &delta);
+
+	// room_id | membership => count
+	// room_id | membership, host => count
+	// \0 => (marker that the index is complete)
+	extern db::domain room_member_count;
+}
+
+namespace ircd::m::dbs::desc
+{
+	extern conf::item<size_t> room_member_count__block__size;
+	extern conf::item<size_t> room_member_count__meta_block__size;
+	extern conf::item<size_t> room_member_count__cache__size;
+	extern conf::item<size_t> room_member_count__cache_comp__size;
+	extern conf::item<size_t> room_member_count__bloom__bits;
+	extern const db::prefix_transform room_member_count__pfx;
+	extern const db::descriptor room_member_count;
+}
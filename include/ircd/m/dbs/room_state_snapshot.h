@@ -0,0 +1,49 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_M_DBS_ROOM_STATE_SNAPSHOT_H
+
+namespace ircd::m::dbs
+{
+	constexpr size_t ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE
+	{
+		id::MAX_SIZE + 1 + sizeof(int64_t)
+	};
+
+	using room_state_snapshot_closure = std::function<void (const string_view &, const string_view &, const int64_t &, const event::idx &)>;
+
+	string_view room_state_snapshot_key(const mutable_buffer &out, const id::room &, const int64_t &depth);
+	string_view room_state_snapshot_key(const mutable_buffer &out, const id::room &);
+	int64_t room_state_snapshot_key(const string_view &amalgam);
+
+	std::pair<int64_t, uint64_t> room_state_snapshot_find(const id::room &, const int64_t &below = -1);
+	bool room_state_snapshot_for_each(const id::room &, const int64_t &depth, const int64_t &until, const room_state_snapshot_closure &);
+	void room_state_snapshot_clear(db::txn &, const id::room &);
+	bool room_state_snapshot_make(const id::room &);
+
+	void _index_room_state_snapshot(db::txn &, const event &, const write_opts &);
+
+	// room_id | depth => { seq, base, state: [[type, state_key, depth, event_idx]] }
+	// room_id => count of state changes since the last snapshot
+	extern db::domain room_state_snapshot;
+	extern conf::item<size_t> room_state_snapshot_interval;
+}
+
+namespace ircd::m::dbs::desc
+{
+	extern conf::item<size_t> room_state_snapshot__block__size;
+	extern conf::item<size_t> room_state_snapshot__meta_block__size;
+	extern conf::item<size_t> room_state_snapshot__cache__size;
+	extern conf::item<size_t> room_state_snapshot__cache_comp__size;
+	extern conf::item<size_t> room_state_snapshot__bloom__bits;
+	extern const db::prefix_transform room_state_snapshot__pfx;
+	extern const db::descriptor room_state_snapshot;
+}
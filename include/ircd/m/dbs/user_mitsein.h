@@ -0,0 +1,47 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#pragma once
+#define HAVE_IRCD_M_DBS_USER_MITSEIN_H
+
+namespace ircd::m::dbs
+{
+	constexpr size_t USER_MITSEIN_KEY_MAX_SIZE
+	{
+		id::MAX_SIZE + 1 + id::MAX_SIZE
+	};
+
+	string_view user_mitsein_key(const mutable_buffer &out, const id::user &, const id::user &other);
+	string_view user_mitsein_key(const mutable_buffer &out, const id::user &);
+	string_view user_mitsein_key(const string_view &amalgam);
+	string_view user_mitsein_room_key(const mutable_buffer &out, const id::room &);
+	bool user_mitsein_large(const id::room &);
+	bool user_mitsein_built();
+	void user_mitsein_built(db::txn &, const bool &);
+
+	void _index_user_mitsein(db::txn &, const event &, const write_opts &);
+
+	// user_id | other_id => count of common rooms
+	// \0 room_id => (marker for a room too large to be indexed)
+	// \0 => (marker that the index is complete)
+	extern db::domain user_mitsein;
+	extern conf::item<size_t> user_mitsein_room_max;
+}
+
+namespace ircd::m::dbs::desc
+{
+	extern conf::item<size_t> user_mitsein__block__size;
+	extern conf::item<size_t> user_mitsein__meta_block__size;
+	extern conf::item<size_t> user_mitsein__cache__size;
+	extern conf::item<size_t> user_mitsein__cache_comp__size;
+	extern conf::item<size_t> user_mitsein__bloom__bits;
+	extern const db::prefix_transform user_mitsein__pfx;
+	extern const db::descriptor user_mitsein;
+}
@@ -32,6 +32,8 @@ struct ircd::m::event::append
 	append(json::stack::object &, const event &);
 	append(json::stack::array &, const event &, const opts &);
 	append(json::stack::array &, const event &);
+
+	static void members(json::stack::object &, const event &, const opts &);
 };
 
 /// Provide as much information as you can apropos this event so the impl
@@ -44,6 +46,7 @@ struct ircd::m::event::append::opts
 	const room *user_room {nullptr};
 	const int64_t *room_depth {nullptr};
 	const event::keys *keys {nullptr};
+	const json::object *rendered {nullptr}; // output of members() to splice
 	long age {std::numeric_limits<long>::min()};
 	bool query_txnid {true};
 	bool query_prev_state {true};
@@ -47,6 +47,7 @@ struct ircd::m::event::fetch
 	using view_closure = std::function<void (const string_view &)>;
 
 	static const opts default_opts;
+	static const opts interactive_opts;
 
 	const opts *fopts {&default_opts};
 	idx event_idx {0};
@@ -14,6 +14,8 @@
 namespace ircd::m::events
 {
 	struct range;
+	struct rebuilder;
+	struct import;
 	using closure = std::function<bool (const event::idx &, const event &)>;
 
 	// Iterate viable event indexes in a range
@@ -84,6 +86,143 @@ namespace ircd::m::events::state
 	bool for_each(const closure &);
 }
 
+/// Parallel rebuild engine for indexes derived from each event. The range of
+/// event::idx is partitioned and the partitions are processed concurrently on
+/// a pool of contexts. Each partition scans its slice of the event column in
+/// order and writes through its own db::txn, which is committed whenever it
+/// grows past the configured size. When a name is given, progress is saved
+/// in the server's room as the lowest event::idx below which every partition
+/// has completed; a later rebuild with the same name resumes from there. A
+/// partition with any failed event is not considered complete, so the saved
+/// progress never advances past it.
+///
+/// The closure is called for each event; it appends its writes to the txn.
+/// It may be called concurrently for different partitions.
+///
+struct ircd::m::events::rebuilder
+{
+	struct opts;
+	using closure = std::function<void (db::txn &, const event::idx &, const event &)>;
+
+	static conf::item<size_t> partition_size;
+	static conf::item<size_t> pool_size;
+	static conf::item<size_t> txn_max;
+	static conf::item<seconds> checkpoint_interval;
+
+	const struct opts &opts;
+	closure handler;
+	event::idx_range range;
+	size_t partition_events {0};
+	std::vector<bool> done;
+	size_t watermark {0};
+	size_t events {0};
+	size_t errors {0};
+	size_t commits {0};
+	size_t bytes {0};
+	steady_point started;
+	steady_point checkpointed;
+
+  private:
+	event::idx checkpoint_get() const;
+	void checkpoint_set(const event::idx &) const;
+	void checkpoint(const bool &force = false);
+	void partition(const size_t &);
+
+  public:
+	rebuilder(const struct opts &, closure);
+};
+
+struct ircd::m::events::rebuilder::opts
+{
+	/// Name under which progress is saved; no checkpoints if empty.
+	string_view name;
+
+	/// Range of events to process.
+	event::idx_range range {0UL, -1UL};
+
+	/// When given, only these events (ascending) are processed by point
+	/// lookups rather than scanning the event column; the range and the
+	/// saved progress are then offsets into this list.
+	vector_view<const event::idx> events;
+
+	/// Resume from a previous checkpoint under this name.
+	bool resume {true};
+
+	/// Override conf items when non-zero.
+	size_t partition_size {0};
+	size_t pool_size {0};
+};
+
+/// Offline bulk loader for an event dump (see dump__file()). Rather than an
+/// eval and a db::txn commit for each event, events are gathered into large
+/// batches and every index is computed for the whole batch; each batch is
+/// then written out as sorted SST files and ingested directly, bypassing the
+/// memtable and WAL. Each batch is ingested in two phases: the event_idx and
+/// event columns first, then every other index, so references among events
+/// in the same batch resolve without any eval ordering.
+///
+/// This is not an eval; no access or auth checks are made. It must not run
+/// while the vm is evaluating events because it assigns event::idx itself.
+///
+struct ircd::m::events::import
+{
+	struct opts;
+	enum verify :uint8_t;
+
+	static conf::item<size_t> batch_max;
+	static conf::item<size_t> buffer_size;
+
+	const struct opts &opts;
+	event::idx_range range;
+	size_t events {0};
+	size_t skipped {0};
+	size_t errors {0};
+	size_t batches {0};
+	size_t bytes {0};
+	steady_point started;
+
+  private:
+	bool check(const event &);
+	void rollback(const db::txn &);
+	void flush(const std::vector<std::string> &);
+
+  public:
+	import(const string_view &filename, const struct opts &);
+};
+
+/// Level of verification for imported events. Each level includes those
+/// before it.
+enum ircd::m::events::import::verify
+:uint8_t
+{
+	NONE,            ///< Trust the dump entirely.
+	CONFORMS,        ///< Require a clean conformity report.
+	EVENT_ID,        ///< Require the event_id matches the event content.
+	SIGNATURES,      ///< Verify the origin's signature (may fetch keys).
+};
+
+struct ircd::m::events::import::opts
+{
+	/// Verification level; see enum.
+	enum verify verify {CONFORMS};
+
+	/// Skip events which fail verification rather than aborting.
+	bool errors_skip {true};
+
+	/// Skip events already in the database (checked by event_id).
+	bool exists_skip {true};
+
+	/// Store the dumped JSON as-is rather than re-stringifying. Output of
+	/// dump__file() is already canonical.
+	bool json_source {true};
+
+	/// Stop after this many events; 0 for all.
+	size_t limit {0};
+
+	/// Directory for the SST files; defaults under the database directory.
+	string_view dir;
+};
+
 /// Range to start (inclusive) and stop (exclusive). If start is greater than
 /// stop a reverse iteration will occur. -1 (or unsigned max value) can be used
 /// to start or stop at the end. 0 can be used to start or stop at the beginning.
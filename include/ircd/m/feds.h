@@ -21,9 +21,15 @@
 /// the interface function will return immediately and all pending requests will
 /// go out of scope and may be cancelled as per ircd::server decides.
 ///
+/// Servers are ordered by their health (loopback, then servers we are already
+/// linked to, then known servers, then the rest). A window can be set in the
+/// options to keep at most that many requests outstanding at any time; as
+/// each result arrives another request is launched in its place. A quorum can
+/// be set to complete an operation early after that many successful results.
+///
 /// Alternatively, m::fetch is another federation network interface much better
 /// suited to find-and-retrieve for a single piece of data (i.e an event). This
-/// interface unconditionally launches requests to every server in parallel, if
+/// interface requests every server in the room unless a quorum is set; if
 /// one server's response provides a satisfying result this method can be
 /// wasteful in comparison.
 ///
@@ -97,9 +103,9 @@ struct ircd::m::feds::opts
 	/// Operation type
 	enum op op {(enum op)0};
 
-	/// Timeout for this operation. For a batch of operations, this system
-	/// may attempt -- but does not guarantee -- to cancel timed-out requests
-	/// before the highest timeout value in the batch.
+	/// Timeout for each request of this operation, from when the request is
+	/// launched. Requests queued behind a window only start their timeout
+	/// once they are launched.
 	milliseconds timeout {20000L};
 
 	/// Apropos room_id: this is almost always required for this interface
@@ -143,6 +149,17 @@ struct ircd::m::feds::opts
 	/// typical use case.
 	bool exclude_myself {false};
 
+	/// Maximum number of requests outstanding at once for this operation.
+	/// Zero uses the configured default, which is unlimited unless set. For
+	/// a batch of operations the largest window in the batch applies to the
+	/// whole batch.
+	size_t concurrency {0};
+
+	/// Number of successful results after which this operation is complete;
+	/// the remaining requests are cancelled and never launched. Set to 1 for
+	/// first-success. Zero (the default) requests every server.
+	size_t quorum {0};
+
 	// Default construction is inline by member; this is defined to impose
 	// noexcept over `milliseconds timeout` which we guarantee won't throw.
 	opts() noexcept {}
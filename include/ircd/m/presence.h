@@ -35,9 +35,15 @@ struct ircd::m::presence
 {
 	using closure = std::function<void (const json::object &)>;
 	using closure_event = std::function<void (const m::event &)>;
+	using closure_change = std::function<bool (const id::user &, const event::idx &)>;
 
 	static bool valid_state(const string_view &state);
 
+	// Iterate the latest change for each user within the range from the
+	// in-memory change log. Returns false without iterating if the log does
+	// not cover the start of the range; otherwise returns the closure result.
+	static bool changes(const event::idx_range &, const closure_change &);
+
 	static event::idx get(std::nothrow_t, const user &);
 	static event::idx get(const user &);
 
@@ -48,6 +54,11 @@ struct ircd::m::presence
 	static event::id::buf set(const presence &);
 	static event::id::buf set(const user &, const string_view &, const string_view &status = {});
 
+	// Batched set; updates are coalesced per user and persisted periodically.
+	static void queue(const presence &);
+	static void queue(const user &, const string_view &, const string_view &status = {});
+	static size_t flush();
+
 	using edu::m_presence::m_presence;
 	presence(const user &, const mutable_buffer &);
 };
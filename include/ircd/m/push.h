@@ -18,6 +18,7 @@ namespace ircd::m::push
 	struct rules;
 	struct pusher;
 	struct match;
+	struct program;
 
 	IRCD_M_EXCEPTION(m::error, error, http::INTERNAL_SERVER_ERROR)
 	IRCD_M_EXCEPTION(error, NOT_A_RULE, http::BAD_REQUEST)
@@ -38,6 +39,7 @@ struct ircd::m::push::match
 :boolean
 {
 	struct opts;
+	struct cache;
 	using cond_kind_func = bool (*)(const event &, const cond &, const opts &);
 
 	static const string_view cond_kind_name[6];
@@ -50,6 +52,61 @@ struct ircd::m::push::match
 struct ircd::m::push::match::opts
 {
 	m::id::user user_id;
+
+	/// Optional per-event cache shared by every evaluation of the same event.
+	match::cache *cache {nullptr};
+};
+
+/// Values computed once per event and shared by every user's evaluation of
+/// that event. Conditions which do not depend on the user are memoized by
+/// their JSON so each unique condition is evaluated at most once per event;
+/// the user-independent result of each rule of a program is kept so users
+/// sharing a program only evaluate what depends on them. The programs are
+/// held here so none is freed and its address reused while the event is
+/// evaluated.
+struct ircd::m::push::match::cache
+{
+	long member_count {-1};
+	std::map<std::string, bool, std::less<>> cond;
+	std::map<std::shared_ptr<const program>, std::vector<bool>> viable;
+};
+
+/// Compiled ruleset. The enabled rules of a user are gathered once in the
+/// order they're evaluated (override, content, room, sender, underride) so
+/// matching is a linear scan without any queries. Programs are cached per
+/// user and invalidated when the user changes a rule; every user who has
+/// not set any rules of their own shares the program of the defaults.
+struct ircd::m::push::program
+:std::enable_shared_from_this<program>
+{
+	struct rule;
+
+	std::vector<rule> rules;
+	bool defaults {false};
+
+	static bool user_dependent(const string_view &cond_kind);
+	static std::shared_ptr<const program> get(const id::user &);
+	static bool invalidate(const id::user &);
+
+	const rule *match(const event &, const match::opts &) const;
+
+	program(const id::user &);
+	program(const push::rules &);
+};
+
+struct ircd::m::push::program::rule
+{
+	std::string scope;
+	std::string kind;
+	std::string ruleid;
+	std::string source;
+	event::idx idx {0};
+
+	/// Has a condition which depends on the user being evaluated.
+	bool user {false};
+
+	push::path path() const;
+	push::rule get() const;
 };
 
 /// 13.13.1 I'm your pusher, baby.
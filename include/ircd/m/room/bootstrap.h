@@ -13,8 +13,20 @@
 
 struct ircd::m::room::bootstrap
 {
+	using servers_closure = std::function<bool (const string_view &)>;
+
 	static bool required(const id &);
 
+	// partial state: servers in the room as reported by the resident server.
+	static bool servers(const id &, const servers_closure &);
+
+	// partial state: wait for the resync; false if still partial.
+	static bool wait(const id &, const milliseconds &);
+
+	// partial state: synchronous; fetch and evaluate the full state; false
+	// if no server could provide it and the room remains partial.
+	static bool resync(const id &);
+
 	// restrap: synchronous; send_join
 	bootstrap(const event &, const string_view &host, const string_view &room_version = {});
 
@@ -14,10 +14,13 @@
 /// Interface to the members of a room.
 ///
 /// This interface focuses specifically on room membership and its routines
-/// are optimized for this area of room functionality.
+/// are optimized for this area of room functionality. Counts and emptiness
+/// of the present state are read from the dbs::room_member_count index.
 ///
 struct ircd::m::room::members
 {
+	struct rebuild;
+
 	using closure_idx = std::function<bool (const id::user &, const event::idx &)>;
 	using closure = std::function<bool (const id::user &)>;
 
@@ -45,3 +48,16 @@ struct ircd::m::room::members
 	:room{room}
 	{}
 };
+
+/// Recompute the dbs::room_member_count index for a room (or every room)
+/// from its present state. The counts are not read until every room has
+/// been rebuilt, which is needed once after upgrading or importing. Every
+/// room is rebuilt under a vm::hold; one room is rebuilt again until no
+/// eval of the room interleaved with it.
+struct ircd::m::room::members::rebuild
+{
+	static void rebuild_txn(db::txn &, const room::id &);
+
+	rebuild(const room::id &);
+	rebuild();
+};
@@ -38,6 +38,7 @@ namespace ircd::m
 	bool remote_joined(const room &);
 	bool local_joined(const room &);
 	bool local_only(const room &);
+	bool partial(const room &); // joined with partial state; not yet resynced
 
 	// [GET] Convenience and tools
 	id::user::buf creator(const id::room &);
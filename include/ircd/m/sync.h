@@ -22,6 +22,7 @@ namespace ircd::m::sync
 	struct stats;
 	struct data;
 	struct item;
+	struct fanout;
 	using item_closure = std::function<void (item &)>;
 	using item_closure_bool = std::function<bool (item &)>;
 
@@ -113,6 +114,7 @@ struct ircd::m::sync::data
 	event::idx room_head {0}; // if *room
 	event::idx event_idx {0}; // if *event
 	string_view client_txnid;
+	const sync::fanout *fanout {nullptr}; // if event_idx matches
 
 	data(const m::user &user,
 	     const m::events::range &range,
@@ -127,6 +129,43 @@ struct ircd::m::sync::data
 	~data() noexcept;
 };
 
+/// Relevance of one event computed once for every linear and longpoll sync
+/// rather than by each client. This is produced by the first longpoll woken
+/// for the event; the others woken with it wait for that and share it. A
+/// client finding no fanout for its event computes all of this itself.
+struct ircd::m::sync::fanout
+{
+	static conf::item<bool> enable;
+	static conf::item<size_t> cache_max;
+	static std::deque<std::shared_ptr<const fanout>> cache;
+	static std::set<event::idx> pending;
+	static ctx::dock dock;
+
+	event::idx event_idx {0};
+	event::idx room_head {0};
+	int64_t room_depth {-1};
+	bool redacted {false};
+
+	/// Local users with any membership in the room at the event. Users not
+	/// found here have no membership.
+	std::map<std::string, std::string, std::less<>> members;
+
+	/// The members of the event common to every client (default key mask,
+	/// prev_content) which event::append splices in before the per-user
+	/// unsigned data.
+	std::string rendered;
+
+  public:
+	string_view membership(const id::user &) const;
+
+	static std::shared_ptr<const fanout> find(const event::idx &);
+	static std::shared_ptr<const fanout> get(const event &, const event::idx &);
+
+	fanout(const event &, const event::idx &);
+	fanout(fanout &&) = delete;
+	fanout(const fanout &) = delete;
+};
+
 struct ircd::m::sync::stats
 {
 	ircd::timer timer;
@@ -13,6 +13,7 @@
 
 struct ircd::m::user::devices
 {
+	struct cache;
 	using closure = std::function<void (const event::idx &, const string_view &)>;
 	using closure_bool = std::function<bool (const event::idx &, const string_view &)>;
 
@@ -42,3 +43,22 @@ struct ircd::m::user::devices
 	:user{user}
 	{}
 };
+
+/// Cache of remote users' device keys and cross-signing keys. Entries are
+/// populated from federation keys query responses and kept current by the
+/// m.device_list_update EDU stream; an update which cannot be applied in
+/// sequence invalidates the entry so the next query goes to the origin.
+struct ircd::m::user::devices::cache
+{
+	using closure = std::function<void (const json::object &device_keys, const json::object &master_key, const json::object &self_signing_key)>;
+
+	static conf::item<bool> enable;
+	static conf::item<seconds> ttl;
+	static conf::item<size_t> max;
+
+	static bool get(const m::user::id &, const closure &); // fresh entries only
+	static bool set(const m::user::id &, const json::object &device_keys, const json::object &master_key = {}, const json::object &self_signing_key = {});
+	static bool update(const device_list_update &);
+	static bool del(const m::user::id &);
+	static size_t clear();
+};
@@ -12,10 +12,21 @@
 #define HAVE_IRCD_M_USER_MITSEIN_H
 
 /// Interface to the other users visible to a user from common rooms.
+///
+/// Queries for joined membership are answered by the materialized
+/// dbs::user_mitsein index, supplemented by walking the members of any rooms
+/// too large to be indexed. Other memberships walk every room of the user, as
+/// do all queries until the index is marked complete.
 struct ircd::m::user::mitsein
 {
+	struct rebuild;
+
 	m::user user;
 
+  private:
+	bool for_each_large(const rooms::closure_bool &) const;
+	bool for_each_walk(const string_view &membership, const closure_bool &) const;
+
   public:
 	// All common rooms with user
 	bool for_each(const m::user &, const string_view &membership, const rooms::closure_bool &) const;
@@ -36,3 +47,10 @@ struct ircd::m::user::mitsein
 	:user{user}
 	{}
 };
+
+/// Recompute the dbs::user_mitsein index for every room from the present
+/// joined members and mark it complete. The vm is held for the duration.
+struct ircd::m::user::mitsein::rebuild
+{
+	rebuild();
+};
@@ -13,8 +13,58 @@
 
 namespace ircd::m
 {
+	struct visibility;
+
 	// The mxid argument is a string_view because it may be empty when no
 	// authentication is supplied (m::id cannot be empty because that's
 	// considered an invalid mxid). In that case the test is for public vis.
 	bool visible(const event &, const string_view &mxid);
+
+	// Batch of events all from the room; the visibility of each event is set
+	// in the output at the same position. Returns the number visible.
+	size_t visible(const room::id &, const string_view &mxid, const vector_view<const event> &, const vector_view<bool> &);
 }
+
+/// Visibility of the events of one room for one mxid. The history_visibility
+/// of the room and the membership of the user are each obtained once as a
+/// timeline of values by depth, so every event after construction is decided
+/// without any further query. Construct one of these for a loop over events
+/// of the same room rather than calling m::visible() for each.
+///
+/// Timelines are shared through a small LRU cache; a change to the state
+/// they're made from invalidates them.
+struct ircd::m::visibility
+{
+	struct timeline;
+
+	static conf::item<size_t> cache_max;
+
+	m::room::id room_id;
+	string_view mxid;
+	bool user {false};
+	bool node {false};
+	std::shared_ptr<const timeline> history_visibility;
+	std::shared_ptr<const timeline> membership;
+	mutable int8_t present {-1};
+
+	bool is_present() const;
+
+  public:
+	bool operator()(const event &) const;
+
+	visibility(const m::room::id &, const string_view &mxid);
+};
+
+/// The successive values of a property of the content of one state event
+/// (type, state_key) in a room, by descending depth.
+struct ircd::m::visibility::timeline
+{
+	std::vector<std::pair<int64_t, std::string>> values;
+
+  public:
+	string_view at(const int64_t &depth) const;
+
+	static std::shared_ptr<const timeline> get(const m::room::id &, const string_view &state_key);
+
+	timeline(const m::room::id &, const string_view &type, const string_view &state_key, const string_view &content_key);
+};
@@ -17,6 +17,7 @@ namespace ircd::m::vm
 {
 	struct error; // custom exception
 	struct init;
+	struct hold;
 	struct opts;
 	struct copts;
 	struct eval;
@@ -38,6 +39,7 @@ namespace ircd::m::vm
 
 	fault execute(eval &, const event &);
 	fault inject(eval &, json::iov &, const json::iov &);
+	void invalidate(const id::room & = {});
 }
 
 namespace ircd::m::vm::sequence
@@ -59,6 +61,24 @@ struct ircd::m::vm::init
 	init(), ~init() noexcept;
 };
 
+/// Exclusive hold over the vm. Construction blocks new evaluations, then waits
+/// for those in progress to finish and for the write sequence to drain; it
+/// remains quiescent until destruction. Only one hold exists at a time. Evals
+/// nested in another eval or conducted by the holding context pass through;
+/// the evals the holding context is already conducting are not waited for,
+/// though they must be past their write (e.g. on the effect hook).
+struct ircd::m::vm::hold
+{
+	static ctx::ctx *holder;
+
+	static void wait(const eval &);
+
+	hold();
+	hold(const hold &) = delete;
+	hold &operator=(const hold &) = delete;
+	~hold() noexcept;
+};
+
 /// Event Evaluation Device
 ///
 /// This object conducts the evaluation of an event or a tape of multiple
@@ -16,8 +16,15 @@ struct ircd::resource::method
 	enum flag :uint;
 	struct opts;
 	struct stats;
+	struct origin;
 	using handler = std::function<response (client &, request &)>;
 
+	static conf::item<bool> admission_enable;
+	static conf::item<milliseconds> admission_timeout;
+	static conf::item<size_t> admission_origins_max;
+	static conf::item<size_t> origin_concurrency_max;
+	static conf::item<size_t> rate_limited_rate;
+	static conf::item<size_t> rate_limited_burst;
 	static ctx::dock idle_dock;
 
 	struct resource *resource;
@@ -25,9 +32,15 @@ struct ircd::resource::method
 	handler function;
 	std::unique_ptr<const struct opts> opts;
 	std::unique_ptr<struct stats> stats;
+	std::list<std::pair<std::string, struct origin>> origins; // MRU first
+	std::unordered_map<string_view, decltype(origins)::iterator> origins_index;
+	ctx::dock admission_dock;
 	unique_const_iterator<decltype(resource::methods)> methods_it;
 
 	void handle_timeout(client &) const;
+	void admit_release(decltype(origins)::iterator) noexcept;
+	decltype(origins)::iterator admit_origin(const client &, const http::request::head &);
+	void admit(const client &, const http::request::head &);
 	response call_handler(client &, request &);
 
   public:
@@ -45,6 +58,7 @@ enum ircd::resource::method::flag
 	RATE_LIMITED          = 0x02,
 	VERIFY_ORIGIN         = 0x04,   //TODO: matrix abstraction bleed.
 	CONTENT_DISCRETION    = 0x08,
+	READ_ONLY             = 0x10,   ///< Makes no writes; served by a secondary.
 };
 
 struct ircd::resource::method::opts
@@ -61,6 +75,21 @@ struct ircd::resource::method::opts
 	/// MIME type; first part is the Registry (i.e application) and second
 	/// part is the format (i.e json). Empty value means nothing rejected.
 	std::pair<string_view, string_view> mime;
+
+	/// Maximum number of requests inside this method at once from all
+	/// origins. Further requests queue for a slot until the admission
+	/// timeout, after which they are shed with a 503. Zero is unlimited.
+	size_t concurrency_max {0};
+
+	/// Maximum number of requests inside this method at once from any one
+	/// origin; excess is refused with a 429. Zero defers to the conf default.
+	size_t origin_concurrency_max {0};
+
+	/// Token-bucket rate (requests per second) and burst size allowed for
+	/// any one origin. Zero defers to the conf defaults when the method is
+	/// RATE_LIMITED, otherwise the origin is not rate limited.
+	size_t origin_rate {0};
+	size_t origin_burst {0};
 };
 
 struct ircd::resource::method::stats
@@ -70,4 +99,16 @@ struct ircd::resource::method::stats
 	uint64_t timeouts {0};            // The method's timeout was exceeded.
 	uint64_t completions {0};         // The handler returned without throwing.
 	uint64_t internal_errors {0};     // The handler threw a very bad exception.
+	uint64_t queued {0};              // Waited for a concurrency slot.
+	uint64_t rejected {0};            // Refused for the origin with a 429.
+	uint64_t shed {0};                // Refused for the method with a 503.
+};
+
+/// Admission state for one origin of a method. The origin is the claimed
+/// X-Matrix server name or access token, qualified by the remote address.
+struct ircd::resource::method::origin
+{
+	uint64_t pending {0};             // Requests currently admitted.
+	int64_t tokens {0};               // Rate tokens in thousandths.
+	steady_point last;                // Time tokens were last replenished.
 };
@@ -91,6 +91,18 @@ struct ircd::server::in
 	/// An option can be set in request::opts to skip the last step.
 	std::vector<unique_buffer<mutable_buffer>> chunks;
 
+	/// The chunk closure is an optional callback invoked when each chunk of
+	/// a dynamic chunked message has been completely received. The argument
+	/// is a view of the chunk's data (without the terminator) which remains
+	/// valid in the chunks vector while contiguous_content is false. This
+	/// allows the content to be consumed as it arrives rather than after a
+	/// contiguous copy of the whole message. Like progress, this is called
+	/// from the receiving context and must not yield or throw. A consumer
+	/// done with a chunk may release it by replacing its buffer in chunks
+	/// with an empty one; the content_length_maxalloc bound applies to the
+	/// chunks retained rather than the whole message.
+	std::function<void (const_buffer)> chunk;
+
 	/// Call server::in::gethead(request) to extract the details of the HTTP
 	/// response being received by the request. This may not always be
 	/// available if it has not been received or was discarded etc.
@@ -148,7 +160,9 @@ struct ircd::server::request::opts
 	/// Only applies when using the dynamic content allocation feature; this
 	/// limits the size of that allocation in case the remote sends a larger
 	/// content-length value. If the remote sends more content, the behavior
-	/// is the same as if specifying an in.content buffer of this size.
+	/// is the same as if specifying an in.content buffer of this size. For a
+	/// chunked response this bounds the sum of the chunks; exceeding it is
+	/// always an error.
 	size_t content_length_maxalloc {256_MiB};
 
 	/// Only applies when using dynamic content allocation when the message is
@@ -83,6 +83,7 @@ ircd::ctx::ctx::~ctx()
 noexcept
 {
 	assert(yc == nullptr); // Check that the context isn't active.
+	prof::mark_destroyed(*this);
 }
 
 void
@@ -218,6 +219,14 @@ ircd::ctx::ctx::wait()
 	assert(current == this);
 	assert(notes == 1);
 
+	// A note which arrived during a scheduling deferral was held back from
+	// the deferral's own suspensions; it is taken here instead.
+	if(unlikely(deferred_note && !deferring))
+	{
+		deferred_note = false;
+		return false;
+	}
+
 	// Clear the notification counter.
 	notes = 0;
 
@@ -252,6 +261,11 @@ ircd::ctx::ctx::wait()
 	assert(current == this);
 	assert(notes == 1);  // notes = 1; set by continuation dtor on wakeup
 
+	// Scheduling policy at this yield point. A context over its CPU budget,
+	// or of a lower class than contexts which are queued, is deferred.
+	if(unlikely(prof::deferrable(*this)))
+		prof::defer(*this);
+
 	return true;
 }
 
@@ -263,6 +277,15 @@ bool
 ircd::ctx::ctx::note()
 noexcept
 {
+	// A deferral must not spend the note on its own suspensions; it is held
+	// for the next wait() after the deferral.
+	if(unlikely(deferring))
+	{
+		const bool first {!deferred_note};
+		deferred_note = true;
+		return first;
+	}
+
 	if(notes++ > 0)
 		return false;
 
@@ -277,6 +300,7 @@ bool
 ircd::ctx::ctx::wake()
 noexcept try
 {
+	prof::mark_queued(*this);
 	alarm.cancel();
 	return true;
 }
@@ -529,6 +553,14 @@ ircd::ctx::nice(ctx &ctx,
 	return ctx.nice;
 }
 
+ulong
+ircd::ctx::budget(ctx &ctx,
+                  const ulong &val)
+{
+	ctx.budget.limit = val;
+	return ctx.budget.limit;
+}
+
 int8_t
 ircd::ctx::ionice(ctx &ctx,
                   const int8_t &val)
@@ -618,6 +650,14 @@ noexcept
 	return prof::get(ctx, prof::event::CYCLES);
 }
 
+/// Returns the CPU budget of the context in tsc cycles per budget period.
+const ulong &
+ircd::ctx::budget(const ctx &ctx)
+noexcept
+{
+	return ctx.budget.limit;
+}
+
 /// Returns the IO priority nice-value
 [[gnu::hot]]
 const int8_t &
@@ -772,7 +812,9 @@ ircd::ctx::this_ctx::yield()
 {
 	static ios::descriptor descriptor
 	{
-		"ircd::ctx courtesy yield"
+		"ircd::ctx courtesy yield",
+		ios::descriptor::pool_allocator,
+		ios::descriptor::pool_deallocator,
 	};
 
 	ircd::post
@@ -1209,9 +1251,9 @@ ircd::ctx::context::context(const string_view &name,
 {
 	static ios::descriptor desc[3]
 	{
-		{ "ircd::ctx::spawn post"      },
-		{ "ircd::ctx::spawn defer"     },
-		{ "ircd::ctx::spawn dispatch"  },
+		{ "ircd::ctx::spawn post",      ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
+		{ "ircd::ctx::spawn defer",     ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
+		{ "ircd::ctx::spawn dispatch",  ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
 	};
 
 	auto spawn
@@ -1448,6 +1490,9 @@ ircd::ctx::pool::add(const size_t &num)
 		assert(opt);
 		ionice(ctxs.back(), opt->ionice);
 		nice(ctxs.back(), opt->nice);
+		budget.limit = opt->budget;
+		if(opt->budget)
+			static_cast<ctx &>(ctxs.back()).pool_budget = &budget;
 	}
 }
 
@@ -1614,6 +1659,13 @@ namespace ircd::ctx::prof
 	static void handle_cur_enter();
 
 	static void inc_ticker(const event &e) noexcept;
+
+	static ulong budget_period_cur() noexcept;
+	static void budget_charge(budget &, const ulong &cycles) noexcept;
+	static bool sched_higher_queued(const uint &sched_class) noexcept;
+	static void sched_resumed(ctx &) noexcept;
+
+	thread_local std::array<sched, sched::CLASSES> _sched;
 }
 
 // stack_usage_warning at 1/3 engineering tolerance
@@ -1658,6 +1710,40 @@ ircd::ctx::prof::settings::slice_assertion
 	{ "persist",  false                           },
 };
 
+decltype(ircd::ctx::prof::settings::sched_enable)
+ircd::ctx::prof::settings::sched_enable
+{
+	{ "name",         "ircd.ctx.prof.sched.enable" },
+	{ "default",      false                        },
+	{ "description",
+
+	R"(
+	Contexts resuming while contexts of a higher priority class (lower nice
+	value) are queued requeue themselves behind them. Contexts exceeding their
+	CPU budget are deferred until the budget period rolls over.
+	)"}
+};
+
+decltype(ircd::ctx::prof::settings::sched_defer_max)
+ircd::ctx::prof::settings::sched_defer_max
+{
+	{ "name",     "ircd.ctx.prof.sched.defer_max" },
+	{ "default",  2L                              },
+};
+
+decltype(ircd::ctx::prof::settings::budget_period)
+ircd::ctx::prof::settings::budget_period
+{
+	{ "name",     "ircd.ctx.prof.budget.period" },
+	{ "default",  100L                          },
+};
+
+decltype(ircd::ctx::prof::sched::bucket)
+ircd::ctx::prof::sched::bucket
+{{
+	10us, 100us, 1ms, 10ms, 100ms, microseconds::max()
+}};
+
 [[gnu::hot]]
 void
 ircd::ctx::prof::mark(const event &e)
@@ -1694,6 +1780,7 @@ void
 ircd::ctx::prof::handle_cur_enter()
 {
 	slice_enter();
+	sched_resumed(cur());
 }
 
 [[gnu::hot]]
@@ -1718,6 +1805,7 @@ void
 ircd::ctx::prof::handle_cur_continue()
 {
 	slice_enter();
+	sched_resumed(cur());
 }
 
 [[gnu::hot]]
@@ -1760,6 +1848,234 @@ noexcept
 	c.ios_desc.stats->slice_last = last_slice;
 	c.stack.at = stack_at_here();
 	c.stack.peak = std::max(c.stack.at, c.stack.peak);
+
+	if(unlikely(c.budget.limit))
+		budget_charge(c.budget, last_slice);
+
+	if(unlikely(c.pool_budget))
+		budget_charge(*c.pool_budget, last_slice);
+}
+
+//
+// scheduling
+//
+
+/// Called when a context is queued for resumption by wake().
+[[gnu::hot]]
+void
+ircd::ctx::prof::mark_queued(ctx &c)
+noexcept
+{
+	if(c.queued >= 0)
+		return;
+
+	c.queued = sched_class(c);
+	c.queued_at = now<steady_point>();
+	_sched[c.queued].queued++;
+}
+
+void
+ircd::ctx::prof::mark_destroyed(ctx &c)
+noexcept
+{
+	if(c.queued < 0)
+		return;
+
+	assert(_sched[c.queued].queued > 0);
+	_sched[c.queued].queued--;
+	c.queued = -1;
+}
+
+/// Called when a context resumes; accounts the time it was queued.
+[[gnu::hot]]
+void
+ircd::ctx::prof::sched_resumed(ctx &c)
+noexcept
+{
+	if(c.queued < 0)
+		return;
+
+	auto &sched
+	{
+		_sched[c.queued]
+	};
+
+	const auto delay
+	{
+		duration_cast<microseconds>(now<steady_point>() - c.queued_at)
+	};
+
+	size_t i(0);
+	while(delay >= sched::bucket[i] && i < sched::BUCKETS - 1)
+		++i;
+
+	sched.delay[i]++;
+	sched.resumed++;
+	assert(sched.queued > 0);
+	sched.queued--;
+	c.queued = -1;
+}
+
+/// Whether the context should be deferred at this yield point.
+[[gnu::hot]]
+bool
+ircd::ctx::prof::deferrable(const ctx &c)
+noexcept
+{
+	if(likely(!settings::sched_enable))
+		return false;
+
+	if(c.deferring)
+		return false;
+
+	if(c.budget.limit && budget_exceeded(c.budget))
+		return true;
+
+	if(c.pool_budget && budget_exceeded(*c.pool_budget))
+		return true;
+
+	return sched_higher_queued(sched_class(c));
+}
+
+/// Defer the current context. The time remaining on the alarm when the
+/// context woke is restored for the caller of ctx::wait(). Restoring the
+/// deadline instead would let the time spent deferred run it out, so a
+/// notified wait would appear to the caller as a timeout. The deferral only
+/// suspends on the alarm; notes received meanwhile are held by ctx::note()
+/// and taken by the next ctx::wait().
+void
+ircd::ctx::prof::defer(ctx &c)
+{
+	assert(current == &c);
+	const scope_restore deferring
+	{
+		c.deferring, true
+	};
+
+	const auto remaining
+	{
+		c.alarm.expires_from_now()
+	};
+
+	const unwind restore_alarm{[&c, &remaining]
+	{
+		c.alarm.expires_from_now(remaining);
+	}};
+
+	auto &sched
+	{
+		_sched[sched_class(c)]
+	};
+
+	// Over budget: sleep until the next period.
+	const bool over_budget
+	{
+		(c.budget.limit && budget_exceeded(c.budget)) ||
+		(c.pool_budget && budget_exceeded(*c.pool_budget))
+	};
+
+	if(over_budget)
+	{
+		const milliseconds period
+		{
+			settings::budget_period
+		};
+
+		const auto elapsed
+		{
+			duration_cast<milliseconds>(now<steady_point>().time_since_epoch()) % period
+		};
+
+		sched.throttled++;
+		c.budget.throttled += bool(c.budget.limit);
+		if(c.pool_budget)
+			c.pool_budget->throttled++;
+
+		this_ctx::sleep(period - elapsed);
+	}
+
+	// Requeue behind the higher classes.
+	const auto sched_class
+	{
+		prof::sched_class(c)
+	};
+
+	for(size_t i(0); i < settings::sched_defer_max && sched_higher_queued(sched_class); ++i)
+	{
+		sched.deferred++;
+		this_ctx::wait(microseconds(0), std::nothrow);
+	}
+}
+
+bool
+ircd::ctx::prof::sched_higher_queued(const uint &sched_class)
+noexcept
+{
+	if(likely(sched_class == 0))
+		return false;
+
+	if(!settings::sched_enable)
+		return false;
+
+	for(uint i(0); i < sched_class; ++i)
+		if(_sched[i].queued)
+			return true;
+
+	return false;
+}
+
+uint
+ircd::ctx::prof::sched_class(const ctx &c)
+noexcept
+{
+	return
+		c.nice < 0? 0:
+		c.nice > 0? 2:
+		            1;
+}
+
+const ircd::ctx::prof::sched &
+ircd::ctx::prof::get_sched(const uint &sched_class)
+{
+	return _sched.at(sched_class);
+}
+
+bool
+ircd::ctx::prof::budget_exceeded(const budget &b)
+noexcept
+{
+	return b.limit && b.period == budget_period_cur() && b.used >= b.limit;
+}
+
+void
+ircd::ctx::prof::budget_charge(budget &b,
+                               const ulong &cycles)
+noexcept
+{
+	const auto period
+	{
+		budget_period_cur()
+	};
+
+	if(b.period != period)
+	{
+		b.period = period;
+		b.used = 0;
+	}
+
+	b.used += cycles;
+}
+
+ulong
+ircd::ctx::prof::budget_period_cur()
+noexcept
+{
+	const milliseconds period
+	{
+		settings::budget_period
+	};
+
+	return now<steady_point>().time_since_epoch() / std::max(period, 1ms);
 }
 
 #ifndef NDEBUG
@@ -21,6 +21,10 @@
 namespace ircd::ctx::prof
 {
 	void mark(const event &);
+	void mark_queued(ctx &) noexcept;
+	void mark_destroyed(ctx &) noexcept;
+	bool deferrable(const ctx &) noexcept;
+	void defer(ctx &);
 }
 
 /// Internal context implementation
@@ -36,6 +40,12 @@ struct ircd::ctx::ctx
 	context::flags flags;                        // User given flags
 	int8_t nice {0};                             // Scheduling priority nice-value
 	int8_t ionice {0};                           // IO priority nice-value (defaults for fs::opts)
+	int8_t queued {-1};                          // sched class when queued by wake(); else -1
+	bool deferring {false};                      // within a scheduling deferral
+	bool deferred_note {false};                  // noted within a deferral; taken by next wait()
+	steady_point queued_at;                      // time queued by wake()
+	prof::budget budget;                         // CPU budget of this context
+	prof::budget *pool_budget {nullptr};         // CPU budget shared with a pool
 	int32_t notes {0};                           // norm: 0 = asleep; 1 = awake; inc by others; dec by self
 	boost::asio::deadline_timer alarm;           // acting semaphore (64B)
 	boost::asio::yield_context *yc {nullptr};    // boost interface
@@ -428,6 +428,65 @@ ircd::db::sync(database &d)
 	};
 }
 
+/// Catch up every database opened as a secondary. Errors are logged and do
+/// not prevent the others from being refreshed. Returns the number refreshed.
+size_t
+ircd::db::refresh()
+{
+	std::vector<std::string> names;
+	for(const auto *const &d : database::list)
+		if(d->secondary)
+			names.emplace_back(d->name);
+
+	size_t ret(0);
+	for(const auto &name : names) try
+	{
+		// Looked up again as the list may change while refreshing.
+		auto *const d
+		{
+			database::get(std::nothrow, name)
+		};
+
+		ret += d && refresh(*d);
+	}
+	catch(const std::exception &e)
+	{
+		log::error
+		{
+			log, "[%s] Failed to catch up with primary :%s",
+			name,
+			e.what(),
+		};
+	}
+
+	return ret;
+}
+
+/// Catch a secondary instance up with the primary by replaying the changes
+/// found in its MANIFEST and WAL since the last call. Returns false if this
+/// database was not opened as a secondary.
+bool
+ircd::db::refresh(database &d)
+{
+	if(!d.secondary)
+		return false;
+
+	const ctx::uninterruptible::nothrow ui;
+	throw_on_error
+	{
+		d.d->TryCatchUpWithPrimary()
+	};
+
+	log::debug
+	{
+		log, "[%s] @%lu CATCH UP",
+		name(d),
+		sequence(d)
+	};
+
+	return true;
+}
+
 /// Flushes all columns. Note that if blocking=true, blocking may occur for
 /// each column individually.
 void
@@ -1133,6 +1192,10 @@ try
 {
 	ircd::read_only
 }
+,secondary
+{
+	ircd::secondary
+}
 ,env
 {
 	std::make_shared<struct env>(this)
@@ -1206,6 +1269,10 @@ try
 	// bad for write perf.
 	opts->max_open_files = fs::support::rlimit_nofile();
 
+	// A secondary must keep all files open to follow the primary.
+	if(secondary)
+		opts->max_open_files = -1;
+
 	// TODO: Check if these values can be increased; RocksDB may keep
 	// thread_local state preventing values > 1.
 	opts->max_background_jobs = 16;
@@ -1428,9 +1495,37 @@ try
 			path,
 		};
 
+	if(secondary)
+		log::warning
+		{
+			log, "Database \"%s\" @ `%s' will be opened as a secondary.",
+			this->name,
+			path,
+		};
+
+	// RocksDB wants a directory for a secondary's info log; ours goes to the
+	// logger above so it remains empty and can be shared by every secondary.
+	const std::string secondary_path
+	{
+		secondary?
+			fs::path_string(fs::path_views
+			{
+				fs::base::run, "secondary", this->name
+			}):
+			std::string{}
+	};
+
+	if(secondary)
+		fs::mkdir(secondary_path);
+
 	// Open DB into ptr
 	rocksdb::DB *ptr;
-	if(read_only)
+	if(secondary)
+		throw_on_error
+		{
+			rocksdb::DB::OpenAsSecondary(*opts, path, secondary_path, columns, &handles, &ptr)
+		};
+	else if(read_only)
 		throw_on_error
 		{
 			rocksdb::DB::OpenForReadOnly(*opts, path, columns, &handles, &ptr)
@@ -2077,7 +2172,7 @@ ircd::db::database::column::column(database &d,
 	// Setup the cache for assets.
 	const auto &cache_size(this->descriptor->cache_size);
 	if(cache_size != 0)
-		table_opts.block_cache = std::make_shared<database::cache>(this->d, this->stats, this->allocator, this->name, cache_size);
+		table_opts.block_cache = std::make_shared<database::cache>(this->d, this->stats, this->allocator, this->name, cache_size, this->descriptor->cache_admit);
 
 	// RocksDB will create an 8_MiB block_cache if we don't create our own.
 	// To honor the user's desire for a zero-size cache, this must be set.
@@ -2105,7 +2200,7 @@ ircd::db::database::column::column(database &d,
 
 	log::debug
 	{
-		log, "schema '%s' column [%s => %s] cmp[%s] pfx[%s] lru:%s:%s bloom:%zu compression:%d %s",
+		log, "schema '%s' column [%s => %s] cmp[%s] pfx[%s] lru:%s:%s%s bloom:%zu compression:%d %s",
 		db::name(d),
 		demangle(key_type.name()),
 		demangle(mapped_type.name()),
@@ -2113,6 +2208,7 @@ ircd::db::database::column::column(database &d,
 		this->options.prefix_extractor? this->prefix.Name() : "none",
 		cache_size? "YES": "NO",
 		cache_size_comp? "YES": "NO",
+		cache_size && this->descriptor->cache_admit? ":LFU": "",
 		bloom_bits,
 		int(this->options.compression),
 		this->descriptor->name
@@ -3057,6 +3153,27 @@ ircd::db::database::cache::DEFAULT_HI_PRIO
 	0.25
 };
 
+decltype(ircd::db::database::cache::admit_width)
+ircd::db::database::cache::admit_width
+{
+	{ "name",     "ircd.db.cache.admit.width" },
+	{ "default",  long(256_KiB)               },
+};
+
+decltype(ircd::db::database::cache::admit_freq)
+ircd::db::database::cache::admit_freq
+{
+	{ "name",     "ircd.db.cache.admit.freq" },
+	{ "default",  2L                         },
+};
+
+decltype(ircd::db::database::cache::promote_freq)
+ircd::db::database::cache::promote_freq
+{
+	{ "name",     "ircd.db.cache.promote.freq" },
+	{ "default",  4L                           },
+};
+
 //
 // cache::cache
 //
@@ -3065,7 +3182,8 @@ ircd::db::database::cache::cache(database *const &d,
                                  std::shared_ptr<struct database::stats> stats,
                                  std::shared_ptr<struct database::allocator> allocator,
                                  std::string name,
-                                 const ssize_t &initial_capacity)
+                                 const ssize_t &initial_capacity,
+                                 const bool &admit)
 #ifdef IRCD_DB_HAS_ALLOCATOR
 :rocksdb::Cache{allocator}
 ,d{d}
@@ -3085,6 +3203,12 @@ ircd::db::database::cache::cache(database *const &d,
 	,this->allocator
 	#endif
 })}
+,sketch
+{
+	admit?
+		std::make_unique<struct sketch>(admit_width):
+		nullptr
+}
 {
 	assert(bool(c));
 	#ifdef IRCD_DB_HAS_ALLOCATOR
@@ -3118,6 +3242,9 @@ noexcept
 	assert(bool(c));
 	assert(bool(stats));
 
+	if(sketch && !admit(key, value, charge, del, handle, priority).ok())
+		return Status::OK();
+
 	const rocksdb::Status &ret
 	{
 		c->Insert(key, value, charge, del, handle, priority)
@@ -3154,6 +3281,14 @@ noexcept
 		c->Lookup(key, s)
 	};
 
+	// Every access is counted by the admission sketch, hit or miss; the
+	// estimate is later consulted by Insert() following a miss.
+	if(sketch)
+	{
+		sketch->increment(slice(key));
+		admission.aging += sketch->age();
+	}
+
 	// Rocksdb's LRUCache stats are broke. The statistics ptr is null and
 	// passing it to Lookup() does nothing internally. We have to do this
 	// here ourselves :/
@@ -3168,6 +3303,12 @@ ircd::db::database::cache::Ref(Handle *const handle)
 noexcept
 {
 	assert(bool(c));
+	if(auto *const b{bypassed(handle)})
+	{
+		++b->refs;
+		return true;
+	}
+
 	return c->Ref(handle);
 }
 
@@ -3177,6 +3318,17 @@ ircd::db::database::cache::Release(Handle *const handle,
 noexcept
 {
 	assert(bool(c));
+	if(auto *const b{bypassed(handle)})
+	{
+		assert(b->refs > 0);
+		if(--b->refs > 0)
+			return false;
+
+		b->del(Slice{b->key}, b->value);
+		delete b;
+		return true;
+	}
+
 	return c->Release(handle, force_erase);
 }
 
@@ -3185,9 +3337,14 @@ ircd::db::database::cache::Value(Handle *const handle)
 noexcept
 {
 	assert(bool(c));
+	if(auto *const b{bypassed(handle)})
+		return b->value;
+
 	return c->Value(handle);
 }
 
+/// Bypass entries are never in the underlying cache so they can't be found
+/// by key; they live until their last handle is released.
 void
 ircd::db::database::cache::Erase(const Slice &key)
 noexcept
@@ -3249,6 +3406,9 @@ ircd::db::database::cache::GetUsage(Handle *const handle)
 const noexcept
 {
 	assert(bool(c));
+	if(const auto *const b{bypassed(handle)})
+		return b->charge;
+
 	return c->GetUsage(handle);
 }
 
@@ -3299,10 +3459,201 @@ ircd::db::database::cache::GetCharge(Handle *const handle)
 const noexcept
 {
 	assert(bool(c));
+	if(const auto *const b{bypassed(handle)})
+		return b->charge;
+
 	return c->GetCharge(handle);
 }
 #endif
 
+/// Frequency threshold admission. While the cache has capacity to spare
+/// everything is admitted; once full, only keys estimated to have been
+/// accessed at least admit_freq times recently may displace resident entries.
+/// Frequently seen keys are promoted into the high-priority pool of the
+/// underlying LRU which acts as the protected segment. The priority argument
+/// is modified for the subsequent insertion. A non-ok status indicates the
+/// entry was refused and has been disposed of or handed back to the caller
+/// through a bypass handle.
+///
+/// Note this is not TinyLFU proper: the candidate is compared against a fixed
+/// threshold rather than against the estimate for the entry it would evict,
+/// because rocksdb's LRUCache does not expose its eviction victim.
+rocksdb::Status
+ircd::db::database::cache::admit(const Slice &key,
+                                 void *const value,
+                                 const size_t charge,
+                                 deleter del,
+                                 Handle **const handle,
+                                 Priority &priority)
+noexcept
+{
+	assert(sketch);
+
+	// Index and filter blocks are always admitted.
+	if(priority == Priority::HIGH)
+	{
+		++admission.admit;
+		return Status::OK();
+	}
+
+	const auto freq
+	{
+		sketch->estimate(slice(key))
+	};
+
+	const bool promote
+	{
+		freq >= size_t(promote_freq)
+	};
+
+	const bool vacant
+	{
+		c->GetUsage() + charge <= c->GetCapacity()
+	};
+
+	if(vacant || freq >= size_t(admit_freq))
+	{
+		priority = promote? Priority::HIGH : Priority::LOW;
+		admission.promote += promote;
+		++admission.admit;
+		return Status::OK();
+	}
+
+	++admission.reject;
+
+	// When the caller doesn't want a handle the behavior is as if the entry
+	// was inserted and then immediately evicted.
+	if(!handle)
+	{
+		del(key, value);
+		return Status::Incomplete();
+	}
+
+	// Otherwise the caller gets a handle to the value which is owned by us
+	// outside of the underlying cache.
+	auto *const b
+	{
+		new struct bypass
+		{
+			key.ToString(), value, charge, del
+		}
+	};
+
+	assert(!(uintptr_t(b) & 0x01UL));
+	*handle = reinterpret_cast<Handle *>(uintptr_t(b) | 0x01UL);
+	return Status::Incomplete();
+}
+
+ircd::db::database::cache::bypass *
+ircd::db::database::cache::bypassed(Handle *const &handle)
+noexcept
+{
+	return uintptr_t(handle) & 0x01UL?
+		reinterpret_cast<struct bypass *>(uintptr_t(handle) & ~0x01UL):
+		nullptr;
+}
+
+//
+// cache::sketch
+//
+
+ircd::db::database::cache::sketch::sketch(const size_t &width)
+:mask{[&width]
+{
+	size_t ret(64);
+	while(ret < width)
+		ret <<= 1;
+
+	return ret - 1;
+}()}
+,sample_max
+{
+	(mask + 1) * 10
+}
+,counter
+{
+	std::make_unique<std::atomic<uint8_t>[]>((mask + 1) * ROWS)
+}
+{
+}
+
+bool
+ircd::db::database::cache::sketch::age()
+noexcept
+{
+	size_t expect
+	{
+		samples.load(std::memory_order_relaxed)
+	};
+
+	if(likely(expect < sample_max))
+		return false;
+
+	// Only the thread which halves the sample count decays the counters.
+	if(!samples.compare_exchange_strong(expect, expect / 2, std::memory_order_relaxed))
+		return false;
+
+	for(size_t i(0); i < (mask + 1) * ROWS; ++i)
+		counter[i].store(counter[i].load(std::memory_order_relaxed) >> 1, std::memory_order_relaxed);
+
+	return true;
+}
+
+uint8_t
+ircd::db::database::cache::sketch::increment(const string_view &key)
+noexcept
+{
+	const size_t hash
+	{
+		std::hash<string_view>{}(key)
+	};
+
+	uint8_t ret(MAX);
+	for(size_t i(0); i < ROWS; ++i)
+	{
+		const size_t idx
+		{
+			((hash + i * ((hash >> 32) | 1UL)) & mask) + i * (mask + 1)
+		};
+
+		const uint8_t value
+		{
+			counter[idx].load(std::memory_order_relaxed)
+		};
+
+		if(value < MAX)
+			counter[idx].store(value + 1, std::memory_order_relaxed);
+
+		ret = std::min(ret, uint8_t(value + (value < MAX)));
+	}
+
+	samples.fetch_add(1, std::memory_order_relaxed);
+	return ret;
+}
+
+uint8_t
+ircd::db::database::cache::sketch::estimate(const string_view &key)
+const noexcept
+{
+	const size_t hash
+	{
+		std::hash<string_view>{}(key)
+	};
+
+	uint8_t ret(MAX);
+	for(size_t i(0); i < ROWS; ++i)
+	{
+		const size_t idx
+		{
+			((hash + i * ((hash >> 32) | 1UL)) & mask) + i * (mask + 1)
+		};
+
+		ret = std::min(ret, counter[idx].load(std::memory_order_relaxed));
+	}
+
+	return ret;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // database::compaction_filter
@@ -4076,6 +4427,34 @@ ircd::db::histogram_max
 decltype(ircd::db::prefetcher)
 ircd::db::prefetcher;
 
+decltype(ircd::db::prefetcher::ttl_background)
+ircd::db::prefetcher::ttl_background
+{
+	{ "name",     "ircd.db.prefetch.ttl.background" },
+	{ "default",  10L                               },
+};
+
+decltype(ircd::db::prefetcher::ttl_bulk)
+ircd::db::prefetcher::ttl_bulk
+{
+	{ "name",     "ircd.db.prefetch.ttl.bulk" },
+	{ "default",  60L                         },
+};
+
+decltype(ircd::db::prefetcher::latency_target)
+ircd::db::prefetcher::latency_target
+{
+	{ "name",     "ircd.db.prefetch.latency.target" },
+	{ "default",  5000L                             },
+};
+
+decltype(ircd::db::prefetcher::queue_depth_max)
+ircd::db::prefetcher::queue_depth_max
+{
+	{ "name",     "ircd.db.prefetch.queue_depth.max" },
+	{ "default",  32L                                },
+};
+
 //
 // db::prefetcher
 //
@@ -4084,6 +4463,10 @@ ircd::db::prefetcher::prefetcher()
 {
 	std::make_unique<struct ticker>()
 }
+,concurrency
+{
+	size_t(db::request_pool_size)
+}
 ,context
 {
 	"db.prefetcher",
@@ -4132,8 +4515,18 @@ ircd::db::prefetcher::operator()(column &c,
 		return false;
 	}
 
-	queue.emplace_back(d, c, key);
+	const enum prio klass
+	{
+		test(opts, get::PRIO_HIGH)?
+			prio::INTERACTIVE:
+		test(opts, get::PRIO_LOW)?
+			prio::BULK:
+			prio::BACKGROUND
+	};
+
+	queue.emplace_back(d, c, key, klass);
 	queue.back().snd = now<steady_point>();
+	ticker->class_request[klass]++;
 	ticker->request++;
 
 	// Branch here based on whether it's not possible to directly dispatch
@@ -4141,7 +4534,7 @@ ircd::db::prefetcher::operator()(column &c,
 	// prefetcher worker, and then it blocks on submitting to the request
 	// worker instead of us blocking here. This is done to avoid use and growth
 	// of any request pool queue, and allow for more direct submission.
-	if(db::request.wouldblock())
+	if(wouldblock(klass))
 	{
 		dock.notify_one();
 
@@ -4228,7 +4621,18 @@ try
 			if(ticker->request <= ticker->handles)
 				return false;
 
-			return true;
+			// Dispatch is held while the concurrency window is exhausted
+			// unless something interactive is waiting in the queue.
+			if(request_workers < concurrency)
+				return true;
+
+			return std::any_of(begin(queue), end(queue), []
+			(const auto &request)
+			{
+				return request.prio == prio::INTERACTIVE
+				&& request.req == steady_point::min()
+				&& request.fin == steady_point::min();
+			});
 		});
 
 		handle();
@@ -4243,6 +4647,19 @@ catch(const std::exception &e)
 	};
 }
 
+bool
+ircd::db::prefetcher::wouldblock(const prio &klass)
+const noexcept
+{
+	if(db::request.wouldblock())
+		return true;
+
+	if(klass == prio::INTERACTIVE)
+		return false;
+
+	return request_workers >= concurrency;
+}
+
 void
 ircd::db::prefetcher::handle()
 {
@@ -4275,6 +4692,10 @@ ircd::db::prefetcher::request_worker()
 		std::bind(&prefetcher::request_cleanup, this)
 	};
 
+	// Cancel speculative requests which have waited in the queue too long
+	// to still be useful to whoever made them.
+	request_expire();
+
 	// GC the queue here to get rid of any cancelled requests which have
 	// arrived at the front so they don't become our request.
 	const size_t cleanup_on_enter
@@ -4282,16 +4703,21 @@ ircd::db::prefetcher::request_worker()
 		request_cleanup()
 	};
 
-	// Find the first request in the queue which does not have its req
-	// timestamp sent.
-	auto request
+	// Find the first request in the queue of the highest priority class
+	// which does not have its req timestamp sent.
+	auto request(end(queue));
+	for(auto it(begin(queue)); it != end(queue); ++it)
 	{
-		std::find_if(begin(queue), end(queue), []
-		(const auto &request)
-		{
-			return request.req == steady_point::min();
-		})
-	};
+		if(it->req != steady_point::min() || it->fin != steady_point::min())
+			continue;
+
+		if(request != end(queue) && request->prio <= it->prio)
+			continue;
+
+		request = it;
+		if(request->prio == prio::INTERACTIVE)
+			break;
+	}
 
 	if(request == end(queue))
 		return;
@@ -4305,7 +4731,10 @@ ircd::db::prefetcher::request_worker()
 	ticker->fetches++;
 	request_handle(*request);
 	assert(request->fin != steady_point::min());
+	ticker->class_accum_snd_fin[request->prio] += duration_cast<microseconds>(request->fin - request->snd);
+	ticker->class_fetched[request->prio]++;
 	ticker->fetched++;
+	request_adapt();
 
 	#ifdef IRCD_DB_DEBUG_PREFETCH
 	log::debug
@@ -4323,6 +4752,77 @@ ircd::db::prefetcher::request_worker()
 	#endif
 }
 
+/// Adjusts the number of request workers allowed to run concurrently for
+/// non-interactive requests. The window grows additively while the average
+/// latency of database operations and the depth of the device queue are
+/// below their targets and shrinks multiplicatively when they are exceeded.
+void
+ircd::db::prefetcher::request_adapt()
+noexcept
+{
+	assert(ticker);
+	ticker->avg_req_fin = (ticker->avg_req_fin * 7 + ticker->last_req_fin) / 8;
+
+	const size_t queue_depth
+	{
+		fs::aio::system?
+			size_t(fs::aio::stats.cur_reads) + fs::aio::stats.cur_queued:
+			0UL
+	};
+
+	const bool congested
+	{
+		ticker->avg_req_fin > microseconds(latency_target)
+		|| queue_depth > size_t(queue_depth_max)
+	};
+
+	const size_t concurrency_max
+	{
+		std::max(size_t(db::request_pool_size), 1UL)
+	};
+
+	concurrency = congested?
+		std::max(concurrency / 2, 1UL):
+		std::min(concurrency + 1, concurrency_max);
+}
+
+size_t
+ircd::db::prefetcher::request_expire()
+noexcept
+{
+	const auto now
+	{
+		ircd::now<steady_point>()
+	};
+
+	const seconds ttl[prio::_NUM_]
+	{
+		0s, // unused; interactive requests never expire.
+		seconds(ttl_background),
+		seconds(ttl_bulk),
+	};
+
+	size_t expired(0);
+	for(auto &request : queue)
+	{
+		if(request.req != steady_point::min() || request.fin != steady_point::min())
+			continue;
+
+		if(request.prio == prio::INTERACTIVE)
+			continue;
+
+		if(now - request.snd < ttl[request.prio])
+			continue;
+
+		request.fin = now;
+		ticker->class_expired[request.prio]++;
+		++expired;
+	}
+
+	ticker->cancels += expired;
+	return expired;
+}
+
 size_t
 ircd::db::prefetcher::request_cleanup()
 noexcept
@@ -4435,7 +4935,8 @@ ircd::db::prefetcher::wait_pending()
 
 ircd::db::prefetcher::request::request(database &d,
                                        const column &c,
-                                       const string_view &key)
+                                       const string_view &key,
+                                       const enum prio &prio)
 noexcept
 :d
 {
@@ -4461,6 +4962,10 @@ noexcept
 {
 	steady_point::min()
 }
+,prio
+{
+	prio
+}
 {
 	const size_t &len
 	{
@@ -6416,6 +6921,277 @@ ircd::db::ingest(column &column,
 	};
 }
 
+namespace ircd::db
+{
+	static void ingest_write(rocksdb::SstFileWriter &, const delta &);
+}
+
+/// The deltas of the txn are grouped by column, sorted with each column's
+/// comparator and written to an SST file per column which is then moved into
+/// the database. This bypasses the memtable and WAL entirely so it is suited
+/// for bulk loading. When a key appears more than once in the txn the last
+/// SET or DELETE wins and every MERGE after it is kept, folded together with
+/// the column's merge operator since an SST has one entry per key;
+/// DELETE_RANGE is not supported. Columns are ingested one at a
+/// time so the txn is not atomic across columns.
+void
+ircd::db::ingest(const txn &t,
+                 const string_view &dir_)
+{
+	assert(t.d);
+	database &d(*t.d);
+
+	std::map<string_view, std::vector<delta>> columns;
+	for_each(t, delta_closure{[&columns]
+	(const delta &delta)
+	{
+		if(unlikely(std::get<delta::OP>(delta) == op::DELETE_RANGE))
+			throw error
+			{
+				"Cannot ingest DELETE_RANGE in column '%s'",
+				std::get<delta::COL>(delta),
+			};
+
+		columns[std::get<delta::COL>(delta)].emplace_back(delta);
+	}});
+
+	std::string dir
+	{
+		dir_
+	};
+
+	if(dir.empty())
+	{
+		const string_view path_parts[]
+		{
+			fs::base::db, db::name(d), "ingest"
+		};
+
+		dir = fs::path_string(path_parts);
+	}
+
+	fs::mkdir(dir);
+	for(auto &[colname, deltas] : columns)
+	{
+		db::column column
+		{
+			d, colname
+		};
+
+		database::column &c(column);
+		const rocksdb::Options opts(d.d->GetOptions(c));
+		const rocksdb::Comparator &cmp
+		{
+			*opts.comparator
+		};
+
+		std::stable_sort(begin(deltas), end(deltas), [&cmp]
+		(const delta &a, const delta &b)
+		{
+			return cmp.Compare(slice(std::get<delta::KEY>(a)), slice(std::get<delta::KEY>(b))) < 0;
+		});
+
+		char namebuf[64];
+		const string_view filename
+		{
+			fmt::sprintf
+			{
+				namebuf, "%s.%lu.%lu.sst",
+				colname,
+				db::sequence(d),
+				t.size(),
+			}
+		};
+
+		const string_view path_parts[]
+		{
+			dir, filename
+		};
+
+		const std::string path
+		{
+			fs::path_string(path_parts)
+		};
+
+		const rocksdb::EnvOptions eopts(opts);
+		rocksdb::SstFileWriter writer
+		{
+			eopts, opts, c
+		};
+
+		throw_on_error
+		{
+			writer.Open(path)
+		};
+
+		for(auto it(begin(deltas)); it != end(deltas); )
+		{
+			const auto &key(std::get<delta::KEY>(*it));
+
+			// Find the run of deltas for this key and the last one in the run
+			// which is not a MERGE; that becomes the base for the operands
+			// following it. An SST can only have one entry per key so the
+			// operands are combined here with the column's merge operator.
+			auto end_(std::next(it)), base(end(deltas));
+			for(; end_ != end(deltas); ++end_)
+				if(cmp.Compare(slice(key), slice(std::get<delta::KEY>(*end_))) != 0)
+					break;
+
+			for(auto jt(it); jt != end_; ++jt)
+				if(std::get<delta::OP>(*jt) != op::MERGE)
+					base = jt;
+
+			const auto first(base != end(deltas)? std::next(base) : it);
+			it = end_;
+			if(first == end_)
+			{
+				ingest_write(writer, *std::prev(end_));
+				continue;
+			}
+
+			if(std::next(first) == end_ && base == end(deltas))
+			{
+				ingest_write(writer, *first);
+				continue;
+			}
+
+			if(unlikely(!opts.merge_operator))
+				throw error
+				{
+					"Cannot ingest multiple MERGE for a key in column '%s' without a merge operator",
+					colname,
+				};
+
+			std::vector<rocksdb::Slice> operands;
+			operands.reserve(std::distance(first, end_));
+			for(auto jt(first); jt != end_; ++jt)
+				operands.emplace_back(slice(std::get<delta::VAL>(*jt)));
+
+			std::string merged;
+			if(base != end(deltas))
+			{
+				const bool exists
+				{
+					std::get<delta::OP>(*base) == op::SET
+				};
+
+				const rocksdb::Slice existing
+				{
+					slice(std::get<delta::VAL>(*base))
+				};
+
+				rocksdb::Slice result;
+				const rocksdb::MergeOperator::MergeOperationInput input
+				{
+					slice(key), exists? &existing : nullptr, operands, nullptr
+				};
+
+				rocksdb::MergeOperator::MergeOperationOutput output
+				{
+					merged, result
+				};
+
+				if(unlikely(!opts.merge_operator->FullMergeV2(input, &output)))
+					throw error
+					{
+						"Failed to merge %zu operands for ingest in column '%s'",
+						operands.size(),
+						colname,
+					};
+
+				// The operator may answer with one of the inputs rather than
+				// writing a new value.
+				if(merged.empty() && !result.empty())
+					merged.assign(result.data(), result.size());
+
+				throw_on_error
+				{
+					writer.Put(slice(key), merged)
+				};
+
+				continue;
+			}
+
+			const std::deque<rocksdb::Slice> operand_list
+			{
+				begin(operands), end(operands)
+			};
+
+			if(unlikely(!opts.merge_operator->PartialMergeMulti(slice(key), operand_list, &merged, nullptr)))
+				throw error
+				{
+					"Failed to combine %zu operands for ingest in column '%s'",
+					operand_list.size(),
+					colname,
+				};
+
+			throw_on_error
+			{
+				writer.Merge(slice(key), merged)
+			};
+		}
+
+		rocksdb::ExternalSstFileInfo info;
+		throw_on_error
+		{
+			writer.Finish(&info)
+		};
+
+		rocksdb::IngestExternalFileOptions iopts;
+		iopts.move_files = true;
+		iopts.allow_global_seqno = true;
+		iopts.allow_blocking_flush = true;
+
+		const std::vector<std::string> files
+		{
+			{ std::move(info.file_path) }
+		};
+
+		const std::lock_guard lock{write_mutex};
+		const ctx::uninterruptible::nothrow ui;
+		throw_on_error
+		{
+			d.d->IngestExternalFile(c, files, iopts)
+		};
+	}
+}
+
+void
+ircd::db::ingest_write(rocksdb::SstFileWriter &writer,
+                       const delta &delta)
+{
+	const auto &key(std::get<delta::KEY>(delta));
+	const auto &val(std::get<delta::VAL>(delta));
+	switch(std::get<delta::OP>(delta))
+	{
+		case op::SET:
+			throw_on_error
+			{
+				writer.Put(slice(key), slice(val))
+			};
+			return;
+
+		case op::MERGE:
+			throw_on_error
+			{
+				writer.Merge(slice(key), slice(val))
+			};
+			return;
+
+		case op::DELETE:
+		case op::SINGLE_DELETE:
+			throw_on_error
+			{
+				writer.Delete(slice(key))
+			};
+			return;
+
+		default:
+			assert(0);
+			return;
+	}
+}
+
 void
 ircd::db::del(column &column,
               const std::pair<string_view, string_view> &range,
@@ -7396,6 +8172,135 @@ ircd::db::ticker(const rocksdb::Cache &cache,
 		zero;
 }
 
+ircd::db::cache_admission
+ircd::db::admission(const rocksdb::Cache &cache)
+{
+	// Caches not created by us (e.g. rocksdb's defaults) have no policy.
+	const auto *const c
+	{
+		dynamic_cast<const database::cache *>(&cache)
+	};
+
+	if(!c)
+		return {};
+
+	return
+	{
+		c->admission.admit.load(std::memory_order_relaxed),
+		c->admission.reject.load(std::memory_order_relaxed),
+		c->admission.promote.load(std::memory_order_relaxed),
+		c->admission.aging.load(std::memory_order_relaxed),
+	};
+}
+
+/// Exercises the admission policy's bypass path on a scratch cache. An entry
+/// refused admission must still work through every override taking a handle,
+/// must be invisible to Lookup() and Erase(), and its deleter must run once
+/// on the last Release(). The first failure is logged.
+bool
+ircd::db::cache_check()
+{
+	using Priority = rocksdb::Cache::Priority;
+	using Handle = rocksdb::Cache::Handle;
+
+	if(!size_t(database::cache::admit_freq))
+	{
+		log::error
+		{
+			log, "cache check :admission threshold is zero; nothing is refused."
+		};
+
+		return false;
+	}
+
+	const auto del{[](const rocksdb::Slice &, void *const value)
+	{
+		++*static_cast<size_t *>(value);
+	}};
+
+	database::cache c
+	{
+		nullptr, std::make_shared<database::stats>(), nullptr, "check", 1_KiB, true
+	};
+
+	size_t resident_dels {0}, bypass_dels {0};
+	Handle *resident {nullptr}, *bypass {nullptr};
+	const char *const error{[&]() -> const char *
+	{
+		if(!c.Insert("resident", &resident_dels, 512, del, &resident, Priority::LOW).ok())
+			return "Insert() refused an entry while vacant";
+
+		if(!resident || database::cache::bypassed(resident))
+			return "Insert() returned a bypass handle while vacant";
+
+		if(!c.Insert("bypass", &bypass_dels, 1_KiB, del, &bypass, Priority::LOW).ok())
+			return "Insert() did not return ok for a refused entry";
+
+		if(!database::cache::bypassed(bypass))
+			return "Insert() admitted an infrequent entry while full";
+
+		if(c.Value(bypass) != &bypass_dels)
+			return "Value() of a bypass handle";
+
+		if(c.GetUsage(bypass) != 1_KiB)
+			return "GetUsage() of a bypass handle";
+
+		#ifdef IRCD_DB_HAS_CACHE_GETCHARGE
+		if(c.GetCharge(bypass) != 1_KiB)
+			return "GetCharge() of a bypass handle";
+		#endif
+
+		if(auto *const found{c.Lookup("bypass", nullptr)})
+		{
+			c.Release(found, false);
+			return "Lookup() found a refused entry";
+		}
+
+		c.Erase("bypass");
+		if(bypass_dels)
+			return "Erase() disposed of a refused entry";
+
+		if(!c.Ref(bypass))
+			return "Ref() of a bypass handle";
+
+		if(c.Release(bypass, false) || bypass_dels)
+			return "Release() of a bypass handle with references remaining";
+
+		const bool released
+		{
+			c.Release(bypass, true)
+		};
+
+		bypass = nullptr;
+		if(!released || bypass_dels != 1)
+			return "Release() of the last bypass handle reference";
+
+		return nullptr;
+	}()};
+
+	if(bypass)
+		c.Release(bypass, true);
+
+	if(resident)
+		c.Release(resident, true);
+
+	const char *const failure
+	{
+		error?:
+		resident_dels != 1?
+			"Release() of the resident entry":
+			nullptr
+	};
+
+	if(failure)
+		log::error
+		{
+			log, "cache check :%s", failure
+		};
+
+	return !failure;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // error.h
@@ -41,15 +41,35 @@ struct ircd::db::database::cache final
 	using callback = void (*)(void *, size_t);
 	using Statistics = rocksdb::Statistics;
 
+	struct sketch;
+	struct bypass;
+
 	static const int DEFAULT_SHARD_BITS;
 	static const double DEFAULT_HI_PRIO;
 	static const bool DEFAULT_STRICT;
+	static conf::item<size_t> admit_width;
+	static conf::item<size_t> admit_freq;
+	static conf::item<size_t> promote_freq;
 
 	database *d;
 	std::string name;
 	std::shared_ptr<struct database::stats> stats;
 	std::shared_ptr<struct database::allocator> allocator;
 	std::shared_ptr<rocksdb::Cache> c;
+	std::unique_ptr<struct sketch> sketch;
+
+	// Counters behind db::cache_admission; updated from rocksdb threads.
+	struct
+	{
+		std::atomic<uint64_t> admit {0};
+		std::atomic<uint64_t> reject {0};
+		std::atomic<uint64_t> promote {0};
+		std::atomic<uint64_t> aging {0};
+	}
+	admission;
+
+	static struct bypass *bypassed(Handle *const &) noexcept;
+	Status admit(const Slice &key, void *value, size_t charge, deleter, Handle **, Priority &) noexcept;
 
 	const char *Name() const noexcept override;
 	Status Insert(const Slice &key, void *value, size_t charge, deleter, Handle **, Priority) noexcept override;
@@ -78,11 +98,53 @@ struct ircd::db::database::cache final
 	      std::shared_ptr<struct database::stats>,
 	      std::shared_ptr<struct database::allocator>,
 	      std::string name,
-	      const ssize_t &initial_capacity = -1);
+	      const ssize_t &initial_capacity = -1,
+	      const bool &admit = false);
 
 	~cache() noexcept override;
 };
 
+/// Count-min frequency sketch backing the admission policy. Each
+/// access to a key increments one saturating counter in each row; the
+/// estimate is the minimum over the rows. Counters are halved after a
+/// sample period so the sketch tracks recent rather than all-time
+/// popularity.
+///
+/// The cache is accessed by rocksdb's threads as well as ours, so counters
+/// are relaxed atomics. A lost increment between racing threads only makes
+/// the estimate slightly low, which is tolerable for a sketch.
+struct ircd::db::database::cache::sketch
+{
+	static constexpr const size_t ROWS {4};
+	static constexpr const uint8_t MAX {15};
+
+	size_t mask;
+	std::atomic<size_t> samples {0};
+	size_t sample_max;
+	std::unique_ptr<std::atomic<uint8_t>[]> counter;
+
+	uint8_t estimate(const string_view &key) const noexcept;
+	uint8_t increment(const string_view &key) noexcept;
+	bool age() noexcept;
+
+	sketch(const size_t &width);
+};
+
+/// An entry refused admission which the caller still needs a handle for.
+/// It is never inserted into the underlying cache; the value is owned here
+/// until the last reference is released. Handles to these are tagged in
+/// their low bit to distinguish them from handles of the underlying cache;
+/// every override taking a Handle must test bypassed() before forwarding it
+/// (db::cache_check() exercises each of them).
+struct ircd::db::database::cache::bypass
+{
+	std::string key;
+	void *value;
+	size_t charge;
+	deleter del;
+	size_t refs {1};
+};
+
 struct ircd::db::database::comparator final
 :rocksdb::Comparator
 {
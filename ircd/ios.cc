@@ -134,6 +134,117 @@ ircd::ios::descriptor::default_allocator(handler &handler,
 	return ::operator new(size);
 }
 
+//
+// descriptor pool
+//
+
+namespace ircd::ios
+{
+	struct handler_pool;
+
+	extern thread_local handler_pool handler_pool;
+}
+
+/// Thread-local free lists of handler memory in power-of-two size classes.
+/// Memory returned by the pool_deallocator() is linked through its first
+/// word and handed back out by the pool_allocator() before falling back to
+/// operator new. Requests larger than the largest class are not pooled.
+///
+/// The pool is trivially destructible and the memory on its free lists is
+/// intentionally leaked at thread exit: handlers may still be deallocated
+/// into it while the io_context is torn down after thread_local destruction.
+struct ircd::ios::handler_pool
+{
+	struct node { node *next; };
+
+	static constexpr size_t classes {5};
+	static constexpr size_t class_min {64};
+	static constexpr size_t depth_max {256};
+
+	std::array<node *, classes> head {nullptr};
+	std::array<size_t, classes> depth {0};
+
+	static size_t size_class(const size_t &size) noexcept;
+};
+
+static_assert
+(
+	std::is_trivially_destructible<struct ircd::ios::handler_pool>(),
+	"The handler pool must remain usable during io_context teardown."
+);
+
+decltype(ircd::ios::handler_pool)
+thread_local
+ircd::ios::handler_pool;
+
+size_t
+ircd::ios::handler_pool::size_class(const size_t &size)
+noexcept
+{
+	size_t i(0), cap(class_min);
+	for(; cap < size && i < classes; ++i)
+		cap <<= 1;
+
+	return i;
+}
+
+[[gnu::hot]]
+void
+ircd::ios::descriptor::pool_deallocator(handler &handler,
+                                        void *const &ptr,
+                                        const size_t &size)
+noexcept
+{
+	auto &pool(ios::handler_pool);
+	const auto i
+	{
+		pool.size_class(size)
+	};
+
+	if(unlikely(i >= pool.classes || pool.depth[i] >= pool.depth_max))
+	{
+		::operator delete(ptr);
+		return;
+	}
+
+	auto *const node
+	{
+		reinterpret_cast<handler_pool::node *>(ptr)
+	};
+
+	node->next = pool.head[i];
+	pool.head[i] = node;
+	++pool.depth[i];
+}
+
+[[gnu::hot]]
+void *
+ircd::ios::descriptor::pool_allocator(handler &handler,
+                                      const size_t &size)
+{
+	auto &pool(ios::handler_pool);
+	const auto i
+	{
+		pool.size_class(size)
+	};
+
+	if(unlikely(i >= pool.classes))
+		return ::operator new(size);
+
+	if(likely(pool.head[i]))
+	{
+		assert(handler.descriptor && handler.descriptor->stats);
+		++handler.descriptor->stats->pool_hits;
+
+		auto *const node(pool.head[i]);
+		pool.head[i] = node->next;
+		--pool.depth[i];
+		return node;
+	}
+
+	return ::operator new(pool.class_min << i);
+}
+
 //
 // descriptor::stats
 //
@@ -158,6 +269,7 @@ ircd::ios::descriptor::stats::operator+=(const stats &o)
 	alloc_bytes += o.alloc_bytes;
 	frees += o.frees;
 	free_bytes += o.free_bytes;
+	pool_hits += o.pool_hits;
 	slice_total += o.slice_total;
 	slice_last += o.slice_last;
 	latency_total += o.latency_total;
@@ -347,7 +459,9 @@ ircd::ios::forked_parent()
 decltype(ircd::ios::dispatch_desc)
 ircd::ios::dispatch_desc
 {
-	"ircd::ios dispatch"
+	"ircd::ios dispatch",
+	descriptor::pool_allocator,
+	descriptor::pool_deallocator,
 };
 
 [[gnu::hot]]
@@ -414,8 +528,8 @@ decltype(ircd::ios::defer_desc)
 ircd::ios::defer_desc
 {
 	"ircd::ios defer",
-	descriptor::default_allocator,
-	descriptor::default_deallocator,
+	descriptor::pool_allocator,
+	descriptor::pool_deallocator,
 	true, // continuation
 };
 
@@ -482,7 +596,9 @@ ircd::ios::defer::defer(descriptor &descriptor,
 decltype(ircd::ios::post_desc)
 ircd::ios::post_desc
 {
-	"ircd::ios post"
+	"ircd::ios post",
+	descriptor::pool_allocator,
+	descriptor::pool_deallocator,
 };
 
 [[gnu::hot]]
@@ -76,6 +76,19 @@ ircd::read_only
 	{ "persist",  false                },
 };
 
+/// Coarse mode declaration for a secondary instance. The databases are opened
+/// as followers of a primary instance running on the same files; this implies
+/// read_only. Changes made by the primary are periodically caught up and the
+/// instance only serves requests which make no writes. This item must be set
+/// before ircd::init().
+decltype(ircd::secondary)
+ircd::secondary
+{
+	{ "name",     "ircd.secondary"     },
+	{ "default",  false                },
+	{ "persist",  false                },
+};
+
 /// Coarse mode indicator for debug/developer behavior when and if possible.
 /// For example: additional log messages may be enabled by this mode. This
 /// option is technically effective in both release builds and debug builds
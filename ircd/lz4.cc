@@ -0,0 +1,83 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+#if defined(HAVE_LZ4_H)
+	#include <RB_INC_LZ4_H
+#endif
+
+/// Worst-case size of the compression of an input of this size; zero when
+/// compression is not available.
+size_t
+ircd::lz4::compress_bound(const size_t &size)
+noexcept
+{
+	#if defined(HAVE_LZ4_H)
+		return size <= LZ4_MAX_INPUT_SIZE?
+			::LZ4_compressBound(int(size)):
+			0UL;
+	#else
+		return 0UL;
+	#endif
+}
+
+/// Compress the input into the output. The result is empty when compression
+/// is not available or the output is too small.
+ircd::const_buffer
+ircd::lz4::compress(const mutable_buffer &out,
+                    const const_buffer &in)
+noexcept
+{
+	#if defined(HAVE_LZ4_H)
+		if(unlikely(size(in) > LZ4_MAX_INPUT_SIZE))
+			return {};
+
+		const int ret
+		{
+			::LZ4_compress_default(data(in), data(out), int(size(in)), int(std::min(size(out), size_t(INT_MAX))))
+		};
+
+		return const_buffer
+		{
+			data(out), size_t(std::max(ret, 0))
+		};
+	#else
+		return {};
+	#endif
+}
+
+/// Decompress the input into the output, which must be large enough for
+/// the whole original.
+ircd::const_buffer
+ircd::lz4::decompress(const mutable_buffer &out,
+                      const const_buffer &in)
+{
+	#if defined(HAVE_LZ4_H)
+		const int ret
+		{
+			::LZ4_decompress_safe(data(in), data(out), int(size(in)), int(std::min(size(out), size_t(INT_MAX))))
+		};
+
+		if(unlikely(ret < 0))
+			throw error
+			{
+				"Malformed input or insufficient output buffer (%d)", ret
+			};
+
+		return const_buffer
+		{
+			data(out), size_t(ret)
+		};
+	#else
+		throw error
+		{
+			"Not available in this build."
+		};
+	#endif
+}
@@ -1501,10 +1501,10 @@ try
 {
 	static ios::descriptor desc[4]
 	{
-		{ "ircd::net::socket::wait ready::ANY"   },
-		{ "ircd::net::socket::wait ready::READ"  },
-		{ "ircd::net::socket::wait ready::WRITE" },
-		{ "ircd::net::socket::wait ready::ERROR" },
+		{ "ircd::net::socket::wait ready::ANY",   ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
+		{ "ircd::net::socket::wait ready::READ",  ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
+		{ "ircd::net::socket::wait ready::WRITE", ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
+		{ "ircd::net::socket::wait ready::ERROR", ios::descriptor::pool_allocator, ios::descriptor::pool_deallocator },
 	};
 
 	assert(!fini);
@@ -2495,7 +2495,9 @@ ircd::net::socket::set_timeout(const milliseconds &t,
 
 	static ios::descriptor descriptor
 	{
-		"ircd::net::socket timer"
+		"ircd::net::socket timer",
+		ios::descriptor::pool_allocator,
+		ios::descriptor::pool_deallocator,
 	};
 
 	auto handler
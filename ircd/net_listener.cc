@@ -317,7 +317,12 @@ try
 ,ep
 {
 	make_address(unquote(opts.get("host", "*"_sv))),
-	opts.at<uint16_t>("port")
+
+	// A secondary instance shares the listener configuration of the primary
+	// but binds its own port so read requests can be routed to it.
+	ircd::secondary && opts.has("secondary_port")?
+		opts.at<uint16_t>("secondary_port"):
+		opts.at<uint16_t>("port")
 }
 ,a
 {
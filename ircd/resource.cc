@@ -331,6 +331,48 @@ namespace ircd
 decltype(ircd::resource::method::idle_dock)
 ircd::resource::method::idle_dock;
 
+decltype(ircd::resource::method::admission_enable)
+ircd::resource::method::admission_enable
+{
+	{ "name",     "ircd.resource.admission.enable" },
+	{ "default",  false                            },
+};
+
+decltype(ircd::resource::method::admission_timeout)
+ircd::resource::method::admission_timeout
+{
+	{ "name",     "ircd.resource.admission.timeout" },
+	{ "default",  5000L                             },
+};
+
+decltype(ircd::resource::method::admission_origins_max)
+ircd::resource::method::admission_origins_max
+{
+	{ "name",     "ircd.resource.admission.origins_max" },
+	{ "default",  4096L                                 },
+};
+
+decltype(ircd::resource::method::origin_concurrency_max)
+ircd::resource::method::origin_concurrency_max
+{
+	{ "name",     "ircd.resource.admission.origin.concurrency_max" },
+	{ "default",  0L                                               },
+};
+
+decltype(ircd::resource::method::rate_limited_rate)
+ircd::resource::method::rate_limited_rate
+{
+	{ "name",     "ircd.resource.admission.rate_limited.rate" },
+	{ "default",  10L                                         },
+};
+
+decltype(ircd::resource::method::rate_limited_burst)
+ircd::resource::method::rate_limited_burst
+{
+	{ "name",     "ircd.resource.admission.rate_limited.burst" },
+	{ "default",  30L                                          },
+};
+
 //
 // method::method
 //
@@ -419,11 +461,35 @@ try
 {
 	const unwind on_idle{[this]
 	{
+		admission_dock.notify_one();
 		if(stats->pending == 0)
 			idle_dock.notify_all();
 	}};
 
 	++stats->requests;
+
+	// A secondary instance cannot write so it only serves methods which
+	// declare they make no writes; others must be routed to the primary.
+	if(ircd::secondary && !(opts->flags & flag::READ_ONLY))
+		if(name != "HEAD" && name != "OPTIONS")
+			throw http::error
+			{
+				http::SERVICE_UNAVAILABLE
+			};
+
+	// Admission control is decided from the head alone, before any content
+	// is read or any work (i.e. authentication) is done for the request.
+	const auto origin
+	{
+		admit_origin(client, head)
+	};
+
+	const unwind release{[this, &origin]
+	{
+		admit_release(origin);
+	}};
+
+	admit(client, head);
 	const scope_count pending
 	{
 		stats->pending
@@ -594,6 +660,218 @@ catch(const std::out_of_range &e)
 	};
 }
 
+/// Wait for a slot under the method's concurrency_max. Requests which can't
+/// be admitted before the deadline are shed with a 503.
+void
+ircd::resource::method::admit(const client &client,
+                              const http::request::head &head)
+{
+	if(!opts->concurrency_max || !admission_enable)
+		return;
+
+	if(likely(stats->pending < opts->concurrency_max))
+		return;
+
+	++stats->queued;
+	const milliseconds timeout
+	{
+		admission_timeout
+	};
+
+	const bool admitted
+	{
+		admission_dock.wait_for(timeout, [this]
+		{
+			return stats->pending < opts->concurrency_max;
+		})
+	};
+
+	if(likely(admitted))
+		return;
+
+	++stats->shed;
+	const auto retry_after
+	{
+		std::max(duration_cast<seconds>(timeout).count(), 1L)
+	};
+
+	char buf[24];
+	const http::header headers[]
+	{
+		{ "Retry-After", lex_cast(retry_after, buf) },
+	};
+
+	throw http::error
+	{
+		http::SERVICE_UNAVAILABLE, {}, headers
+	};
+}
+
+/// Find or create the admission state for the request's origin, then
+/// enforce the per-origin concurrency and rate limits. An origin which is
+/// over either limit is refused with a 429. The returned iterator must be
+/// passed to admit_release() when the request leaves the method.
+decltype(ircd::resource::method::origins)::iterator
+ircd::resource::method::admit_origin(const client &client,
+                                     const http::request::head &head)
+{
+	const size_t concurrency_max
+	{
+		opts->origin_concurrency_max?:
+			size_t(origin_concurrency_max)
+	};
+
+	const size_t rate
+	{
+		opts->origin_rate?:
+		opts->flags & RATE_LIMITED?
+			size_t(rate_limited_rate):
+			0UL
+	};
+
+	const size_t burst
+	{
+		std::max(opts->origin_burst?: size_t(rate_limited_burst), 1UL)
+	};
+
+	if(!admission_enable || (!concurrency_max && !rate))
+		return end(origins);
+
+	// The origin is whoever the request claims to be; it is not verified
+	// here. Qualifying it with the remote address prevents one peer from
+	// exhausting the allowance of another by claiming its name.
+	const auto authorization
+	{
+		split(head.authorization, ' ')
+	};
+
+	const string_view claimed
+	{
+		iequals(authorization.first, "X-Matrix"_sv)?
+			unquote(split(split(authorization.second, "origin=").second, ',').first):
+		iequals(authorization.first, "Bearer"_sv)?
+			authorization.second:
+			http::query::string{head.query}["access_token"]
+	};
+
+	char ipbuf[64], keybuf[320];
+	const string_view key
+	{
+		fmt::sprintf
+		{
+			keybuf, "%s %zx",
+			net::string(ipbuf, net::ipaddr(remote(client))),
+			claimed? std::hash<std::string_view>{}(claimed) : 0UL,
+		}
+	};
+
+	const auto now
+	{
+		ircd::now<steady_point>()
+	};
+
+	// The table is kept in order of use; the least recently used origins
+	// are dropped to bound it. Those with requests inside the method are
+	// still referenced and are passed over.
+	const auto idx
+	{
+		origins_index.find(key)
+	};
+
+	auto it
+	{
+		idx != end(origins_index)? idx->second : end(origins)
+	};
+
+	if(it != end(origins))
+		origins.splice(begin(origins), origins, it);
+	else
+	{
+		auto lru(end(origins));
+		for(size_t i(0); origins.size() >= size_t(admission_origins_max) && lru != begin(origins) && i < 8; ++i)
+		{
+			const auto victim(std::prev(lru));
+			if(victim->second.pending)
+			{
+				lru = victim;
+				continue;
+			}
+
+			origins_index.erase(victim->first);
+			origins.erase(victim);
+		}
+
+		origins.emplace_front(std::string{key}, origin
+		{
+			0, int64_t(burst * 1000), now
+		});
+
+		it = begin(origins);
+		origins_index.emplace(it->first, it);
+	}
+
+	auto &origin(it->second);
+	if(concurrency_max && origin.pending >= concurrency_max)
+	{
+		++stats->rejected;
+		static const http::header headers[]
+		{
+			{ "Retry-After", "1" },
+		};
+
+		throw http::error
+		{
+			http::TOO_MANY_REQUESTS, {}, headers
+		};
+	}
+
+	if(rate)
+	{
+		const auto elapsed
+		{
+			duration_cast<milliseconds>(now - origin.last).count()
+		};
+
+		origin.last = now;
+		origin.tokens = std::min(origin.tokens + int64_t(elapsed * rate), int64_t(burst * 1000));
+		if(origin.tokens < 1000)
+		{
+			++stats->rejected;
+			const auto retry_after
+			{
+				std::max((1000 - origin.tokens + int64_t(rate * 1000) - 1) / int64_t(rate * 1000), 1L)
+			};
+
+			char buf[24];
+			const http::header headers[]
+			{
+				{ "Retry-After", lex_cast(retry_after, buf) },
+			};
+
+			throw http::error
+			{
+				http::TOO_MANY_REQUESTS, {}, headers
+			};
+		}
+
+		origin.tokens -= 1000;
+	}
+
+	++origin.pending;
+	return it;
+}
+
+void
+ircd::resource::method::admit_release(decltype(origins)::iterator it)
+noexcept
+{
+	if(it == end(origins))
+		return;
+
+	assert(it->second.pending > 0);
+	--it->second.pending;
+}
+
 void
 ircd::resource::method::handle_timeout(client &client)
 const
@@ -3680,10 +3680,27 @@ ircd::server::tag::read_chunk_dynamic_head(const const_buffer &buffer,
 	state.content_length += state.chunk_length;
 	assert(state.content_read <= state.content_length);
 
+	// The chunks together are bounded like a dynamic content allocation;
+	// there is no truncation here because the length is not known ahead.
+	// Chunks already released by a streaming consumer are not counted.
+	const size_t retained
+	{
+		size_chunks(req.in) + state.chunk_length
+	};
+
+	assert(req.opt);
+	if(unlikely(retained > req.opt->content_length_maxalloc))
+		throw buffer_overrun
+		{
+			"Chunked content exceeds the maximum allocation size:%zu retained:%zu content_length:%zu",
+			req.opt->content_length_maxalloc,
+			retained,
+			state.content_length,
+		};
+
 	// Allocate the chunk content on the vector.
-	//TODO: maxalloc
 	req.in.chunks.emplace_back(state.chunk_length);
-	assert(size_chunks(req.in) == state.content_length);
+	assert(size_chunks(req.in) <= state.content_length);
 
 	// Now we check how much chunk was received beyond the head
 	// state.chunk_read is still 0 here because that's only incremented
@@ -3814,14 +3831,19 @@ ircd::server::chunk_dynamic_content_completed(tag &tag,
 	assert(std::get<0>(chunk) <= std::get<1>(chunk));
 
 	// State sanity tests
-	assert(state.content_length == size_chunks(req.in));
+	assert(state.content_length >= size_chunks(req.in));
 	assert(state.content_length >= state.chunk_length);
 	assert(state.content_length >= state.chunk_read);
 	assert(state.content_read >= state.chunk_length);
 	assert(state.content_read >= state.chunk_read);
 	assert(state.chunk_length >= state.chunk_read);
 	if(state.chunk_length > 0)
+	{
+		if(req.in.chunk)
+			req.in.chunk(chunk);
+
 		return;
+	}
 
 	assert(state.chunk_read == 0);
 	assert(req.opt);
@@ -128,6 +128,9 @@ ircd::m::dbs::init::init(const string_view &servername,
 	room_joined = db::domain{*events, desc::room_joined.name};
 	room_state = db::domain{*events, desc::room_state.name};
 	room_state_space = db::domain{*events, desc::room_state_space.name};
+	room_state_snapshot = db::domain{*events, desc::room_state_snapshot.name};
+	user_mitsein = db::domain{*events, desc::user_mitsein.name};
+	room_member_count = db::domain{*events, desc::room_member_count.name};
 }
 
 /// Shuts down the m::dbs subsystem; closes the events database. The extern
@@ -314,8 +317,17 @@ ircd::m::dbs::_index_room(db::txn &txn,
 		if(opts.appendix.test(appendix::ROOM_STATE_SPACE))
 			_index_room_state_space(txn, event, opts);
 
+		if(opts.appendix.test(appendix::ROOM_STATE_SNAPSHOT))
+			_index_room_state_snapshot(txn, event, opts);
+
 		if(opts.appendix.test(appendix::ROOM_JOINED) && at<"type"_>(event) == "m.room.member")
 			_index_room_joined(txn, event, opts);
+
+		if(opts.appendix.test(appendix::USER_MITSEIN) && at<"type"_>(event) == "m.room.member")
+			_index_user_mitsein(txn, event, opts);
+
+		if(opts.appendix.test(appendix::ROOM_MEMBER_COUNT) && at<"type"_>(event) == "m.room.member")
+			_index_room_member_count(txn, event, opts);
 	}
 
 	if(opts.appendix.test(appendix::ROOM_REDACT) && json::get<"type"_>(event) == "m.room.redaction")
@@ -403,3 +415,88 @@ ircd::m::dbs::find_event_idx(const event::id &event_id,
 
 	return ret;
 }
+
+/// The present state for the key. An earlier event of the interposed txn
+/// is preferred; the entry for the event being written (wopts.event_idx),
+/// made by the room_state indexer into the same txn, is skipped.
+// NOTE: QUERY
+ircd::m::event::idx
+ircd::m::dbs::find_state_idx(const id::room &room_id,
+                             const string_view &type,
+                             const string_view &state_key,
+                             const write_opts &wopts)
+{
+	event::idx ret{0};
+	bool pending{false};
+	if(wopts.interpose)
+	{
+		char buf[ROOM_STATE_KEY_MAX_SIZE];
+		const string_view &key
+		{
+			room_state_key(buf, room_id, type, state_key)
+		};
+
+		db::for_each(*wopts.interpose, db::delta_closure{[&]
+		(const db::delta &delta)
+		{
+			if(std::get<db::delta::COL>(delta) != "_room_state" || std::get<db::delta::KEY>(delta) != key)
+				return;
+
+			const auto &val
+			{
+				std::get<db::delta::VAL>(delta)
+			};
+
+			const bool set
+			{
+				std::get<db::delta::OP>(delta) == db::op::SET && size(val) == sizeof(event::idx)
+			};
+
+			if(set && byte_view<event::idx>(val) == wopts.event_idx)
+				return;
+
+			ret = set? event::idx(byte_view<event::idx>(val)) : 0UL;
+			pending = true;
+		}});
+	}
+
+	if(wopts.allow_queries && !pending)
+		ret = m::room::state{room_id}.get(std::nothrow, type, state_key); // query
+
+	return ret;
+}
+
+/// Finds the last update to the key in a txn which has not been committed.
+/// The value is empty when the update deletes the key.
+bool
+ircd::m::dbs::find_pending(const db::txn &txn,
+                           const string_view &col,
+                           const string_view &key,
+                           string_view &val)
+{
+	bool ret {false};
+	db::for_each(txn, db::delta_closure{[&col, &key, &val, &ret]
+	(const db::delta &delta)
+	{
+		if(std::get<db::delta::COL>(delta) != col || std::get<db::delta::KEY>(delta) != key)
+			return;
+
+		switch(std::get<db::delta::OP>(delta))
+		{
+			case db::op::SET:
+				val = std::get<db::delta::VAL>(delta);
+				ret = true;
+				return;
+
+			case db::op::DELETE:
+				val = {};
+				ret = true;
+				return;
+
+			default:
+				return;
+		}
+	}});
+
+	return ret;
+}
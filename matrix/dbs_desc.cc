@@ -525,10 +525,22 @@ ircd::m::dbs::desc::events
 	// Sequence of all states of the room.
 	room_state_space,
 
+	// (room_id, depth) => (state)
+	// Periodic snapshots of the state of the room.
+	room_state_snapshot,
+
 	// (room_id, event_id) => (event_idx)
 	// Mapping of all current head events for a room.
 	room_head,
 
+	// (user_id, other_id) => (count)
+	// Users sharing PRESENTLY JOINED rooms with a user.
+	user_mitsein,
+
+	// (room_id, membership, host) => (count)
+	// Members of a room counted by PRESENT membership and server.
+	room_member_count,
+
 	//
 	// These columns are legacy; they have been dropped from the schema.
 	//
@@ -58,6 +58,13 @@ ircd::m::dbs::desc::event_json__bloom__bits
 	{ "default",  9L                                  },
 };
 
+decltype(ircd::m::dbs::desc::event_json__cache__admit)
+ircd::m::dbs::desc::event_json__cache__admit
+{
+	{ "name",     "ircd.m.dbs._event_json.cache.admit" },
+	{ "default",  true                                 },
+};
+
 const ircd::db::descriptor
 ircd::m::dbs::desc::event_json
 {
@@ -132,6 +139,9 @@ ircd::m::dbs::desc::event_json
 		{      0L,   15L }, // max_bytes_for_level[5]
 		{      0L,   31L }, // max_bytes_for_level[6]
 	},
+
+	// cache admission policy
+	bool(event_json__cache__admit),
 };
 
 //
@@ -0,0 +1,415 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+decltype(ircd::m::dbs::room_member_count)
+ircd::m::dbs::room_member_count;
+
+decltype(ircd::m::dbs::desc::room_member_count__block__size)
+ircd::m::dbs::desc::room_member_count__block__size
+{
+	{ "name",     "ircd.m.dbs._room_member_count.block.size" },
+	{ "default",  512L                                       },
+};
+
+decltype(ircd::m::dbs::desc::room_member_count__meta_block__size)
+ircd::m::dbs::desc::room_member_count__meta_block__size
+{
+	{ "name",     "ircd.m.dbs._room_member_count.meta_block.size" },
+	{ "default",  long(8_KiB)                                     },
+};
+
+decltype(ircd::m::dbs::desc::room_member_count__cache__size)
+ircd::m::dbs::desc::room_member_count__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs._room_member_count.cache.size" },
+		{ "default",  long(4_MiB)                                },
+	}, []
+	{
+		const size_t &value{room_member_count__cache__size};
+		db::capacity(db::cache(dbs::room_member_count), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::room_member_count__cache_comp__size)
+ircd::m::dbs::desc::room_member_count__cache_comp__size
+{
+	{
+		{ "name",     "ircd.m.dbs._room_member_count.cache_comp.size" },
+		{ "default",  long(4_MiB)                                     },
+	}, []
+	{
+		const size_t &value{room_member_count__cache_comp__size};
+		db::capacity(db::cache_compressed(dbs::room_member_count), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::room_member_count__bloom__bits)
+ircd::m::dbs::desc::room_member_count__bloom__bits
+{
+	{ "name",     "ircd.m.dbs._room_member_count.bloom.bits" },
+	{ "default",  10L                                        },
+};
+
+/// Prefix transform for the room_member_count
+///
+const ircd::db::prefix_transform
+ircd::m::dbs::desc::room_member_count__pfx
+{
+	"_room_member_count",
+
+	[](const string_view &key)
+	{
+		return has(key, "\0"_sv);
+	},
+
+	[](const string_view &key)
+	{
+		return split(key, '\0').first;
+	}
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::room_member_count
+{
+	// name
+	"_room_member_count",
+
+	// explanation
+	R"(Materialized counts of the members of a room by membership.
+
+	[room_id | membership] => count
+	[room_id | membership, host] => count
+
+	Counts reflect the present state of the room. A count which reaches zero
+	is removed. The counts are only read once the marker at the empty key
+	shows the index is complete.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(string_view), typeid(uint64_t)
+	},
+
+	// options
+	{},
+
+	// comparator
+	{},
+
+	// prefix transform
+	room_member_count__pfx,
+
+	// drop column
+	false,
+
+	// cache size
+	bool(cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	bool(cache_comp_enable)? -1 : 0,
+
+	// bloom filter bits
+	size_t(room_member_count__bloom__bits),
+
+	// expect queries hit
+	false,
+
+	// block size
+	size_t(room_member_count__block__size),
+
+	// meta_block size
+	size_t(room_member_count__meta_block__size),
+
+	// compression
+	"kLZ4Compression;kSnappyCompression"s,
+
+	// compactor
+	{},
+
+	// compaction priority algorithm
+	"kOldestSmallestSeqFirst"s,
+};
+
+//
+// indexer
+//
+
+/// Moves the member between counts for a change in the present membership.
+/// Only an event which supersedes the present membership of the user is
+/// considered. Queries are required; the present state and the counts are
+/// read through the interposed txn first.
+void
+ircd::m::dbs::_index_room_member_count(db::txn &txn,
+                                       const event &event,
+                                       const write_opts &opts)
+{
+	assert(opts.appendix.test(appendix::ROOM_MEMBER_COUNT));
+	assert(at<"type"_>(event) == "m.room.member");
+
+	if(!opts.allow_queries)
+		return;
+
+	const m::room::id &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	const m::user::id &user_id
+	{
+		at<"state_key"_>(event)
+	};
+
+	const auto pres_idx
+	{
+		find_state_idx(room_id, "m.room.member", user_id, opts)
+	};
+
+	// A deletion only affects the counts when it removes the present member.
+	if(opts.op == db::op::DELETE && (!pres_idx || pres_idx != opts.event_idx))
+		return;
+
+	if(opts.op == db::op::SET && pres_idx && pres_idx != opts.event_idx)
+		if(m::get<int64_t>(std::nothrow, pres_idx, "depth", 0L) >= json::get<"depth"_>(event))
+			return;
+
+	// The prior membership is that of the present state; when this event is
+	// the present state (i.e. it's being deleted) it is the event's own.
+	char prior_buf[32];
+	const string_view prior
+	{
+		!pres_idx?
+			string_view{}:
+		pres_idx == opts.event_idx?
+			strlcpy(prior_buf, m::membership(event)):
+			m::membership(prior_buf, pres_idx)
+	};
+
+	const string_view membership
+	{
+		opts.op == db::op::SET?
+			m::membership(event):
+			string_view{}
+	};
+
+	if(prior == membership)
+		return;
+
+	if(prior)
+	{
+		_index_room_member_count(txn, opts, room_id, prior, string_view{}, -1L);
+		_index_room_member_count(txn, opts, room_id, prior, user_id.host(), -1L);
+	}
+
+	if(membership)
+	{
+		_index_room_member_count(txn, opts, room_id, membership, string_view{}, 1L);
+		_index_room_member_count(txn, opts, room_id, membership, user_id.host(), 1L);
+	}
+}
+
+void
+ircd::m::dbs::_index_room_member_count(db::txn &txn,
+                                       const write_opts &opts,
+                                       const id::room &room_id,
+                                       const string_view &membership,
+                                       const string_view &host,
+                                       const int64_t &delta)
+{
+	char buf[ROOM_MEMBER_COUNT_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		room_member_count_key(buf, room_id, membership, host)
+	};
+
+	// Counts already moved by this txn are not yet in the database.
+	char valbuf[8];
+	bool found {false};
+	string_view existing;
+	if(find_pending(txn, "_room_member_count", key, existing))
+		found = !empty(existing);
+	else if(opts.interpose && opts.interpose != &txn && find_pending(*opts.interpose, "_room_member_count", key, existing))
+		found = !empty(existing);
+	else
+		existing = db::read(room_member_count, key, found, valbuf);
+
+	const int64_t count
+	{
+		int64_t(found && size(existing) == sizeof(uint64_t)? uint64_t(byte_view<uint64_t>(existing)) : 0UL) + delta
+	};
+
+	const uint64_t value
+	{
+		uint64_t(std::max(count, 0L))
+	};
+
+	db::txn::append
+	{
+		txn, room_member_count,
+		{
+			value? db::op::SET : db::op::DELETE,
+			key,
+			value? byte_view<string_view>(value) : string_view{},
+		}
+	};
+}
+
+//
+// query
+//
+
+/// Reads the count for the membership (and host when given) into the count
+/// argument. An empty membership counts all memberships. False is returned
+/// until the index is built, in which case the count must be found by
+/// iterating the members instead.
+bool
+ircd::m::dbs::room_member_count_get(const id::room &room_id,
+                                    const string_view &membership,
+                                    const string_view &host,
+                                    size_t &count)
+{
+	count = 0;
+	if(!room_member_count_built())
+		return false;
+
+	char buf[ROOM_MEMBER_COUNT_KEY_MAX_SIZE];
+
+	// Without a membership the counts of every membership are summed.
+	if(!membership)
+	{
+		db::domain &index
+		{
+			dbs::room_member_count
+		};
+
+		auto it
+		{
+			index.begin(room_member_count_key(buf, room_id))
+		};
+
+		for(; bool(it); ++it)
+		{
+			const auto &[_membership, _host]
+			{
+				room_member_count_key(it->first)
+			};
+
+			if(_host == host && size(it->second) == sizeof(uint64_t))
+				count += uint64_t(byte_view<uint64_t>(it->second));
+		}
+
+		return true;
+	}
+
+	const string_view &key
+	{
+		room_member_count_key(buf, room_id, membership, host)
+	};
+
+	char valbuf[8];
+	bool found {false};
+	const string_view &value
+	{
+		db::read(dbs::room_member_count, key, found, valbuf)
+	};
+
+	if(found && size(value) == sizeof(uint64_t))
+		count = uint64_t(byte_view<uint64_t>(value));
+
+	return true;
+}
+
+/// The index only answers queries once this is true. The marker is written
+/// for a new database and by a rebuild of every room; an import removes it.
+bool
+ircd::m::dbs::room_member_count_built()
+{
+	return db::has(room_member_count, "\0"_sv);
+}
+
+void
+ircd::m::dbs::room_member_count_built(db::txn &txn,
+                                      const bool &built)
+{
+	static const uint64_t zero {0};
+	db::txn::append
+	{
+		txn, room_member_count,
+		{
+			built? db::op::SET : db::op::DELETE,
+			"\0"_sv,
+			built? byte_view<string_view>(zero) : string_view{},
+		}
+	};
+}
+
+//
+// key
+//
+
+std::tuple<ircd::string_view, ircd::string_view>
+ircd::m::dbs::room_member_count_key(const string_view &amalgam)
+{
+	const auto &key
+	{
+		lstrip(amalgam, '\0')
+	};
+
+	const auto &[membership, host]
+	{
+		split(key, '\0')
+	};
+
+	return
+	{
+		membership, host
+	};
+}
+
+ircd::string_view
+ircd::m::dbs::room_member_count_key(const mutable_buffer &out_,
+                                    const id::room &room_id)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, '\0'));
+	return { data(out_), data(out) };
+}
+
+ircd::string_view
+ircd::m::dbs::room_member_count_key(const mutable_buffer &out_,
+                                    const id::room &room_id,
+                                    const string_view &membership)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, trunc(membership, 32)));
+	return { data(out_), data(out) };
+}
+
+ircd::string_view
+ircd::m::dbs::room_member_count_key(const mutable_buffer &out_,
+                                    const id::room &room_id,
+                                    const string_view &membership,
+                                    const string_view &host)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, trunc(membership, 32)));
+	if(!host)
+		return { data(out_), data(out) };
+
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, trunc(host, event::ORIGIN_MAX_SIZE)));
+	return { data(out_), data(out) };
+}
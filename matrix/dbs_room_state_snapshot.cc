@@ -0,0 +1,1010 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::dbs
+{
+	using room_state_snapshot_state = std::map<std::pair<std::string, std::string>, std::pair<int64_t, event::idx>>;
+
+	static bool room_state_snapshot_chain(const id::room &, int64_t depth, const uint64_t &since, std::vector<std::string> &, int64_t &base);
+	static void room_state_snapshot_apply(const string_view &, const room_state_snapshot_closure &);
+	static void room_state_snapshot_replay(const id::room &, const int64_t &after, const int64_t &until, const room_state_snapshot_closure &);
+	static void room_state_snapshot_merge(room_state_snapshot_state &, const string_view &, const string_view &, const int64_t &, const event::idx &);
+	static void room_state_snapshot_write(db::txn &, const id::room &, const int64_t &, const uint64_t &, const int64_t &, const room_state_snapshot_state &);
+	static bool room_state_snapshot_read(db::txn &, const write_opts &, const string_view &key, std::string &);
+	static void room_state_snapshot_late(db::txn &, const event &, const write_opts &);
+	static bool room_state_snapshot_quiet(const id::room &, const int64_t &depth, const event::idx &since);
+	static void room_state_snapshot_worker();
+
+	extern std::set<std::string, std::less<>> room_state_snapshot_queue;
+	extern ctx::dock room_state_snapshot_dock;
+	extern ctx::context room_state_snapshot_context;
+}
+
+decltype(ircd::m::dbs::room_state_snapshot)
+ircd::m::dbs::room_state_snapshot;
+
+decltype(ircd::m::dbs::room_state_snapshot_interval)
+ircd::m::dbs::room_state_snapshot_interval
+{
+	{ "name",     "ircd.m.dbs._room_state_snapshot.interval" },
+	{ "default",  256L                                       },
+};
+
+/// Rooms whose count of state changes reached the interval; the snapshot is
+/// made by the worker rather than on the eval path.
+decltype(ircd::m::dbs::room_state_snapshot_queue)
+ircd::m::dbs::room_state_snapshot_queue;
+
+decltype(ircd::m::dbs::room_state_snapshot_dock)
+ircd::m::dbs::room_state_snapshot_dock;
+
+decltype(ircd::m::dbs::room_state_snapshot_context)
+ircd::m::dbs::room_state_snapshot_context
+{
+	"m.dbs.snapshot",
+	512_KiB,
+	context::POST,
+	room_state_snapshot_worker,
+};
+
+static const ircd::run::changed
+room_state_snapshot_context_terminate
+{
+	ircd::run::level::QUIT, []
+	{
+		ircd::m::dbs::room_state_snapshot_context.terminate();
+	}
+};
+
+decltype(ircd::m::dbs::desc::room_state_snapshot__block__size)
+ircd::m::dbs::desc::room_state_snapshot__block__size
+{
+	{ "name",     "ircd.m.dbs._room_state_snapshot.block.size" },
+	{ "default",  long(64_KiB)                                 },
+};
+
+decltype(ircd::m::dbs::desc::room_state_snapshot__meta_block__size)
+ircd::m::dbs::desc::room_state_snapshot__meta_block__size
+{
+	{ "name",     "ircd.m.dbs._room_state_snapshot.meta_block.size" },
+	{ "default",  long(8_KiB)                                       },
+};
+
+decltype(ircd::m::dbs::desc::room_state_snapshot__cache__size)
+ircd::m::dbs::desc::room_state_snapshot__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs._room_state_snapshot.cache.size" },
+		{ "default",  long(16_MiB)                                 },
+	}, []
+	{
+		const size_t &value{room_state_snapshot__cache__size};
+		db::capacity(db::cache(dbs::room_state_snapshot), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::room_state_snapshot__cache_comp__size)
+ircd::m::dbs::desc::room_state_snapshot__cache_comp__size
+{
+	{
+		{ "name",     "ircd.m.dbs._room_state_snapshot.cache_comp.size" },
+		{ "default",  long(0_MiB)                                       },
+	}, []
+	{
+		const size_t &value{room_state_snapshot__cache_comp__size};
+		db::capacity(db::cache_compressed(dbs::room_state_snapshot), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::room_state_snapshot__bloom__bits)
+ircd::m::dbs::desc::room_state_snapshot__bloom__bits
+{
+	{ "name",     "ircd.m.dbs._room_state_snapshot.bloom.bits" },
+	{ "default",  0L                                           },
+};
+
+/// Prefix transform for the room_state_snapshot
+///
+const ircd::db::prefix_transform
+ircd::m::dbs::desc::room_state_snapshot__pfx
+{
+	"_room_state_snapshot",
+
+	[](const string_view &key)
+	{
+		return has(key, "\0"_sv);
+	},
+
+	[](const string_view &key)
+	{
+		return split(key, '\0').first;
+	}
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::room_state_snapshot
+{
+	// name
+	"_room_state_snapshot",
+
+	// explanation
+	R"(Periodic snapshots of the state of a room.
+
+	[room_id | depth] => { seq, base, state }
+	[room_id] => count
+
+	Every interval of state changes a snapshot of the state at that depth is
+	made. Snapshots are numbered by seq, and each is only the delta of the
+	state changed since the snapshot numbered seq - (seq & -seq), found at
+	the base depth. The state at any snapshot is thus the union of at most
+	log2(seq) deltas. The depth is stored as (INT64_MAX - depth) big-endian
+	so the newest snapshot sorts first. The key without a depth counts the
+	state changes since the newest snapshot. Snapshots are made by a worker
+	at the depth of the room head; a later change at or below the depth of a
+	snapshot is added to the delta of each snapshot it affects.
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(string_view), typeid(string_view)
+	},
+
+	// options
+	{},
+
+	// comparator
+	{},
+
+	// prefix transform
+	room_state_snapshot__pfx,
+
+	// drop column
+	false,
+
+	// cache size
+	bool(cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	bool(cache_comp_enable)? -1 : 0,
+
+	// bloom filter bits
+	size_t(room_state_snapshot__bloom__bits),
+
+	// expect queries hit
+	false,
+
+	// block size
+	size_t(room_state_snapshot__block__size),
+
+	// meta_block size
+	size_t(room_state_snapshot__meta_block__size),
+
+	// compression
+	"kLZ4Compression;kSnappyCompression"s,
+
+	// compactor
+	{},
+
+	// compaction priority algorithm
+	"kOldestSmallestSeqFirst"s,
+};
+
+//
+// indexer
+//
+
+/// Maintains the snapshots for a change to the state space. A change at or
+/// below the depth of the newest snapshot is applied to the snapshots it
+/// affects; otherwise the change is counted and the room is queued for a
+/// new snapshot when the count reaches the interval. Queries are required.
+void
+ircd::m::dbs::_index_room_state_snapshot(db::txn &txn,
+                                         const event &event,
+                                         const write_opts &opts)
+{
+	assert(opts.appendix.test(appendix::ROOM_STATE_SNAPSHOT));
+
+	const size_t interval
+	{
+		room_state_snapshot_interval
+	};
+
+	if(!opts.allow_queries || !interval)
+		return;
+
+	const m::room::id &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	const int64_t &depth
+	{
+		at<"depth"_>(event)
+	};
+
+	const auto newest
+	{
+		room_state_snapshot_find(room_id)
+	};
+
+	if(newest.first >= depth)
+		room_state_snapshot_late(txn, event, opts);
+
+	if(opts.op != db::op::SET)
+		return;
+
+	// The counter is read through the txn; several state changes to the
+	// room may be pending in it.
+	char buf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+	const string_view &counter_key
+	{
+		room_state_snapshot_key(buf, room_id)
+	};
+
+	std::string existing;
+	room_state_snapshot_read(txn, opts, counter_key, existing);
+	const uint64_t count
+	{
+		(size(existing) == sizeof(uint64_t)? uint64_t(byte_view<uint64_t>(string_view{existing})) : 0UL) + 1
+	};
+
+	db::txn::append
+	{
+		txn, room_state_snapshot,
+		{
+			db::op::SET,
+			counter_key,
+			byte_view<string_view>(count),
+		}
+	};
+
+	if(count < interval)
+		return;
+
+	auto it
+	{
+		room_state_snapshot_queue.lower_bound(room_id)
+	};
+
+	if(it == end(room_state_snapshot_queue) || *it != room_id)
+	{
+		room_state_snapshot_queue.emplace_hint(it, room_id);
+		room_state_snapshot_dock.notify_one();
+	}
+}
+
+/// A change at or below the newest snapshot affects the snapshots from its
+/// depth up to the next newer entry of the same (type, state_key); above
+/// that the newer entry supersedes it. A state entry is added to each of
+/// those snapshots since readers take the greatest (depth, event_idx). The
+/// removal of an entry can't be added; every snapshot from its depth up is
+/// dropped.
+void
+ircd::m::dbs::room_state_snapshot_late(db::txn &txn,
+                                       const event &event,
+                                       const write_opts &opts)
+{
+	const m::room::id &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	const string_view &type
+	{
+		at<"type"_>(event)
+	};
+
+	const string_view &state_key
+	{
+		at<"state_key"_>(event)
+	};
+
+	const int64_t &depth
+	{
+		at<"depth"_>(event)
+	};
+
+	const std::pair<int64_t, event::idx> entry
+	{
+		depth, opts.event_idx
+	};
+
+	char keybuf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+	if(opts.op != db::op::SET)
+	{
+		for(auto it(room_state_snapshot.begin(room_state_snapshot_key(keybuf, room_id))); bool(it); ++it)
+		{
+			const int64_t _depth
+			{
+				room_state_snapshot_key(it->first)
+			};
+
+			if(_depth < 0)
+				continue;
+
+			if(_depth < depth)
+				break;
+
+			db::txn::append
+			{
+				txn, room_state_snapshot,
+				{
+					db::op::DELETE,
+					room_state_snapshot_key(keybuf, room_id, _depth),
+				}
+			};
+		}
+
+		return;
+	}
+
+	int64_t superseded
+	{
+		std::numeric_limits<int64_t>::max()
+	};
+
+	char buf[ROOM_STATE_SPACE_KEY_MAX_SIZE];
+	for(auto it(room_state_space.begin(room_state_space_key(buf, room_id, type, state_key))); bool(it); ++it)
+	{
+		const auto &[_type, _state_key, _depth, _event_idx]
+		{
+			room_state_space_key(it->first)
+		};
+
+		if(_type != type || _state_key != state_key)
+			break;
+
+		if(std::make_pair(_depth, _event_idx) <= entry)
+			break;
+
+		superseded = _depth;
+	}
+
+	if(superseded <= depth)
+		return;
+
+	std::vector<int64_t> affected;
+	for(auto it(room_state_snapshot.begin(room_state_snapshot_key(keybuf, room_id, superseded - 1))); bool(it); ++it)
+	{
+		const int64_t _depth
+		{
+			room_state_snapshot_key(it->first)
+		};
+
+		if(_depth < 0)
+			continue;
+
+		if(_depth < depth)
+			break;
+
+		affected.emplace_back(_depth);
+	}
+
+	for(const auto &_depth : affected)
+	{
+		std::string value;
+		if(!room_state_snapshot_read(txn, opts, room_state_snapshot_key(keybuf, room_id, _depth), value))
+			continue;
+
+		room_state_snapshot_state state;
+		room_state_snapshot_apply(value, [&state]
+		(const string_view &type, const string_view &state_key, const int64_t &depth, const event::idx &event_idx)
+		{
+			room_state_snapshot_merge(state, type, state_key, depth, event_idx);
+		});
+
+		room_state_snapshot_merge(state, type, state_key, depth, opts.event_idx);
+
+		const json::object object
+		{
+			value
+		};
+
+		room_state_snapshot_write(txn, room_id, _depth, object.get<uint64_t>("seq", 0UL), object.get<int64_t>("base", -1L), state);
+	}
+}
+
+/// Reads the value of the key as pending in the txn, or the interposed
+/// txn, or as written. False when it is absent.
+bool
+ircd::m::dbs::room_state_snapshot_read(db::txn &txn,
+                                       const write_opts &opts,
+                                       const string_view &key,
+                                       std::string &out)
+{
+	string_view val;
+	const bool pending
+	{
+		find_pending(txn, "_room_state_snapshot", key, val) ||
+		(opts.interpose && opts.interpose != &txn && find_pending(*opts.interpose, "_room_state_snapshot", key, val))
+	};
+
+	if(pending)
+	{
+		out = val;
+		return !empty(val);
+	}
+
+	bool found {false};
+	out = db::read(room_state_snapshot, key, found);
+	return found;
+}
+
+//
+// worker
+//
+
+void
+ircd::m::dbs::room_state_snapshot_worker()
+try
+{
+	vm::dock.wait([]
+	{
+		return vm::ready;
+	});
+
+	while(1)
+	{
+		room_state_snapshot_dock.wait([]
+		{
+			return !room_state_snapshot_queue.empty();
+		});
+
+		const std::string room_id
+		{
+			std::move(room_state_snapshot_queue.extract(begin(room_state_snapshot_queue)).value())
+		};
+
+		try
+		{
+			room_state_snapshot_make(m::room::id{room_id});
+		}
+		catch(const ctx::interrupted &)
+		{
+			throw;
+		}
+		catch(const std::exception &e)
+		{
+			log::error
+			{
+				log, "Snapshot of room state in %s :%s",
+				room_id,
+				e.what(),
+			};
+		}
+	}
+}
+catch(const ctx::terminated &)
+{
+	log::debug
+	{
+		log, "Room state snapshot worker terminated with %zu queued",
+		room_state_snapshot_queue.size(),
+	};
+}
+
+/// Makes a snapshot of the room state at the depth of the room head. The
+/// snapshot is made without holding evaluation; when a state change at or
+/// below that depth was written meanwhile without seeing the snapshot, the
+/// snapshot is removed and made again. False if no snapshot was made.
+bool
+ircd::m::dbs::room_state_snapshot_make(const id::room &room_id)
+{
+	static const size_t attempts_max
+	{
+		8
+	};
+
+	for(size_t attempt(1); attempt <= attempts_max; ++attempt)
+	{
+		const event::idx since
+		{
+			vm::sequence::retired
+		};
+
+		const int64_t depth
+		{
+			m::depth(std::nothrow, room_id)
+		};
+
+		const auto newest
+		{
+			room_state_snapshot_find(room_id)
+		};
+
+		if(depth < 0 || depth <= newest.first)
+			return false;
+
+		room_state_snapshot_state state;
+		const auto merge{[&state]
+		(const string_view &type, const string_view &state_key, const int64_t &depth, const event::idx &event_idx)
+		{
+			room_state_snapshot_merge(state, type, state_key, depth, event_idx);
+		}};
+
+		// A chain broken by dropped snapshots starts again from a root, which
+		// is numbered by the next power of two.
+		int64_t base(-1);
+		uint64_t seq(newest.second + 1);
+		std::vector<std::string> chain;
+		if(seq - (seq & -seq) && !room_state_snapshot_chain(room_id, newest.first, seq - (seq & -seq), chain, base))
+		{
+			seq = 1UL << (64 - __builtin_clzl(newest.second));
+			chain.clear();
+			base = -1;
+		}
+
+		if(!(seq - (seq & -seq)))
+		{
+			// The root of a chain is the whole state; the history query finds
+			// it from the existing snapshots (or the state space).
+			const m::room::state::history history
+			{
+				m::room{room_id}, depth + 1
+			};
+
+			history.for_each([&merge]
+			(const auto &type, const auto &state_key, const auto &depth, const auto &event_idx)
+			{
+				merge(type, state_key, depth, event_idx);
+				return true;
+			});
+		}
+		else
+		{
+			std::for_each(rbegin(chain), rend(chain), [&merge]
+			(const auto &value)
+			{
+				room_state_snapshot_apply(value, merge);
+			});
+
+			room_state_snapshot_replay(room_id, newest.first, depth, merge);
+		}
+
+		char buf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+		db::txn txn
+		{
+			*dbs::events
+		};
+
+		room_state_snapshot_write(txn, room_id, depth, seq, base, state);
+		db::txn::append
+		{
+			txn, room_state_snapshot,
+			{
+				db::op::DELETE,
+				room_state_snapshot_key(buf, room_id),
+			}
+		};
+
+		txn();
+		if(room_state_snapshot_quiet(room_id, depth, since))
+			return true;
+
+		// The newest snapshot is in no other chain; it is removed alone.
+		db::txn undo
+		{
+			*dbs::events
+		};
+
+		db::txn::append
+		{
+			undo, room_state_snapshot,
+			{
+				db::op::DELETE,
+				room_state_snapshot_key(buf, room_id, depth),
+			}
+		};
+
+		undo();
+		ctx::sleep(milliseconds(attempt * 250));
+	}
+
+	log::derror
+	{
+		log, "Snapshot of room state in %s abandoned; room remained busy after %zu attempts.",
+		string_view{room_id},
+		attempts_max,
+	};
+
+	return false;
+}
+
+/// Whether no state change of the room at or below the depth was written
+/// after the sequence since, and none is being evaluated.
+bool
+ircd::m::dbs::room_state_snapshot_quiet(const id::room &room_id,
+                                        const int64_t &depth,
+                                        const event::idx &since)
+{
+	const bool busy
+	{
+		!vm::eval::for_each([&room_id, &depth]
+		(const vm::eval &eval)
+		{
+			return
+				eval.room_id != room_id ||
+				eval.phase < vm::phase::INDEX ||
+				eval.phase > vm::phase::RETIRE ||
+				!eval.event_ ||
+				!defined(json::get<"state_key"_>(*eval.event_)) ||
+				json::get<"depth"_>(*eval.event_) > depth;
+		})
+	};
+
+	if(busy)
+		return false;
+
+	// Too many written since to check individually.
+	if(vm::sequence::retired - since > 64_KiB)
+		return false;
+
+	char buf[m::id::MAX_SIZE];
+	for(auto idx(since + 1); idx <= vm::sequence::retired; ++idx)
+	{
+		if(m::get(std::nothrow, idx, "room_id", buf) != room_id)
+			continue;
+
+		if(!m::room::state::is(std::nothrow, idx))
+			continue;
+
+		if(m::get<int64_t>(std::nothrow, idx, "depth", -1L) <= depth)
+			return false;
+	}
+
+	return true;
+}
+
+void
+ircd::m::dbs::room_state_snapshot_write(db::txn &txn,
+                                        const id::room &room_id,
+                                        const int64_t &depth,
+                                        const uint64_t &seq,
+                                        const int64_t &base,
+                                        const room_state_snapshot_state &state)
+{
+	// Worst-case for every character requiring a \u escape.
+	const size_t reserve
+	{
+		std::accumulate(begin(state), end(state), size_t(64), []
+		(const size_t &ret, const auto &kv)
+		{
+			return ret + 64 + 6 * (size(kv.first.first) + size(kv.first.second));
+		})
+	};
+
+	const unique_mutable_buffer buf
+	{
+		reserve
+	};
+
+	json::stack out{buf};
+	{
+		json::stack::object top{out};
+		json::stack::member
+		{
+			top, "seq", json::value{long(seq)}
+		};
+
+		json::stack::member
+		{
+			top, "base", json::value{long(base)}
+		};
+
+		json::stack::array array
+		{
+			top, "state"
+		};
+
+		for(const auto &[key, val] : state)
+		{
+			json::stack::array entry{array};
+			entry.append(json::value{key.first});
+			entry.append(json::value{key.second});
+			entry.append(json::value{long(val.first)});
+			entry.append(json::value{long(val.second)});
+		}
+	}
+
+	char keybuf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+	db::txn::append
+	{
+		txn, room_state_snapshot,
+		{
+			db::op::SET,
+			room_state_snapshot_key(keybuf, room_id, depth),
+			out.completed(),
+		}
+	};
+}
+
+void
+ircd::m::dbs::room_state_snapshot_merge(room_state_snapshot_state &state,
+                                        const string_view &type,
+                                        const string_view &state_key,
+                                        const int64_t &depth,
+                                        const event::idx &event_idx)
+{
+	const std::pair<int64_t, event::idx> val
+	{
+		depth, event_idx
+	};
+
+	auto it
+	{
+		state.try_emplace({std::string{type}, std::string{state_key}}, val)
+	};
+
+	if(!it.second && it.first->second < val)
+		it.first->second = val;
+}
+
+//
+// query
+//
+
+/// Clears all snapshots of the room; for use with a rebuild of the space.
+void
+ircd::m::dbs::room_state_snapshot_clear(db::txn &txn,
+                                        const id::room &room_id)
+{
+	char buf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+	auto it
+	{
+		room_state_snapshot.begin(room_state_snapshot_key(buf, room_id))
+	};
+
+	for(; bool(it); ++it)
+	{
+		const int64_t depth
+		{
+			room_state_snapshot_key(it->first)
+		};
+
+		db::txn::append
+		{
+			txn, room_state_snapshot,
+			{
+				db::op::DELETE,
+				depth < 0?
+					room_state_snapshot_key(buf, room_id):
+					room_state_snapshot_key(buf, room_id, depth),
+			}
+		};
+	}
+}
+
+/// Visits the state at the snapshot found at the depth, followed by the
+/// state changes after it up through the depth until (inclusive). The state
+/// is the greatest (depth, event_idx) visited for each (type, state_key);
+/// entries may be visited more than once. False is returned when there is
+/// no snapshot at the depth or its chain is incomplete.
+bool
+ircd::m::dbs::room_state_snapshot_for_each(const id::room &room_id,
+                                           const int64_t &depth,
+                                           const int64_t &until,
+                                           const room_state_snapshot_closure &closure)
+{
+	int64_t base(-1);
+	std::vector<std::string> chain;
+	if(!room_state_snapshot_chain(room_id, depth, 0UL, chain, base))
+		return false;
+
+	std::for_each(rbegin(chain), rend(chain), [&closure]
+	(const auto &value)
+	{
+		room_state_snapshot_apply(value, closure);
+	});
+
+	room_state_snapshot_replay(room_id, depth, until, closure);
+	return true;
+}
+
+/// Finds the depth and seq of the newest snapshot below the depth, or of the
+/// newest snapshot when below is negative. The depth is -1 when not found.
+std::pair<int64_t, uint64_t>
+ircd::m::dbs::room_state_snapshot_find(const id::room &room_id,
+                                       const int64_t &below)
+{
+	if(below == 0)
+		return { -1L, 0UL };
+
+	char buf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		below > 0?
+			room_state_snapshot_key(buf, room_id, below - 1):
+			room_state_snapshot_key(buf, room_id)
+	};
+
+	auto it
+	{
+		room_state_snapshot.begin(key)
+	};
+
+	for(; bool(it); ++it)
+	{
+		const int64_t depth
+		{
+			room_state_snapshot_key(it->first)
+		};
+
+		if(depth < 0)
+			continue;
+
+		const json::object value
+		{
+			it->second
+		};
+
+		return
+		{
+			depth, value.get<uint64_t>("seq", 0UL)
+		};
+	}
+
+	return { -1L, 0UL };
+}
+
+/// Collects the snapshot at the depth and its bases while their seq is
+/// greater than since, newest first. The base out argument is the depth
+/// where the chain stopped, or -1 at the root.
+bool
+ircd::m::dbs::room_state_snapshot_chain(const id::room &room_id,
+                                        int64_t depth,
+                                        const uint64_t &since,
+                                        std::vector<std::string> &chain,
+                                        int64_t &base)
+{
+	char buf[ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+	while(depth >= 0)
+	{
+		auto it
+		{
+			room_state_snapshot.begin(room_state_snapshot_key(buf, room_id, depth))
+		};
+
+		if(!bool(it) || room_state_snapshot_key(it->first) != depth)
+			return false;
+
+		const json::object value
+		{
+			it->second
+		};
+
+		if(value.get<uint64_t>("seq", 0UL) <= since)
+			break;
+
+		chain.emplace_back(it->second);
+		depth = value.get<int64_t>("base", -1L);
+	}
+
+	base = depth;
+	return true;
+}
+
+void
+ircd::m::dbs::room_state_snapshot_apply(const string_view &value,
+                                        const room_state_snapshot_closure &closure)
+{
+	char type_buf[event::TYPE_MAX_SIZE];
+	char state_key_buf[event::STATE_KEY_MAX_SIZE];
+	const json::array state
+	{
+		json::object{value}["state"]
+	};
+
+	for(const json::array entry : state)
+	{
+		const string_view type
+		{
+			json::unescape(type_buf, json::string(entry.at(0)))
+		};
+
+		const string_view state_key
+		{
+			json::unescape(state_key_buf, json::string(entry.at(1)))
+		};
+
+		closure(type, state_key, entry.at<int64_t>(2), entry.at<event::idx>(3));
+	}
+}
+
+/// Visits the newest entry of the state space for each (type, state_key)
+/// of the room with depth in (after, until]. Entries are seeked over rather
+/// than iterated, so the cost follows the number of keys in the state and
+/// not the length of the timeline; entries are visited in key order.
+void
+ircd::m::dbs::room_state_snapshot_replay(const id::room &room_id,
+                                         const int64_t &after,
+                                         const int64_t &until,
+                                         const room_state_snapshot_closure &closure)
+{
+	char buf[ROOM_STATE_SPACE_KEY_MAX_SIZE];
+	auto it
+	{
+		room_state_space.begin(room_state_space_key(buf, room_id))
+	};
+
+	while(bool(it))
+	{
+		const auto &[type, state_key, depth, event_idx]
+		{
+			room_state_space_key(it->first)
+		};
+
+		// Depth and event_idx sort descending; seek to the newest entry of
+		// this (type, state_key) at or below the bound.
+		if(depth > until)
+		{
+			seek(it, room_state_space_key(buf, room_id, type, state_key, until, -1UL));
+			continue;
+		}
+
+		if(depth > after)
+			closure(type, state_key, depth, event_idx);
+
+		// The lowest key of this (type, state_key) follows all of its entries.
+		seek(it, room_state_space_key(buf, room_id, type, state_key, 0L, 0UL));
+	}
+}
+
+//
+// key
+//
+
+int64_t
+ircd::m::dbs::room_state_snapshot_key(const string_view &amalgam)
+{
+	// The room_id can't contain the separator; the depth may.
+	const auto &depth
+	{
+		split(amalgam, '\0').second
+	};
+
+	if(size(depth) != sizeof(int64_t))
+		return -1L;
+
+	const uint64_t inverse
+	{
+		ntoh(uint64_t(byte_view<uint64_t>(depth)))
+	};
+
+	return std::numeric_limits<int64_t>::max() - int64_t(inverse);
+}
+
+ircd::string_view
+ircd::m::dbs::room_state_snapshot_key(const mutable_buffer &out_,
+                                      const id::room &room_id)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, '\0'));
+	return { data(out_), data(out) };
+}
+
+ircd::string_view
+ircd::m::dbs::room_state_snapshot_key(const mutable_buffer &out_,
+                                      const id::room &room_id,
+                                      const int64_t &depth)
+{
+	assert(depth >= 0);
+	const uint64_t inverse
+	{
+		hton(uint64_t(std::numeric_limits<int64_t>::max() - depth))
+	};
+
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, byte_view<string_view>(inverse)));
+	return { data(out_), data(out) };
+}
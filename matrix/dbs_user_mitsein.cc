@@ -0,0 +1,543 @@
+// The Construct
+//
+// Copyright (C) The Construct Developers, Authors & Contributors
+// Copyright (C) 2016-2020 Jason Volk <jason@zemos.net>
+//
+// Permission to use, copy, modify, and/or distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice is present in all copies. The
+// full license for this software is available in the LICENSE file.
+
+namespace ircd::m::dbs
+{
+	using user_mitsein_deltas = std::map<std::string, int64_t, std::less<>>;
+
+	static void _index_user_mitsein_pair(user_mitsein_deltas &, const id::user &, const id::user &, const int64_t &);
+	static void _index_user_mitsein_pairs(user_mitsein_deltas &, const std::vector<std::string> &, const int64_t &);
+	static void _index_user_mitsein_apply(db::txn &, const write_opts &, const user_mitsein_deltas &);
+	static bool _index_user_mitsein_large(db::txn &, const write_opts &, const id::room &);
+}
+
+decltype(ircd::m::dbs::user_mitsein)
+ircd::m::dbs::user_mitsein;
+
+/// Rooms with more joined members than this are not indexed pairwise; their
+/// members are enumerated directly instead. The cost of indexing a room is
+/// quadratic in its size. A room is indexed again once it shrinks to half.
+decltype(ircd::m::dbs::user_mitsein_room_max)
+ircd::m::dbs::user_mitsein_room_max
+{
+	{ "name",     "ircd.m.dbs._user_mitsein.room_max" },
+	{ "default",  1024L                               },
+};
+
+decltype(ircd::m::dbs::desc::user_mitsein__block__size)
+ircd::m::dbs::desc::user_mitsein__block__size
+{
+	{ "name",     "ircd.m.dbs._user_mitsein.block.size" },
+	{ "default",  512L                                  },
+};
+
+decltype(ircd::m::dbs::desc::user_mitsein__meta_block__size)
+ircd::m::dbs::desc::user_mitsein__meta_block__size
+{
+	{ "name",     "ircd.m.dbs._user_mitsein.meta_block.size" },
+	{ "default",  long(8_KiB)                                },
+};
+
+decltype(ircd::m::dbs::desc::user_mitsein__cache__size)
+ircd::m::dbs::desc::user_mitsein__cache__size
+{
+	{
+		{ "name",     "ircd.m.dbs._user_mitsein.cache.size" },
+		{ "default",  long(8_MiB)                           },
+	}, []
+	{
+		const size_t &value{user_mitsein__cache__size};
+		db::capacity(db::cache(dbs::user_mitsein), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::user_mitsein__cache_comp__size)
+ircd::m::dbs::desc::user_mitsein__cache_comp__size
+{
+	{
+		{ "name",     "ircd.m.dbs._user_mitsein.cache_comp.size" },
+		{ "default",  long(8_MiB)                                },
+	}, []
+	{
+		const size_t &value{user_mitsein__cache_comp__size};
+		db::capacity(db::cache_compressed(dbs::user_mitsein), value);
+	}
+};
+
+decltype(ircd::m::dbs::desc::user_mitsein__bloom__bits)
+ircd::m::dbs::desc::user_mitsein__bloom__bits
+{
+	{ "name",     "ircd.m.dbs._user_mitsein.bloom.bits" },
+	{ "default",  10L                                   },
+};
+
+/// Prefix transform for the user_mitsein
+///
+const ircd::db::prefix_transform
+ircd::m::dbs::desc::user_mitsein__pfx
+{
+	"_user_mitsein",
+
+	[](const string_view &key)
+	{
+		return has(key, "\0"_sv);
+	},
+
+	[](const string_view &key)
+	{
+		return split(key, '\0').first;
+	}
+};
+
+const ircd::db::descriptor
+ircd::m::dbs::desc::user_mitsein
+{
+	// name
+	"_user_mitsein",
+
+	// explanation
+	R"(Materialized index of users sharing a joined room with a user.
+
+	[user_id | other_id] => count of common rooms
+
+	Each pair is present in both directions and a user is paired with itself.
+	Rooms too large to index are marked with an empty prefix instead.
+
+	[\0 room_id] => 0
+
+	The index is not consulted until it is marked complete.
+
+	[\0] => 0
+
+	)",
+
+	// typing (key, value)
+	{
+		typeid(string_view), typeid(uint64_t)
+	},
+
+	// options
+	{},
+
+	// comparator
+	{},
+
+	// prefix transform
+	user_mitsein__pfx,
+
+	// drop column
+	false,
+
+	// cache size
+	bool(cache_enable)? -1 : 0,
+
+	// cache size for compressed assets
+	bool(cache_comp_enable)? -1 : 0,
+
+	// bloom filter bits
+	size_t(user_mitsein__bloom__bits),
+
+	// expect queries hit
+	false,
+
+	// block size
+	size_t(user_mitsein__block__size),
+
+	// meta_block size
+	size_t(user_mitsein__meta_block__size),
+
+	// compression
+	"kLZ4Compression;kSnappyCompression"s,
+
+	// compactor
+	{},
+
+	// compaction priority algorithm
+	"kOldestSmallestSeqFirst"s,
+};
+
+//
+// indexer
+//
+
+/// Adjusts the pair counts for a change in joined membership. Only a
+/// transition to or from join which supersedes the present membership of the
+/// user, or the removal of the present membership, is considered. Queries
+/// are required; the present state and the counts are read through the txn
+/// and the interposed txn first.
+void
+ircd::m::dbs::_index_user_mitsein(db::txn &txn,
+                                  const event &event,
+                                  const write_opts &opts)
+{
+	assert(opts.appendix.test(appendix::USER_MITSEIN));
+	assert(at<"type"_>(event) == "m.room.member");
+
+	if(!opts.allow_queries)
+		return;
+
+	const m::room room
+	{
+		at<"room_id"_>(event)
+	};
+
+	const m::user::id &user_id
+	{
+		at<"state_key"_>(event)
+	};
+
+	const auto pres_idx
+	{
+		find_state_idx(room.room_id, "m.room.member", user_id, opts)
+	};
+
+	// A deletion only affects the counts when it removes the present member.
+	if(opts.op == db::op::DELETE && (!pres_idx || pres_idx != opts.event_idx))
+		return;
+
+	if(opts.op == db::op::SET && pres_idx && pres_idx != opts.event_idx)
+		if(m::get<int64_t>(std::nothrow, pres_idx, "depth", 0L) >= json::get<"depth"_>(event))
+			return;
+
+	const bool joined
+	{
+		opts.op == db::op::SET && m::membership(event) == "join"
+	};
+
+	const bool joined_prior
+	{
+		pres_idx && m::membership(pres_idx, "join")
+	};
+
+	if(joined == joined_prior)
+		return;
+
+	// The joined members other than this user; the member list does not
+	// yet reflect this event.
+	const m::room::members members
+	{
+		room
+	};
+
+	std::vector<std::string> others;
+	members.for_each("join", [&others, &user_id]
+	(const m::user::id &other)
+	{
+		if(other != user_id)
+			others.emplace_back(other);
+
+		return true;
+	});
+
+	char buf[USER_MITSEIN_KEY_MAX_SIZE];
+	const string_view &room_key
+	{
+		user_mitsein_room_key(buf, room.room_id)
+	};
+
+	user_mitsein_deltas deltas;
+	static const uint64_t zero {0};
+	if(_index_user_mitsein_large(txn, opts, room.room_id))
+	{
+		// A room which shrank to half of the limit is indexed again.
+		if(joined || others.size() > size_t(user_mitsein_room_max) / 2)
+			return;
+
+		_index_user_mitsein_pairs(deltas, others, 1L);
+		_index_user_mitsein_apply(txn, opts, deltas);
+		db::txn::append
+		{
+			txn, user_mitsein,
+			{
+				db::op::DELETE,
+				room_key,
+			}
+		};
+
+		log::info
+		{
+			log, "Room %s has %zu members; included in user_mitsein again.",
+			string_view{room.room_id},
+			others.size(),
+		};
+
+		return;
+	}
+
+	// The room is about to exceed the limit; retract it from the index.
+	if(joined && others.size() + 1 > size_t(user_mitsein_room_max))
+	{
+		_index_user_mitsein_pairs(deltas, others, -1L);
+		_index_user_mitsein_apply(txn, opts, deltas);
+		db::txn::append
+		{
+			txn, user_mitsein,
+			{
+				db::op::SET,
+				room_key,
+				byte_view<string_view>(zero),
+			}
+		};
+
+		log::info
+		{
+			log, "Room %s exceeds %zu members; excluded from user_mitsein.",
+			string_view{room.room_id},
+			size_t(user_mitsein_room_max),
+		};
+
+		return;
+	}
+
+	const int64_t delta
+	{
+		joined? 1L : -1L
+	};
+
+	_index_user_mitsein_pair(deltas, user_id, user_id, delta);
+	for(const auto &other : others)
+	{
+		_index_user_mitsein_pair(deltas, user_id, m::user::id{other}, delta);
+		_index_user_mitsein_pair(deltas, m::user::id{other}, user_id, delta);
+	}
+
+	_index_user_mitsein_apply(txn, opts, deltas);
+}
+
+/// Whether the room is marked too large to index, including by a pending
+/// txn.
+bool
+ircd::m::dbs::_index_user_mitsein_large(db::txn &txn,
+                                        const write_opts &opts,
+                                        const id::room &room_id)
+{
+	char buf[USER_MITSEIN_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		user_mitsein_room_key(buf, room_id)
+	};
+
+	string_view val;
+	if(find_pending(txn, "_user_mitsein", key, val))
+		return !empty(val);
+
+	if(opts.interpose && opts.interpose != &txn)
+		if(find_pending(*opts.interpose, "_user_mitsein", key, val))
+			return !empty(val);
+
+	return db::has(user_mitsein, key);
+}
+
+/// Every pair of the members, including each member with itself.
+void
+ircd::m::dbs::_index_user_mitsein_pairs(user_mitsein_deltas &deltas,
+                                        const std::vector<std::string> &members,
+                                        const int64_t &delta)
+{
+	for(const auto &a : members)
+		for(const auto &b : members)
+			_index_user_mitsein_pair(deltas, m::user::id{a}, m::user::id{b}, delta);
+}
+
+void
+ircd::m::dbs::_index_user_mitsein_pair(user_mitsein_deltas &deltas,
+                                       const id::user &user_id,
+                                       const id::user &other,
+                                       const int64_t &delta)
+{
+	char buf[USER_MITSEIN_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		user_mitsein_key(buf, user_id, other)
+	};
+
+	auto it
+	{
+		deltas.lower_bound(key)
+	};
+
+	if(it == end(deltas) || it->first != key)
+		it = deltas.emplace_hint(it, std::string{key}, 0L);
+
+	it->second += delta;
+}
+
+/// Applies the deltas to the counts. Counts already changed by the txn (or
+/// the interposed txn) are not yet in the database; both are scanned once.
+void
+ircd::m::dbs::_index_user_mitsein_apply(db::txn &txn,
+                                        const write_opts &opts,
+                                        const user_mitsein_deltas &deltas)
+{
+	std::map<string_view, uint64_t, std::less<>> pending;
+	const auto scan{[&deltas, &pending]
+	(const db::txn &txn)
+	{
+		db::for_each(txn, db::delta_closure{[&deltas, &pending]
+		(const db::delta &delta)
+		{
+			if(std::get<db::delta::COL>(delta) != "_user_mitsein")
+				return;
+
+			const auto it
+			{
+				deltas.find(std::get<db::delta::KEY>(delta))
+			};
+
+			if(it == end(deltas))
+				return;
+
+			const auto &val
+			{
+				std::get<db::delta::VAL>(delta)
+			};
+
+			switch(std::get<db::delta::OP>(delta))
+			{
+				case db::op::SET:
+					pending[it->first] = size(val) == sizeof(uint64_t)? uint64_t(byte_view<uint64_t>(val)) : 0UL;
+					return;
+
+				case db::op::DELETE:
+					pending[it->first] = 0;
+					return;
+
+				default:
+					return;
+			}
+		}});
+	}};
+
+	if(opts.interpose && opts.interpose != &txn)
+		scan(*opts.interpose);
+
+	scan(txn);
+	for(const auto &[key, delta] : deltas)
+	{
+		if(!delta)
+			continue;
+
+		const auto it
+		{
+			pending.find(key)
+		};
+
+		char valbuf[8];
+		bool found {it != end(pending)};
+		const string_view &existing
+		{
+			found?
+				string_view{}:
+				db::read(user_mitsein, key, found, valbuf)
+		};
+
+		const uint64_t prior
+		{
+			it != end(pending)?
+				it->second:
+			found && size(existing) == sizeof(uint64_t)?
+				uint64_t(byte_view<uint64_t>(existing)):
+				0UL
+		};
+
+		const uint64_t value
+		{
+			uint64_t(std::max(int64_t(prior) + delta, 0L))
+		};
+
+		db::txn::append
+		{
+			txn, user_mitsein,
+			{
+				value? db::op::SET : db::op::DELETE,
+				key,
+				value? byte_view<string_view>(value) : string_view{},
+			}
+		};
+	}
+}
+
+/// The index only answers queries once this is true. The marker is written
+/// for a new database and by a rebuild; an import removes it.
+bool
+ircd::m::dbs::user_mitsein_built()
+{
+	return db::has(user_mitsein, "\0"_sv);
+}
+
+void
+ircd::m::dbs::user_mitsein_built(db::txn &txn,
+                                 const bool &built)
+{
+	static const uint64_t zero {0};
+	db::txn::append
+	{
+		txn, user_mitsein,
+		{
+			built? db::op::SET : db::op::DELETE,
+			"\0"_sv,
+			built? byte_view<string_view>(zero) : string_view{},
+		}
+	};
+}
+
+bool
+ircd::m::dbs::user_mitsein_large(const id::room &room_id)
+{
+	char buf[USER_MITSEIN_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		user_mitsein_room_key(buf, room_id)
+	};
+
+	return db::has(user_mitsein, key);
+}
+
+//
+// key
+//
+
+ircd::string_view
+ircd::m::dbs::user_mitsein_key(const string_view &amalgam)
+{
+	return lstrip(amalgam, '\0');
+}
+
+ircd::string_view
+ircd::m::dbs::user_mitsein_key(const mutable_buffer &out_,
+                               const id::user &user_id)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, user_id));
+	consume(out, copy(out, '\0'));
+	return { data(out_), data(out) };
+}
+
+ircd::string_view
+ircd::m::dbs::user_mitsein_key(const mutable_buffer &out_,
+                               const id::user &user_id,
+                               const id::user &other)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, user_id));
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, other));
+	return { data(out_), data(out) };
+}
+
+ircd::string_view
+ircd::m::dbs::user_mitsein_room_key(const mutable_buffer &out_,
+                                    const id::room &room_id)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, room_id));
+	return { data(out_), data(out) };
+}
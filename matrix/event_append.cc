@@ -187,66 +187,19 @@ ircd::m::event::append::append(json::stack::object &object,
 		}
 	}
 
-	if(!json::get<"event_id"_>(event))
-		json::stack::member
-		{
-			object, "event_id", event.event_id
-		};
-
-	const bool query_prev_state
-	{
-		has_event_idx && opts.query_prev_state && is_state
-	};
-
-	if(query_prev_state)
-	{
-		const auto prev_idx
-		{
-			room::state::prev(*opts.event_idx)
-		};
-
-		m::get(std::nothrow, prev_idx, "content", [&object]
-		(const json::object &content)
-		{
+	// The members common to every recipient may have been rendered once
+	// for all of them; otherwise they're composed here.
+	if(opts.rendered && !opts.keys)
+		for(const auto &[key, val] : *opts.rendered)
 			json::stack::member
 			{
-				object, "prev_content", content
+				object, key, json::value
+				{
+					val, json::type(val)
+				}
 			};
-		});
-	}
-
-	// Get the list of properties to send to the client so we can strip
-	// the remaining and save b/w
-	// TODO: m::filter
-	const event::keys &keys
-	{
-		opts.keys?
-			*opts.keys:
-			event_append_default_keys
-	};
-
-	// Append the event members
-	for_each(event, [&keys, &object]
-	(const auto &key, const auto &val_)
-	{
-		if(!keys.has(key) && key != "redacts"_sv)
-			return true;
-
-		const json::value val
-		{
-			val_
-		};
-
-		if(!defined(val))
-			return true;
-
-		json::stack::member
-		{
-			object, key, val
-		};
-
-		return true;
-	});
+	else
+		members(object, event, opts);
 
 	json::stack::object unsigned_
 	{
@@ -318,3 +271,75 @@ ircd::m::event::append::append(json::stack::object &object,
 }}
 {
 }
+
+void
+ircd::m::event::append::members(json::stack::object &object,
+                                const event &event,
+                                const opts &opts)
+{
+	const bool is_state
+	{
+		defined(json::get<"state_key"_>(event))
+	};
+
+	if(!json::get<"event_id"_>(event))
+		json::stack::member
+		{
+			object, "event_id", event.event_id
+		};
+
+	const bool query_prev_state
+	{
+		opts.event_idx && *opts.event_idx && opts.query_prev_state && is_state
+	};
+
+	if(query_prev_state)
+	{
+		const auto prev_idx
+		{
+			room::state::prev(*opts.event_idx)
+		};
+
+		m::get(std::nothrow, prev_idx, "content", [&object]
+		(const json::object &content)
+		{
+			json::stack::member
+			{
+				object, "prev_content", content
+			};
+		});
+	}
+
+	// Get the list of properties to send to the client so we can strip
+	// the remaining and save b/w
+	// TODO: m::filter
+	const event::keys &keys
+	{
+		opts.keys?
+			*opts.keys:
+			event_append_default_keys
+	};
+
+	// Append the event members
+	for_each(event, [&keys, &object]
+	(const auto &key, const auto &val_)
+	{
+		if(!keys.has(key) && key != "redacts"_sv)
+			return true;
+
+		const json::value val
+		{
+			val_
+		};
+
+		if(!defined(val))
+			return true;
+
+		json::stack::member
+		{
+			object, key, val
+		};
+
+		return true;
+	});
+}
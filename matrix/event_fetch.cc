@@ -105,6 +105,17 @@ decltype(ircd::m::event::fetch::default_opts)
 ircd::m::event::fetch::default_opts
 {};
 
+/// Default options for prefetches made on behalf of a waiting client; these
+/// are served ahead of bulk and speculative requests by the prefetcher.
+decltype(ircd::m::event::fetch::interactive_opts)
+ircd::m::event::fetch::interactive_opts
+{
+	db::gopts
+	{
+		db::get::PRIO_HIGH
+	}
+};
+
 //
 // event::fetch::fetch
 //
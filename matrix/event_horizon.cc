@@ -17,46 +17,38 @@ namespace ircd::m::dbs
 size_t
 ircd::m::event::horizon::rebuild()
 {
-	m::dbs::write_opts opts;
-	opts.appendix.reset();
-	opts.appendix.set(dbs::appendix::EVENT_HORIZON);
-	db::txn txn
-	{
-		*dbs::events
-	};
+	struct m::events::rebuilder::opts opts;
+	opts.name = "event.horizon";
 
 	size_t ret(0);
-	m::events::for_each({0UL, -1UL}, [&ret, &txn, &opts]
-	(const m::event::idx &event_idx, const m::event &event)
+	const m::events::rebuilder rebuilder
 	{
-		const m::event::prev prev
-		{
-			event
-		};
-
-		m::for_each(prev, [&ret, &txn, &opts, &event_idx, &event]
-		(const m::event::id &event_id)
+		opts, [&ret]
+		(db::txn &txn, const event::idx &event_idx, const m::event &event)
 		{
-			if(m::exists(event_id))
+			m::dbs::write_opts wopts;
+			wopts.event_idx = event_idx;
+			wopts.appendix.reset();
+			wopts.appendix.set(dbs::appendix::EVENT_HORIZON);
+
+			const m::event::prev prev
+			{
+				event
+			};
+
+			m::for_each(prev, [&ret, &txn, &wopts, &event]
+			(const m::event::id &event_id)
+			{
+				if(m::exists(event_id))
+					return true;
+
+				m::dbs::_index_event_horizon(txn, event, wopts, event_id);
+				++ret;
 				return true;
+			});
+		}
+	};
 
-			opts.event_idx = event_idx;
-			m::dbs::_index_event_horizon(txn, event, opts, event_id);
-			if(++ret % 1024 == 0)
-				log::info
-				{
-					m::log, "event::horizon rebuild @ %lu/%lu",
-					event_idx,
-					m::vm::sequence::retired,
-				};
-
-			return true;
-		});
-
-		return true;
-	});
-
-	txn();
 	return ret;
 }
 
@@ -31,9 +31,12 @@ ircd::m::prefetch(const event::idx &event_idx,
 		if(!event_idx)
 			return false;
 
-		return db::prefetch(dbs::event_json, byte_view<string_view>{event_idx});
+		return db::prefetch(dbs::event_json, byte_view<string_view>{event_idx}, opts.gopts);
 	}
 
+	if(!event_idx)
+		return false;
+
 	const event::keys keys
 	{
 		opts.keys
@@ -46,8 +49,24 @@ ircd::m::prefetch(const event::idx &event_idx,
 
 	bool ret{false};
 	for(const auto &col : cols)
-		if(col)
-			ret |= prefetch(event_idx, col);
+	{
+		const auto &column_idx
+		{
+			col?
+				json::indexof<event>(col):
+				dbs::event_column.size()
+		};
+
+		if(column_idx >= dbs::event_column.size())
+			continue;
+
+		auto &column
+		{
+			dbs::event_column.at(column_idx)
+		};
+
+		ret |= db::prefetch(column, byte_view<string_view>{event_idx}, opts.gopts);
+	}
 
 	return ret;
 }
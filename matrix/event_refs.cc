@@ -16,71 +16,21 @@
 void
 ircd::m::event::refs::rebuild()
 {
-	static const size_t pool_size{96};
-	static const size_t log_interval{8192};
+	struct m::events::rebuilder::opts opts;
+	opts.name = "event.refs";
 
-	db::txn txn
+	const m::events::rebuilder rebuilder
 	{
-		*m::dbs::events
-	};
-
-	auto &column
-	{
-		dbs::event_json
-	};
-
-	auto it
-	{
-		column.begin()
-	};
-
-	ctx::dock dock;
-	ctx::pool pool;
-	pool.min(pool_size);
-
-	size_t i(0), j(0);
-	const ctx::uninterruptible::nothrow ui;
-	for(; it; ++it)
-	{
-		if(ctx::interruption_requested())
-			break;
-
-		const m::event::idx event_idx
-		{
-			byte_view<m::event::idx>(it->first)
-		};
-
-		std::string event{it->second};
-		pool([&txn, &dock, &i, &j, event(std::move(event)), event_idx]
+		opts, []
+		(db::txn &txn, const event::idx &event_idx, const m::event &event)
 		{
 			m::dbs::write_opts wopts;
 			wopts.event_idx = event_idx;
 			wopts.appendix.reset();
 			wopts.appendix.set(dbs::appendix::EVENT_REFS);
-			m::dbs::write(txn, json::object{event}, wopts);
-
-			if(++j % log_interval == 0) log::info
-			{
-				m::log, "Refs builder @%zu:%zu of %lu (@idx: %lu)",
-				i,
-				j,
-				m::vm::sequence::retired,
-				event_idx
-			};
-
-			if(j >= i)
-				dock.notify_one();
-		});
-
-		++i;
-	}
-
-	dock.wait([&i, &j]
-	{
-		return i == j;
-	});
-
-	txn();
+			m::dbs::write(txn, event, wopts);
+		}
+	};
 }
 
 bool
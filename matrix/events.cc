@@ -23,65 +23,429 @@ ircd::m::events::dump_buffer_size
 void
 ircd::m::events::rebuild()
 {
-	static const event::fetch::opts fopts
+	struct rebuilder::opts opts;
+	opts.name = "events.type.sender";
+
+	const rebuilder rebuilder
 	{
-		event::keys::include {"type", "sender"}
+		opts, []
+		(db::txn &txn, const event::idx &event_idx, const m::event &event)
+		{
+			dbs::write_opts wopts;
+			wopts.event_idx = event_idx;
+			wopts.appendix.reset();
+			wopts.appendix.set(dbs::appendix::EVENT_TYPE);
+			wopts.appendix.set(dbs::appendix::EVENT_SENDER);
+			dbs::write(txn, event, wopts);
+		}
 	};
+}
+
+//
+// rebuilder
+//
+
+decltype(ircd::m::events::rebuilder::partition_size)
+ircd::m::events::rebuilder::partition_size
+{
+	{ "name",     "ircd.m.events.rebuild.partition_size" },
+	{ "default",  long(64_KiB)                           },
+};
+
+decltype(ircd::m::events::rebuilder::pool_size)
+ircd::m::events::rebuilder::pool_size
+{
+	{ "name",     "ircd.m.events.rebuild.pool_size" },
+	{ "default",  16L                               },
+};
+
+decltype(ircd::m::events::rebuilder::txn_max)
+ircd::m::events::rebuilder::txn_max
+{
+	{ "name",     "ircd.m.events.rebuild.txn_max" },
+	{ "default",  long(16_MiB)                    },
+};
 
-	static const m::events::range range
+decltype(ircd::m::events::rebuilder::checkpoint_interval)
+ircd::m::events::rebuilder::checkpoint_interval
+{
+	{ "name",     "ircd.m.events.rebuild.checkpoint_interval" },
+	{ "default",  30L                                         },
+};
+
+ircd::m::events::rebuilder::rebuilder(const struct opts &opts,
+                                      closure handler)
+:opts
+{
+	opts
+}
+,handler
+{
+	std::move(handler)
+}
+,range
+{
+	std::max(opts.range.first, opts.resume? checkpoint_get() : 0UL),
+	!empty(opts.events)?
+		std::min(opts.range.second, opts.events.size()):
+		std::min(opts.range.second, vm::sequence::retired + 1),
+}
+,partition_events
+{
+	std::max(opts.partition_size?: size_t(partition_size), 1UL)
+}
+,done
+(
+	range.first < range.second?
+		(range.second - range.first + partition_events - 1) / partition_events:
+		0UL,
+	false
+)
+,started
+{
+	now<steady_point>()
+}
+,checkpointed
+{
+	started
+}
+{
+	const ctx::pool::opts pool_opts
 	{
-		0, -1UL, &fopts
+		512_KiB,                                        // stack sz
+		std::max(opts.pool_size?: size_t(pool_size), 1UL), // pool sz
+		-1,                                             // queue max hard
+		0,                                              // queue max soft
+		true,                                           // queue max blocking
+		false,                                          // queue max warning
+		3,                                              // ionice
+		3,                                              // nice
 	};
 
-	db::txn txn
+	log::notice
 	{
-		*m::dbs::events
+		log, "Rebuild '%s' of events %lu to %lu in %zu partitions of %zu on %zu workers...",
+		opts.name,
+		range.first,
+		range.second,
+		done.size(),
+		partition_events,
+		pool_opts.initial_ctxs,
 	};
 
-	dbs::write_opts wopts;
-	wopts.appendix.reset();
-	wopts.appendix.set(dbs::appendix::EVENT_TYPE);
-	wopts.appendix.set(dbs::appendix::EVENT_SENDER);
+	ctx::pool pool
+	{
+		"m.events.rebuild", pool_opts
+	};
 
-	size_t ret(0);
-	for_each(range, [&txn, &wopts, &ret]
-	(const event::idx &event_idx, const m::event &event)
+	// Partitions are submitted in order; submission blocks while all of the
+	// workers are busy so the partitions are also started in order, which
+	// keeps the checkpoint watermark close behind the work in progress.
+	ctx::dock dock;
+	size_t submitted(0), completed(0);
+	const ctx::uninterruptible ui;
+	for(; submitted < done.size(); ++submitted)
 	{
-		wopts.event_idx = event_idx;
-		dbs::write(txn, event, wopts);
-		++ret;
+		if(unlikely(ctx::interruption_requested()))
+			break;
+
+		pool([this, &dock, &completed, i(submitted)]
+		{
+			const unwind complete{[this, &dock, &completed, &i]
+			{
+				++completed;
+				dock.notify_one();
+			}};
+
+			partition(i);
+		});
+	}
+
+	if(unlikely(ctx::interruption_requested()))
+		pool.terminate();
+
+	dock.wait([&submitted, &completed]
+	{
+		return completed >= submitted;
+	});
+
+	checkpoint(true);
+	const auto elapsed
+	{
+		duration_cast<seconds>(now<steady_point>() - started).count()
+	};
+
+	log::notice
+	{
+		log, "Rebuild '%s' %s events:%zu errors:%zu commits:%zu %s in %ld seconds (%zu events/s)",
+		opts.name,
+		watermark >= done.size()?
+			"complete"_sv:
+		completed >= done.size()?
+			"incomplete"_sv:
+			"interrupted"_sv,
+		events,
+		errors,
+		commits,
+		pretty(iec(bytes)),
+		elapsed,
+		events / std::max(elapsed, 1L),
+	};
+}
 
-		if(ret % 8192UL == 0UL)
-			log::info
+void
+ircd::m::events::rebuilder::partition(const size_t &i)
+{
+	const event::idx_range part
+	{
+		range.first + i * partition_events,
+		std::min(range.first + (i + 1) * partition_events, range.second),
+	};
+
+	static const db::gopts gopts
+	{
+		db::get::NO_CACHE, db::get::PRIO_LOW
+	};
+
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	const auto commit{[this, &txn]
+	{
+		const auto txn_bytes(txn.bytes());
+		txn();
+		txn.clear();
+		bytes += txn_bytes;
+		++commits;
+	}};
+
+	bool failed {false};
+	const auto each{[this, &i, &part, &txn, &commit, &failed]
+	(const event::idx &event_idx, const auto &get)
+	{
+		try
+		{
+			handler(txn, event_idx, get());
+			++events;
+
+			if(txn.bytes() >= size_t(txn_max))
+				commit();
+		}
+		catch(const ctx::interrupted &)
+		{
+			throw;
+		}
+		catch(const ctx::terminated &)
+		{
+			throw;
+		}
+		catch(const std::exception &e)
+		{
+			++errors;
+			failed = true;
+			log::error
 			{
-				log, "Events type/sender table rebuild events %zu of %zu num:%zu txn:%zu %s",
+				log, "Rebuild '%s' partition %zu [%lu -> %lu] idx:%lu :%s",
+				opts.name,
+				i,
+				part.first,
+				part.second,
 				event_idx,
-				vm::sequence::retired,
-				ret,
-				txn.size(),
-				pretty(iec(txn.bytes())),
+				e.what(),
 			};
+		}
+	}};
 
-		return true;
-	});
+	// Listed events are fetched individually.
+	if(!empty(opts.events))
+	{
+		static const m::event::fetch::opts fopts
+		{
+			gopts
+		};
 
+		m::event::fetch event
+		{
+			fopts
+		};
+
+		for(size_t j(part.first); j < part.second; ++j)
+		{
+			const auto &event_idx
+			{
+				opts.events.at(j)
+			};
+
+			each(event_idx, [&event, &event_idx]() -> const m::event &
+			{
+				seek(event, event_idx);
+				return event;
+			});
+		}
+	}
+	else
+	{
+		auto it
+		{
+			dbs::event_json.lower_bound(byte_view<string_view>(part.first), gopts)
+		};
+
+		for(; it; ++it)
+		{
+			const event::idx event_idx
+			{
+				byte_view<event::idx>(it->first)
+			};
+
+			if(event_idx >= part.second)
+				break;
+
+			each(event_idx, [&it]
+			{
+				return m::event
+				{
+					json::object{it->second}
+				};
+			});
+		}
+	}
+
+	if(txn.size())
+		commit();
+
+	// A partition with errors stays pending so the saved progress does not
+	// advance past it; a resumed rebuild will retry it.
+	done.at(i) = !failed;
+	checkpoint();
+}
+
+void
+ircd::m::events::rebuilder::checkpoint(const bool &force)
+{
+	const auto last(watermark);
+	while(watermark < done.size() && done[watermark])
+		++watermark;
+
+	const auto now
+	{
+		ircd::now<steady_point>()
+	};
+
+	const bool finished
+	{
+		watermark >= done.size()
+	};
+
+	if(!finished && !force && now - checkpointed < seconds(checkpoint_interval))
+		return;
+
+	const auto elapsed
+	{
+		std::max(duration_cast<seconds>(now - started).count(), 1L)
+	};
+
+	const event::idx position
+	{
+		std::min(range.first + watermark * partition_events, range.second)
+	};
+
+	checkpointed = now;
 	log::info
 	{
-		log, "Events type/sender table rebuild events:%zu txn:%zu %s commit...",
-		ret,
-		txn.size(),
-		pretty(iec(txn.bytes())),
+		log, "Rebuild '%s' @ %lu of %lu %.2lf%% events:%zu errors:%zu commits:%zu %s (%zu events/s %s/s)",
+		opts.name,
+		position,
+		range.second,
+		(watermark / double(std::max(done.size(), 1UL))) * 100.0,
+		events,
+		errors,
+		commits,
+		pretty(iec(bytes)),
+		events / elapsed,
+		pretty(iec(bytes / elapsed)),
 	};
 
-	txn();
+	// Once complete the checkpoint is reset so the next rebuild under this
+	// name starts from the beginning of its range.
+	if(watermark != last || finished)
+		checkpoint_set(finished? 0UL : position);
+}
 
-	log::notice
+void
+ircd::m::events::rebuilder::checkpoint_set(const event::idx &position)
+const
+{
+	if(!opts.name)
+		return;
+
+	const m::room::id::buf room_id
 	{
-		log, "Events type/sender table rebuild complete.",
-		ret,
-		txn.size(),
-		pretty(iec(txn.bytes())),
+		"ircd", my_host()
 	};
+
+	send(room_id, me(), "ircd.events.rebuild", opts.name, json::members
+	{
+		{ "position",  long(position)               },
+		{ "range",     json::members
+		{
+			{ "start",  long(opts.range.first)        },
+			{ "stop",   long(opts.range.second)       },
+		}},
+	});
+}
+
+ircd::m::event::idx
+ircd::m::events::rebuilder::checkpoint_get()
+const
+{
+	if(!opts.name)
+		return 0UL;
+
+	const m::room::id::buf room_id
+	{
+		"ircd", my_host()
+	};
+
+	const m::room::state state
+	{
+		room_id
+	};
+
+	const auto event_idx
+	{
+		state.get(std::nothrow, "ircd.events.rebuild", opts.name)
+	};
+
+	event::idx ret(0);
+	m::get(std::nothrow, event_idx, "content", [this, &ret]
+	(const json::object &content)
+	{
+		const json::object range
+		{
+			content["range"]
+		};
+
+		// A checkpoint is only valid for the same requested range.
+		if(range.get<long>("start") != long(opts.range.first))
+			return;
+
+		if(range.get<long>("stop") != long(opts.range.second))
+			return;
+
+		ret = content.get<long>("position");
+	});
+
+	if(ret)
+		log::notice
+		{
+			log, "Rebuild '%s' resuming from checkpoint @ %lu",
+			opts.name,
+			ret,
+		};
+
+	return ret;
 }
 
 void
@@ -194,6 +558,409 @@ ircd::m::events::dump__file(const string_view &filename)
 	};
 }
 
+//
+// import
+//
+
+decltype(ircd::m::events::import::batch_max)
+ircd::m::events::import::batch_max
+{
+	{ "name",     "ircd.m.events.import.batch_max" },
+	{ "default",  long(64_KiB)                     },
+};
+
+decltype(ircd::m::events::import::buffer_size)
+ircd::m::events::import::buffer_size
+{
+	{ "name",     "ircd.m.events.import.buffer_size" },
+	{ "default",  long(4_MiB)                        },
+};
+
+ircd::m::events::import::import(const string_view &filename,
+                                 const struct opts &opts)
+:opts{opts}
+,range
+{
+	vm::sequence::retired + 1,
+	vm::sequence::retired + 1,
+}
+,started
+{
+	now<steady_point>()
+}
+{
+	// No evaluation may run or begin while the sequence is taken over.
+	const vm::hold hold;
+	range =
+	{
+		vm::sequence::retired + 1,
+		vm::sequence::retired + 1,
+	};
+
+	// Indexes not written by the import are incomplete until rebuilt.
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	dbs::user_mitsein_built(txn, false);
+	dbs::room_member_count_built(txn, false);
+	txn();
+
+	// Imported events are not evaluated; caches of vm.notify are dropped
+	// once the import stops, whether or not it completed.
+	const unwind invalidate{[]
+	{
+		vm::invalidate();
+	}};
+
+	const fs::fd file
+	{
+		filename
+	};
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		size_t(buffer_size)
+	};
+
+	std::vector<std::string> batch;
+	batch.reserve(size_t(batch_max));
+	std::set<string_view> batch_ids;
+	for(size_t foff(0); !opts.limit || events + size(batch) < opts.limit; )
+	{
+		const string_view read
+		{
+			fs::read(file, buf, foff)
+		};
+
+		size_t boff(0);
+		json::vector vector{read};
+		while(boff < size(read) && (!opts.limit || events + size(batch) < opts.limit)) try
+		{
+			const json::object object
+			{
+				*begin(vector)
+			};
+
+			boff += size(string_view{object});
+			vector = { data(read) + boff, size(read) - boff };
+			const m::event event
+			{
+				object
+			};
+
+			if(!check(event))
+			{
+				++skipped;
+				continue;
+			}
+
+			// Duplicates within the batch are not yet visible to check().
+			if(batch_ids.count(string_view{event.event_id}))
+			{
+				++skipped;
+				continue;
+			}
+
+			batch.emplace_back(string_view{object});
+			batch_ids.emplace(json::get<"event_id"_>(json::object{batch.back()}));
+			if(size(batch) < size_t(batch_max))
+				continue;
+
+			flush(batch);
+			batch.clear();
+			batch_ids.clear();
+		}
+		catch(const json::parse_error &e)
+		{
+			const string_view remain
+			{
+				data(read) + boff, size(read) - boff
+			};
+
+			// The end of the file; only whitespace may follow the last event.
+			if(remain.find_first_not_of(" \t\r\n") == remain.npos)
+				break;
+
+			// An event cut off at the end of a full buffer is read again from
+			// its start; one which does not fit in an empty buffer is fatal.
+			if(size(read) == size(buf) && boff > 0)
+				break;
+
+			// The events before this one are kept; nothing after it can be
+			// found without the bounds of this record.
+			++errors;
+			log::error
+			{
+				log, "import[%s] malformed event at offset %zu (after %zu events) :%s",
+				filename,
+				foff + boff,
+				events + size(batch),
+				e.what(),
+			};
+
+			if(!batch.empty())
+				flush(batch);
+
+			throw m::BAD_JSON
+			{
+				"Malformed event at offset %zu of %s :%s",
+				foff + boff,
+				filename,
+				e.what(),
+			};
+		}
+
+		foff += boff;
+		bytes = foff;
+		if(boff == 0)
+			break;
+	}
+
+	if(!batch.empty())
+		flush(batch);
+
+	const auto elapsed
+	{
+		std::max(now<steady_point>() - started, steady_point::duration(1))
+	};
+
+	char pbuf[48];
+	log::notice
+	{
+		log, "import[%s] complete events:%zu skipped:%zu errors:%zu batches:%zu %s idx:%lu-%lu in %ld seconds (%.2lf/s)",
+		filename,
+		events,
+		skipped,
+		errors,
+		batches,
+		pretty(pbuf, iec(bytes)),
+		range.first,
+		range.second,
+		duration_cast<seconds>(elapsed).count(),
+		events / duration_cast<duration<double>>(elapsed).count(),
+	};
+}
+
+void
+ircd::m::events::import::flush(const std::vector<std::string> &batch)
+{
+	const auto idx
+	{
+		[this](const size_t &i)
+		{
+			return range.second + i;
+		}
+	};
+
+	// Phase one: the event_idx and the event columns. Once ingested every
+	// event in the batch can be found by the indexers of phase two.
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	dbs::write_opts wopts;
+	wopts.json_source = opts.json_source;
+	wopts.appendix.reset();
+	wopts.appendix.set(dbs::appendix::EVENT_ID);
+	wopts.appendix.set(dbs::appendix::EVENT_JSON);
+	wopts.appendix.set(dbs::appendix::EVENT_COLS);
+	for(size_t i(0); i < size(batch); ++i)
+	{
+		const m::event event
+		{
+			json::object{batch[i]}
+		};
+
+		wopts.event_idx = idx(i);
+		dbs::write(txn, event, wopts);
+	}
+
+	db::ingest(txn, opts.dir);
+
+	// Phase two: every other index.
+	db::txn index
+	{
+		*dbs::events
+	};
+
+	wopts.appendix = dbs::write_opts::appendix_all;
+	wopts.appendix.reset(dbs::appendix::EVENT_ID);
+	wopts.appendix.reset(dbs::appendix::EVENT_JSON);
+	wopts.appendix.reset(dbs::appendix::EVENT_COLS);
+
+	// Pair counts and state snapshots are read-modify-write against the
+	// database, which does not see the rest of the batch; rebuild these
+	// indexes after an import instead.
+	wopts.appendix.reset(dbs::appendix::USER_MITSEIN);
+	wopts.appendix.reset(dbs::appendix::ROOM_MEMBER_COUNT);
+	wopts.appendix.reset(dbs::appendix::ROOM_STATE_SNAPSHOT);
+
+	// Snapshots of a room whose state is imported no longer reflect the
+	// state space; they are cleared and accumulate again afterwards.
+	std::set<string_view> state_rooms;
+	for(const auto &object : batch)
+		if(json::object{object}.has("state_key"))
+			state_rooms.emplace(json::string(json::object{object}.get("room_id")));
+
+	db::txn snapshots
+	{
+		*dbs::events
+	};
+
+	for(const auto &room_id : state_rooms)
+		dbs::room_state_snapshot_clear(snapshots, m::room::id{room_id});
+
+	snapshots();
+	std::exception_ptr eptr;
+	for(size_t i(0); i < size(batch) && !eptr; ++i) try
+	{
+		const m::event event
+		{
+			json::object{batch[i]}
+		};
+
+		wopts.event_idx = idx(i);
+		dbs::write(index, event, wopts);
+	}
+	catch(const std::exception &e)
+	{
+		eptr = std::current_exception();
+		log::error
+		{
+			log, "import idx:%lu indexing :%s",
+			idx(i),
+			e.what(),
+		};
+	}
+
+	// Events without their indexes would be unreachable yet occupy the
+	// sequence; take phase one back out and abort the import. The sequence
+	// has not been advanced for this batch.
+	if(eptr)
+	{
+		rollback(txn);
+		std::rethrow_exception(eptr);
+	}
+
+	db::ingest(index, opts.dir);
+
+	range.second += size(batch);
+	events += size(batch);
+	++batches;
+
+	vm::sequence::retired = range.second - 1;
+	vm::sequence::committed = vm::sequence::retired;
+	vm::sequence::uncommitted = vm::sequence::retired;
+
+	log::info
+	{
+		log, "import batch:%zu events:%zu skipped:%zu errors:%zu idx:%lu",
+		batches,
+		events,
+		skipped,
+		errors,
+		vm::sequence::retired,
+	};
+}
+
+void
+ircd::m::events::import::rollback(const db::txn &txn)
+{
+	db::txn undo
+	{
+		*dbs::events
+	};
+
+	db::for_each(txn, db::delta_closure{[&undo]
+	(const db::delta &delta)
+	{
+		db::txn::append
+		{
+			undo, db::delta
+			{
+				db::op::DELETE,
+				std::get<db::delta::COL>(delta),
+				std::get<db::delta::KEY>(delta),
+			}
+		};
+	}});
+
+	const ctx::uninterruptible ui;
+	undo();
+	log::warning
+	{
+		log, "import rolled back %zu keys of batch:%zu",
+		undo.size(),
+		batches + 1,
+	};
+}
+
+bool
+ircd::m::events::import::check(const event &event)
+try
+{
+	if(!event.event_id)
+		throw m::BAD_JSON
+		{
+			"Event has no event_id."
+		};
+
+	if(opts.exists_skip && m::exists(event.event_id))
+		return false;
+
+	if(opts.verify >= verify::CONFORMS)
+	{
+		const event::conforms report
+		{
+			event
+		};
+
+		if(!report.clean())
+			throw m::BAD_JSON
+			{
+				"Non-conforming event: %s", string(report)
+			};
+	}
+
+	if(opts.verify >= verify::EVENT_ID)
+		if(!m::check_id(event))
+			throw m::BAD_JSON
+			{
+				"Mismatching event_id %s", string_view{event.event_id}
+			};
+
+	if(opts.verify >= verify::SIGNATURES)
+		if(!m::verify(event))
+			throw m::BAD_SIGNATURE
+			{
+				"Signature verification failed for %s", string_view{event.event_id}
+			};
+
+	return true;
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "import %s :%s",
+		string_view{event.event_id},
+		e.what(),
+	};
+
+	++errors;
+	if(!opts.errors_skip)
+		throw;
+
+	return false;
+}
+
 bool
 ircd::m::events::for_each(const range &range,
                           const event_filter &filter,
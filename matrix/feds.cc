@@ -12,25 +12,67 @@ namespace ircd::m::feds
 {
 	struct request_base;
 	template<class T> struct request;
+	struct pending;
 	using request_list = std::list<std::unique_ptr<request_base>>;
+	using pending_list = std::list<pending>;
+	using launcher = std::function<std::unique_ptr<request_base> (const string_view &origin)>;
 	template<class T> using create_closure = std::function<T (request<T> &, const string_view &origin)>;
 
-	template<class T> static request_list for_one(const string_view &origin, const opts &, const closure &, const create_closure<T> &);
-	template<class T> static request_list for_each_in_room(const opts &, const closure &, const create_closure<T> &);
+	template<class T> static pending_list for_one(const string_view &origin, const opts &, const closure &, const create_closure<T> &);
+	template<class T> static pending_list for_each_in_room(const opts &, const closure &, const create_closure<T> &);
 
+	static uint8_t rank(const string_view &origin, const bool &errant);
 	static bool call_user(const closure &closure, const result &result);
-	static bool handler(request_list &, const milliseconds &, const closure &);
-
-	static request_list head(const opts &, const closure &);
-	static request_list auth(const opts &, const closure &);
-	static request_list event(const opts &, const closure &);
-	static request_list state(const opts &, const closure &);
-	static request_list backfill(const opts &, const closure &);
-	static request_list version(const opts &, const closure &);
-	static request_list keys(const opts &, const closure &);
-	static request_list send(const opts &, const closure &);
+	static void launch(request_list &, pending_list &, const size_t &window, const closure &);
+	static void expire(request_list &, const system_point &);
+	static void complete(request_list &, pending_list &, const opts &);
+	static bool handler(pending_list &, const size_t &window, const closure &);
+
+	static pending_list head(const opts &, const closure &);
+	static pending_list auth(const opts &, const closure &);
+	static pending_list event(const opts &, const closure &);
+	static pending_list state(const opts &, const closure &);
+	static pending_list backfill(const opts &, const closure &);
+	static pending_list version(const opts &, const closure &);
+	static pending_list keys(const opts &, const closure &);
+	static pending_list send(const opts &, const closure &);
+
+	extern conf::item<size_t> concurrency;
 }
 
+decltype(ircd::m::feds::concurrency)
+ircd::m::feds::concurrency
+{
+	{ "name",         "ircd.m.feds.concurrency" },
+	{ "default",      0L                        },
+	{ "description",
+
+	R"(
+	Default maximum number of requests outstanding at once for one operation
+	to the servers of a room. Zero is unlimited; every request is launched at
+	once. Each request times out on its own from when it is launched.
+	)"}
+};
+
+//
+// pending
+//
+
+/// A request which has not yet been launched. The launcher is shared by
+/// every origin for the same operation.
+struct ircd::m::feds::pending
+{
+	const feds::opts *opts {nullptr};
+	std::shared_ptr<const launcher> launch;
+	std::string origin;
+	uint8_t rank {0};
+
+	bool operator<(const pending &o) const
+	{
+		return rank < o.rank;
+	}
+};
+
 //
 // request_base
 //
@@ -39,6 +81,7 @@ namespace ircd::m::feds
 struct ircd::m::feds::request_base
 {
 	const feds::opts *opts {nullptr};
+	system_point deadline;
 	char origin[256];
 
 	request_base(const feds::opts &opts)
@@ -95,7 +138,7 @@ ircd::m::feds::execute::execute(const vector_view<const opts> &optsv,
                                 const closure &closure)
 :boolean{true}
 {
-	request_list list;
+	pending_list list;
 	for(const auto &opts : optsv) switch(opts.op)
 	{
 		case op::head:
@@ -134,14 +177,17 @@ ircd::m::feds::execute::execute(const vector_view<const opts> &optsv,
 			continue;
 	}
 
-	milliseconds timeout {0};
+	size_t window {0};
 	for(const auto &opts : optsv)
-		timeout = std::max(opts.timeout, timeout);
+		window = std::max(opts.concurrency?: size_t(concurrency)?: -1UL, window);
 
-	this->boolean::val = handler(list, timeout, closure);
+	// Healthier servers are requested first; the sort is stable so the
+	// order of operations in the batch is otherwise preserved.
+	list.sort();
+	this->boolean::val = handler(list, std::max(window, size_t(1)), closure);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::send(const opts &opts,
                     const closure &closure)
 {
@@ -163,7 +209,7 @@ ircd::m::feds::send(const opts &opts,
 	return for_each_in_room<m::fed::send>(opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::keys(const opts &opts,
                     const closure &closure)
 {
@@ -193,7 +239,7 @@ ircd::m::feds::keys(const opts &opts,
 		for_one<m::fed::key::query>(opts.arg[0], opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::version(const opts &opts,
                        const closure &closure)
 {
@@ -216,7 +262,7 @@ ircd::m::feds::version(const opts &opts,
 	return for_each_in_room<m::fed::version>(opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::backfill(const opts &opts,
                         const closure &closure)
 {
@@ -240,7 +286,7 @@ ircd::m::feds::backfill(const opts &opts,
 	return for_each_in_room<m::fed::backfill>(opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::state(const opts &opts,
                      const closure &closure)
 {
@@ -264,7 +310,7 @@ ircd::m::feds::state(const opts &opts,
 	return for_each_in_room<m::fed::state>(opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::event(const opts &opts,
                      const closure &closure)
 {
@@ -286,7 +332,7 @@ ircd::m::feds::event(const opts &opts,
 	return for_each_in_room<m::fed::event>(opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::auth(const opts &opts,
                     const closure &closure)
 {
@@ -308,7 +354,7 @@ ircd::m::feds::auth(const opts &opts,
 	return for_each_in_room<m::fed::event_auth>(opts, closure, make_request);
 }
 
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::head(const opts &opts,
                     const closure &closure)
 {
@@ -336,15 +382,16 @@ ircd::m::feds::head(const opts &opts,
 //
 
 bool
-ircd::m::feds::handler(request_list &reqs,
-                       const milliseconds &timeout,
+ircd::m::feds::handler(pending_list &pending,
+                       const size_t &window,
                        const closure &closure)
 {
-	const auto when
-	{
-		now<system_point>() + timeout
-	};
+	// Outstanding requests; anything left here when this function returns
+	// is cancelled by the request destructor.
+	request_list reqs;
+	launch(reqs, pending, window, closure);
 
+	std::map<const opts *, size_t> succeeded;
 	while(!reqs.empty())
 	{
 		static const auto dereferencer{[]
@@ -358,8 +405,23 @@ ircd::m::feds::handler(request_list &reqs,
 			ctx::when_any(begin(reqs), end(reqs), dereferencer)
 		};
 
-		if(!next.wait_until(when, std::nothrow))
-			break;
+		// Wait for whichever request times out first; those timed out are
+		// cancelled and their slots go to the pending requests.
+		const auto &earliest
+		{
+			std::min_element(begin(reqs), end(reqs), []
+			(const auto &a, const auto &b)
+			{
+				return a->deadline < b->deadline;
+			})
+		};
+
+		if(!next.wait_until((*earliest)->deadline, std::nothrow))
+		{
+			expire(reqs, now<system_point>());
+			launch(reqs, pending, window, closure);
+			continue;
+		}
 
 		const auto it
 		{
@@ -367,12 +429,17 @@ ircd::m::feds::handler(request_list &reqs,
 		};
 
 		assert(it != end(reqs));
-		const unwind remove{[&reqs, &it]
+		std::unique_ptr<request_base> req_
 		{
-			reqs.erase(it);
-		}};
+			std::move(*it)
+		};
+
+		// The slot is given to the next pending request before the user sees
+		// this result so the window stays full while the closure runs.
+		reqs.erase(it);
+		launch(reqs, pending, window, closure);
 
-		request_base &req(**it);
+		request_base &req(*req_);
 		server::request &sreq(dynamic_cast<server::request &>(req)); try
 		{
 			const auto code{sreq.get()};
@@ -385,6 +452,14 @@ ircd::m::feds::handler(request_list &reqs,
 
 			if(!call_user(closure, result))
 				return false;
+
+			// The operation is complete; its slots go to the other
+			// operations of the batch.
+			if(req.opts->quorum && ++succeeded[req.opts] >= req.opts->quorum)
+			{
+				complete(reqs, pending, *req.opts);
+				launch(reqs, pending, window, closure);
+			}
 		}
 		catch(const std::exception &)
 		{
@@ -409,6 +484,94 @@ ircd::m::feds::handler(request_list &reqs,
 	return true;
 }
 
+/// Launch pending requests until the window is full.
+void
+ircd::m::feds::launch(request_list &reqs,
+                      pending_list &pending,
+                      const size_t &window,
+                      const closure &closure)
+{
+	while(reqs.size() < window && !pending.empty())
+	{
+		const auto next
+		{
+			std::move(pending.front())
+		};
+
+		pending.pop_front();
+		assert(next.opts);
+		assert(next.launch);
+		const auto &opts(*next.opts); try
+		{
+			reqs.emplace_back((*next.launch)(next.origin));
+			reqs.back()->deadline = now<system_point>() + opts.timeout;
+		}
+		catch(const std::exception &)
+		{
+			if(!opts.closure_cached_errors)
+				continue;
+
+			feds::result result;
+			result.request = &opts;
+			result.origin = next.origin;
+			result.eptr = std::current_exception();
+			const ctx::exception_handler eh;
+			m::feds::call_user(closure, result);
+		}
+	}
+}
+
+/// The quorum for an operation was reached; its remaining requests are
+/// dropped from the queue and any in flight are cancelled.
+void
+ircd::m::feds::complete(request_list &reqs,
+                        pending_list &pending,
+                        const opts &opts)
+{
+	pending.remove_if([&opts]
+	(const auto &pending)
+	{
+		return pending.opts == &opts;
+	});
+
+	reqs.remove_if([&opts]
+	(const auto &req)
+	{
+		return req->opts == &opts;
+	});
+}
+
+/// Cancel the requests which have timed out.
+void
+ircd::m::feds::expire(request_list &reqs,
+                      const system_point &now)
+{
+	reqs.remove_if([&now]
+	(const auto &req)
+	{
+		return req->deadline <= now;
+	});
+}
+
+uint8_t
+ircd::m::feds::rank(const string_view &origin,
+                    const bool &errant)
+{
+	if(errant)
+		return 4;
+
+	if(my_host(origin))
+		return 0;
+
+	if(fed::linked(origin))
+		return 1;
+
+	if(fed::exists(origin))
+		return 2;
+
+	return 3;
+}
+
 bool
 ircd::m::feds::call_user(const closure &closure,
                          const result &result)
@@ -427,21 +590,34 @@ catch(const std::exception &)
 
 
 template<class T>
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::for_each_in_room(const opts &opts,
                                 const feds::closure &closure,
                                 const std::function<T (request<T> &, const string_view &origin)> &create_closure)
 {
-	request_list ret;
+	pending_list ret;
 	if(!opts.room_id)
 		return ret;
 
+	const auto launch
+	{
+		std::make_shared<const launcher>([&opts, create_closure]
+		(const string_view &origin) -> std::unique_ptr<request_base>
+		{
+			return std::make_unique<request<T>>(opts, [&create_closure, &origin]
+			(auto &request)
+			{
+				return create_closure(request, origin);
+			});
+		})
+	};
+
 	const m::room::origins origins
 	{
 		opts.room_id
 	};
 
-	origins.for_each([&opts, &ret, &closure, &create_closure]
+	origins.for_each([&opts, &ret, &launch]
 	(const string_view &origin)
 	{
 		if(opts.exclude_myself && my_host(origin))
@@ -452,39 +628,24 @@ ircd::m::feds::for_each_in_room(const opts &opts,
 			fed::errant(origin)
 		};
 
-		if(opts.closure_cached_errors || !errant) try
-		{
-			ret.emplace_back(std::make_unique<request<T>>(opts, [&create_closure, &origin]
-			(auto &request)
+		if(opts.closure_cached_errors || !errant)
+			ret.emplace_back(pending
 			{
-				return create_closure(request, origin);
-			}));
-		}
-		catch(const std::exception &)
-		{
-			if(!opts.closure_cached_errors)
-				return;
-
-			feds::result result;
-			result.request = &opts;
-			result.origin = origin;
-			result.eptr = std::current_exception();
-			const ctx::exception_handler eh;
-			m::feds::call_user(closure, result);
-		}
+				&opts, launch, std::string{origin}, rank(origin, errant)
+			});
 	});
 
 	return ret;
 }
 
 template<class T>
-ircd::m::feds::request_list
+ircd::m::feds::pending_list
 ircd::m::feds::for_one(const string_view &origin,
                        const opts &opts,
                        const feds::closure &closure,
                        const std::function<T (request<T> &, const string_view &origin)> &create_closure)
 {
-	request_list ret;
+	pending_list ret;
 	if(opts.exclude_myself && my_host(origin))
 		return ret;
 
@@ -493,26 +654,26 @@ ircd::m::feds::for_one(const string_view &origin,
 		fed::errant(origin)
 	};
 
-	if(opts.closure_cached_errors || !errant) try
+	if(!opts.closure_cached_errors && errant)
+		return ret;
+
+	const auto launch
 	{
-		ret.emplace_back(std::make_unique<request<T>>(opts, [&create_closure, &origin]
-		(auto &request)
+		std::make_shared<const launcher>([&opts, create_closure]
+		(const string_view &origin) -> std::unique_ptr<request_base>
 		{
-			return create_closure(request, origin);
-		}));
-	}
-	catch(const std::exception &e)
+			return std::make_unique<request<T>>(opts, [&create_closure, &origin]
+			(auto &request)
+			{
+				return create_closure(request, origin);
+			});
+		})
+	};
+
+	ret.emplace_back(pending
 	{
-		if(!opts.closure_cached_errors)
-			return ret;
-
-		feds::result result;
-		result.request = &opts;
-		result.origin = origin;
-		result.eptr = std::current_exception();
-		const ctx::exception_handler eh;
-		m::feds::call_user(closure, result);
-	}
+		&opts, launch, std::string{origin}, rank(origin, errant)
+	});
 
 	return ret;
 }
@@ -300,6 +300,10 @@ noexcept try
 	server::init::wait();
 	m::sync::pool.join();
 
+	// Persist presence still queued while the vm can take it.
+	if(_vm)
+		m::presence::flush();
+
 	if(_vm)
 		signoff(*this);
 
@@ -945,6 +949,16 @@ try
 	assert(dbs::events);
 	assert(db::sequence(*dbs::events) == 0);
 
+	// Materialized indexes are complete from the first event.
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	dbs::user_mitsein_built(txn, true);
+	dbs::room_member_count_built(txn, true);
+	txn();
+
 	assert(homeserver.self);
 	const m::user::id &my_id
 	{
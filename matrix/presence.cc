@@ -10,7 +10,19 @@
 
 namespace ircd::m
 {
+	static void presence_update(const event &, vm::eval &);
+	static void presence_flush_worker();
+
 	extern const string_view presence_valid_states[];
+	extern conf::item<size_t> presence_changes_max;
+	extern conf::item<milliseconds> presence_flush_interval;
+	extern std::map<std::string, event::idx, std::less<>> presence_table;
+	extern std::map<event::idx, std::string> presence_changes;
+	extern event::idx presence_changes_floor;
+	extern std::map<std::string, std::pair<std::string, time_t>, std::less<>> presence_queue;
+	extern ctx::dock presence_dock;
+	extern hookfn<vm::eval &> presence_hook;
+	extern context presence_flush_context;
 }
 
 decltype(ircd::m::presence_valid_states)
@@ -21,6 +33,266 @@ ircd::m::presence_valid_states
 	"unavailable",
 };
 
+/// Upper bound on the change log; the oldest changes are dropped and the
+/// log no longer covers syncs from before them.
+decltype(ircd::m::presence_changes_max)
+ircd::m::presence_changes_max
+{
+	{ "name",     "ircd.m.presence.changes.max" },
+	{ "default",  long(256_KiB)                 },
+};
+
+/// Interval at which queued updates are persisted to the user rooms.
+decltype(ircd::m::presence_flush_interval)
+ircd::m::presence_flush_interval
+{
+	{ "name",     "ircd.m.presence.flush.interval" },
+	{ "default",  1000L                            },
+};
+
+/// Latest ircd.presence event::idx for each user which changed since startup.
+decltype(ircd::m::presence_table)
+ircd::m::presence_table;
+
+/// Change log ordered by event::idx; only a user's latest change is present.
+decltype(ircd::m::presence_changes)
+ircd::m::presence_changes;
+
+/// The change log is complete for event::idx at or above this value; zero
+/// until the vm is ready.
+decltype(ircd::m::presence_changes_floor)
+ircd::m::presence_changes_floor;
+
+/// Updates pending persistence, coalesced by user_id, with the time each was
+/// queued. These are the user's current presence until they are written.
+decltype(ircd::m::presence_queue)
+ircd::m::presence_queue;
+
+decltype(ircd::m::presence_dock)
+ircd::m::presence_dock;
+
+decltype(ircd::m::presence_hook)
+ircd::m::presence_hook
+{
+	presence_update,
+	{
+		{ "_site",   "vm.notify"      },
+		{ "type",    "ircd.presence"  },
+	}
+};
+
+decltype(ircd::m::presence_flush_context)
+ircd::m::presence_flush_context
+{
+	"m.presence",
+	512_KiB,
+	context::POST,
+	presence_flush_worker,
+};
+
+/// The worker only stops here; whatever remains queued is flushed by the
+/// homeserver shutdown while the vm is still up.
+static const ircd::run::changed
+presence_flush_context_terminate
+{
+	ircd::run::level::QUIT, []
+	{
+		ircd::m::presence_flush_context.terminate();
+	}
+};
+
+void
+ircd::m::presence_update(const event &event,
+                         vm::eval &eval)
+{
+	const auto &event_idx
+	{
+		eval.sequence
+	};
+
+	const auto &sender
+	{
+		json::get<"sender"_>(event)
+	};
+
+	if(!event_idx || !my_host(json::get<"origin"_>(event)))
+		return;
+
+	if(!user::room::is(json::get<"room_id"_>(event), sender))
+		return;
+
+	auto it
+	{
+		presence_table.lower_bound(sender)
+	};
+
+	if(it == end(presence_table) || it->first != sender)
+		it = presence_table.emplace_hint(it, sender, 0UL);
+	else if(it->second >= event_idx)
+		return;
+	else
+		presence_changes.erase(it->second);
+
+	it->second = event_idx;
+	presence_changes.emplace(event_idx, it->first);
+	while(presence_changes.size() > size_t(presence_changes_max))
+	{
+		const auto first(begin(presence_changes));
+		presence_changes_floor = std::max(presence_changes_floor, first->first + 1);
+		presence_table.erase(first->second);
+		presence_changes.erase(first);
+	}
+}
+
+void
+ircd::m::presence_flush_worker()
+try
+{
+	vm::dock.wait([]
+	{
+		return vm::ready;
+	});
+
+	presence_changes_floor = std::max(presence_changes_floor, vm::sequence::retired + 1);
+	while(1)
+	{
+		presence_dock.wait([]
+		{
+			return !presence_queue.empty();
+		});
+
+		ctx::sleep(milliseconds(presence_flush_interval));
+		presence::flush();
+	}
+}
+catch(const ctx::terminated &)
+{
+	log::debug
+	{
+		log, "Presence flush worker terminated with %zu queued",
+		presence_queue.size(),
+	};
+}
+
+bool
+ircd::m::presence::changes(const event::idx_range &range,
+                           const closure_change &closure)
+{
+	if(!presence_changes_floor || range.first < presence_changes_floor)
+		return false;
+
+	auto it
+	{
+		presence_changes.lower_bound(range.first)
+	};
+
+	// The closure may yield; the position is revalidated by key each step.
+	for(event::idx pos; it != end(presence_changes) && it->first < range.second; )
+	{
+		const m::user::id::buf user_id
+		{
+			it->second
+		};
+
+		pos = it->first;
+		if(!closure(user_id, pos))
+			return false;
+
+		it = presence_changes.upper_bound(pos);
+	}
+
+	return true;
+}
+
+/// Persist the queued updates. Each stays in the queue, answering reads,
+/// until its event is written; an update queued again in the meantime is
+/// left for the next flush.
+size_t
+ircd::m::presence::flush()
+{
+	const auto queue
+	{
+		presence_queue
+	};
+
+	size_t ret(0);
+	for(const auto &queued : queue)
+	{
+		const auto &[user_id, pending]
+		{
+			queued
+		};
+
+		// Left queued if interrupted so the shutdown flush gets to it.
+		const unwind_nominal dequeue{[&queued]
+		{
+			const auto it
+			{
+				presence_queue.find(queued.first)
+			};
+
+			if(it != end(presence_queue) && it->second == queued.second)
+				presence_queue.erase(it);
+		}};
+
+		try
+		{
+			set(presence{json::object{pending.first}});
+			++ret;
+		}
+		catch(const ctx::interrupted &)
+		{
+			throw;
+		}
+		catch(const std::exception &e)
+		{
+			log::error
+			{
+				log, "Failed to save presence for %s :%s",
+				user_id,
+				e.what(),
+			};
+		}
+	}
+
+	return ret;
+}
+
+void
+ircd::m::presence::queue(const user &user,
+                         const string_view &presence,
+                         const string_view &status_msg)
+{
+	queue(m::presence
+	{
+		{ "user_id",           user.user_id         },
+		{ "presence",          presence             },
+		{ "status_msg",        status_msg           },
+		{ "currently_active",  presence == "online" },
+	});
+}
+
+void
+ircd::m::presence::queue(const presence &content)
+{
+	const json::string &user_id
+	{
+		json::at<"user_id"_>(content)
+	};
+
+	auto it
+	{
+		presence_queue.lower_bound(user_id)
+	};
+
+	if(it == end(presence_queue) || it->first != user_id)
+		it = presence_queue.emplace_hint(it, user_id, decltype(it->second){});
+
+	it->second.first = json::strung{content};
+	it->second.second = ircd::time<milliseconds>();
+	presence_dock.notify_one();
+}
+
 ircd::m::presence::presence(const user &user,
                             const mutable_buffer &buf)
 :edu::m_presence{[&user, &buf]
@@ -107,6 +379,21 @@ ircd::m::presence::get(const std::nothrow_t,
                        const m::presence::closure_event &closure,
                        const m::event::fetch::opts *const &fopts_p)
 {
+	// A queued update is the current presence ahead of its persistence.
+	const auto it
+	{
+		presence_queue.find(user.user_id)
+	};
+
+	if(it != end(presence_queue))
+	{
+		m::event event;
+		json::get<"content"_>(event) = json::object{it->second.first};
+		json::get<"origin_server_ts"_>(event) = it->second.second;
+		closure(event);
+		return true;
+	}
+
 	const m::event::idx event_idx
 	{
 		m::presence::get(std::nothrow, user)
@@ -135,6 +422,14 @@ ircd::m::event::idx
 ircd::m::presence::get(const std::nothrow_t,
                        const m::user &user)
 {
+	const auto it
+	{
+		presence_table.find(user.user_id)
+	};
+
+	if(it != end(presence_table))
+		return it->second;
+
 	const m::user::room user_room
 	{
 		user
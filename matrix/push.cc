@@ -415,6 +415,22 @@ try
 		room
 	};
 
+	const auto count{[&members, &opts]
+	{
+		if(opts.cache && opts.cache->member_count >= 0)
+			return size_t(opts.cache->member_count);
+
+		const size_t ret
+		{
+			members.count("join")
+		};
+
+		if(opts.cache)
+			opts.cache->member_count = ret;
+
+		return ret;
+	}};
+
 	const auto &is
 	{
 		json::get<"is"_>(cond)
@@ -440,31 +456,31 @@ try
 		case "=="_:
 			return
 				val?
-					members.count("join") == val:
+					count() == val:
 					members.empty("join");
 
 		case ">="_:
 			return
 				val?
-					members.count("join") >= val:
+					count() >= val:
 					true;
 
 		case "<="_:
 			return
 				val?
-					members.count("join") <= val:
+					count() <= val:
 					members.empty("join");
 
 		case ">"_:
 			return
 				val?
-					members.count("join") > val:
+					count() > val:
 					!members.empty("join");
 
 		case "<"_:
 			return
 				val > 1?
-					members.count("join") < val:
+					count() < val:
 				val == 1?
 					members.empty("join"):
 					false;
@@ -507,6 +523,434 @@ ircd::m::push::unknown_condition_kind(const event &event,
 	return false;
 }
 
+//
+// program
+//
+
+namespace ircd::m::push
+{
+	using program_lru = std::list<std::pair<std::string, std::shared_ptr<const program>>>;
+
+	static bool program_viable(const event &, const program::rule &, const match::opts &);
+	static bool program_eval(const event &, const program::rule &, const match::opts &, const bool &user);
+	static void program_notify(const event &, vm::eval &);
+	static void program_invalidate(const event &);
+
+	static const string_view program_kinds[]
+	{
+		"override", "content", "room", "sender", "underride"
+	};
+
+	extern conf::item<size_t> program_cache_max;
+	extern hookfn<vm::eval &> program_hook;
+	extern hookfn<> program_invalidate_hook;
+	static program_lru programs;
+	static std::map<string_view, program_lru::iterator, std::less<>> programs_index;
+	static uint64_t programs_generation;
+}
+
+decltype(ircd::m::push::program_cache_max)
+ircd::m::push::program_cache_max
+{
+	{ "name",     "ircd.m.push.program.cache.max" },
+	{ "default",  16384L                          },
+};
+
+decltype(ircd::m::push::program_hook)
+ircd::m::push::program_hook
+{
+	program_notify,
+	{
+		{ "_site",  "vm.notify" },
+	}
+};
+
+decltype(ircd::m::push::program_invalidate_hook)
+ircd::m::push::program_invalidate_hook
+{
+	program_invalidate,
+	{
+		{ "_site",  "vm.invalidate" },
+	}
+};
+
+/// Rules written outside of evaluation can't be attributed to a user from
+/// the room alone; every program is dropped and made again when needed.
+void
+ircd::m::push::program_invalidate(const event &event)
+{
+	++programs_generation;
+	programs_index.clear();
+	programs.clear();
+}
+
+/// A change to a rule in a user's room (or a redaction there, which is how
+/// rules are deleted) invalidates the user's program.
+void
+ircd::m::push::program_notify(const event &event,
+                              vm::eval &eval)
+{
+	const auto &type
+	{
+		json::get<"type"_>(event)
+	};
+
+	if(!startswith(type, rule::type_prefix) && type != "m.room.redaction")
+		return;
+
+	const auto &sender
+	{
+		json::get<"sender"_>(event)
+	};
+
+	if(!sender || !my(m::user::id(sender)))
+		return;
+
+	if(!m::user::room::is(json::get<"room_id"_>(event), sender))
+		return;
+
+	program::invalidate(sender);
+}
+
+std::shared_ptr<const ircd::m::push::program>
+ircd::m::push::program::get(const id::user &user_id)
+{
+	static const auto defaults
+	{
+		std::make_shared<const program>(push::rules::defaults)
+	};
+
+	const auto it
+	{
+		programs_index.find(string_view{user_id})
+	};
+
+	if(it != end(programs_index))
+	{
+		programs.splice(begin(programs), programs, it->second);
+		return it->second->second;
+	}
+
+	const auto generation
+	{
+		programs_generation
+	};
+
+	// Users who never set a rule share the program of the defaults.
+	const user::room user_room
+	{
+		user_id
+	};
+
+	char typebuf[event::TYPE_MAX_SIZE];
+	const room::state::type_prefix type
+	{
+		make_type(typebuf, path{})
+	};
+
+	const room::state state
+	{
+		user_room
+	};
+
+	const bool custom
+	{
+		!state.for_each(type, []
+		(const string_view &, const string_view &, const event::idx &)
+		{
+			return false;
+		})
+	};
+
+	auto ret
+	{
+		custom?
+			std::make_shared<const program>(user_id):
+			defaults
+	};
+
+	// The program isn't cached if any rule was changed while it was being
+	// made, or if another context beat us to it.
+	if(generation != programs_generation || programs_index.count(string_view{user_id}))
+		return ret;
+
+	if(!size_t(program_cache_max))
+		return ret;
+
+	while(!programs.empty() && programs.size() >= size_t(program_cache_max))
+	{
+		programs_index.erase(programs.back().first);
+		programs.pop_back();
+	}
+
+	programs.emplace_front(std::string{user_id}, ret);
+	programs_index.emplace(programs.front().first, begin(programs));
+	return ret;
+}
+
+bool
+ircd::m::push::program::invalidate(const id::user &user_id)
+{
+	++programs_generation;
+	const auto it
+	{
+		programs_index.find(string_view{user_id})
+	};
+
+	if(it == end(programs_index))
+		return false;
+
+	const auto lit
+	{
+		it->second
+	};
+
+	programs_index.erase(it);
+	programs.erase(lit);
+	return true;
+}
+
+bool
+ircd::m::push::program::user_dependent(const string_view &kind)
+{
+	return
+		kind == "contains_user_mxid" ||
+		kind == "state_key_user_mxid" ||
+		kind == "contains_display_name";
+}
+
+ircd::m::push::program::program(const id::user &user_id)
+{
+	const user::pushrules pushrules
+	{
+		user_id
+	};
+
+	for(const auto &kind : program_kinds)
+		pushrules.for_each(path{"global", kind, {}}, [this]
+		(const auto &event_idx, const auto &path, const json::object &object)
+		{
+			const push::rule rule
+			{
+				object
+			};
+
+			if(!json::get<"enabled"_>(rule))
+				return true;
+
+			const auto &[scope, kind, ruleid]
+			{
+				path
+			};
+
+			bool user(false);
+			for(const json::object cond : json::get<"conditions"_>(rule))
+				user |= user_dependent(json::string(cond["kind"]));
+
+			rules.emplace_back(program::rule
+			{
+				std::string{scope},
+				std::string{kind},
+				std::string{ruleid},
+				std::string{object},
+				event_idx,
+				user,
+			});
+
+			return true;
+		});
+}
+
+ircd::m::push::program::program(const push::rules &ruleset)
+:defaults{true}
+{
+	for(const auto &kind : program_kinds)
+		for(const json::object object : ruleset.at<json::array>(kind))
+		{
+			const push::rule rule
+			{
+				object
+			};
+
+			if(!json::get<"enabled"_>(rule))
+				continue;
+
+			bool user(false);
+			for(const json::object cond : json::get<"conditions"_>(rule))
+				user |= user_dependent(json::string(cond["kind"]));
+
+			rules.emplace_back(program::rule
+			{
+				"global",
+				std::string{kind},
+				std::string{json::get<"rule_id"_>(rule)},
+				std::string{object},
+				0UL,
+				user,
+			});
+		}
+}
+
+const ircd::m::push::program::rule *
+ircd::m::push::program::match(const event &event,
+                              const match::opts &opts)
+const
+{
+	// The user-independent part of every rule is evaluated once per event
+	// for this program; each user then only evaluates the conditions which
+	// depend on them for the rules which remain viable.
+	// Only a program held by a shared_ptr can key the cache.
+	const auto self
+	{
+		opts.cache?
+			weak_from_this().lock():
+			std::shared_ptr<const program>{}
+	};
+
+	std::vector<bool> *const viable
+	{
+		self?
+			&opts.cache->viable[self]:
+			nullptr
+	};
+
+	if(viable && viable->empty())
+	{
+		viable->reserve(rules.size());
+		for(const auto &rule : rules)
+			viable->push_back(program_viable(event, rule, opts));
+	}
+
+	assert(!viable || viable->size() == rules.size());
+	for(size_t i(0); i < rules.size(); ++i)
+	{
+		const auto &rule
+		{
+			rules[i]
+		};
+
+		if(viable && !(*viable)[i])
+			continue;
+
+		if(!viable && !program_viable(event, rule, opts))
+			continue;
+
+		if(rule.user && !program_eval(event, rule, opts, true))
+			continue;
+
+		return &rule;
+	}
+
+	return nullptr;
+}
+
+bool
+ircd::m::push::program_viable(const event &event,
+                              const program::rule &rule,
+                              const match::opts &opts)
+{
+	// Room and sender rules have no conditions; their rule_id is the room or
+	// the sender they apply to.
+	if(rule.kind == "room")
+		return rule.ruleid == json::get<"room_id"_>(event);
+
+	if(rule.kind == "sender")
+		return rule.ruleid == json::get<"sender"_>(event);
+
+	return program_eval(event, rule, opts, false);
+}
+
+bool
+ircd::m::push::program_eval(const event &event,
+                            const program::rule &rule,
+                            const match::opts &opts,
+                            const bool &user)
+{
+	const auto memoized{[&event, &opts]
+	(const string_view &key, const push::cond &cond)
+	{
+		if(!opts.cache)
+			return bool(match(event, cond, opts));
+
+		auto it
+		{
+			opts.cache->cond.lower_bound(key)
+		};
+
+		if(it == end(opts.cache->cond) || it->first != key)
+			it = opts.cache->cond.emplace_hint(it, std::string{key}, bool(match(event, cond, opts)));
+
+		return it->second;
+	}};
+
+	const json::object object
+	{
+		rule.source
+	};
+
+	const json::string &pattern
+	{
+		object["pattern"]
+	};
+
+	if(pattern && !user)
+	{
+		const push::cond cond
+		{
+			{ "kind",     "event_match"   },
+			{ "key",      "content.body"  },
+			{ "pattern",  pattern         },
+		};
+
+		if(!memoized(object["pattern"], cond))
+			return false;
+	}
+
+	const json::array &conditions
+	{
+		object["conditions"]
+	};
+
+	for(const json::object cond : conditions)
+	{
+		const json::string &kind
+		{
+			cond["kind"]
+		};
+
+		if(program::user_dependent(kind) != user)
+			continue;
+
+		if(user && !match(event, push::cond(cond), opts))
+			return false;
+
+		if(!user && !memoized(string_view{cond}, push::cond(cond)))
+			return false;
+	}
+
+	return true;
+}
+
+ircd::m::push::path
+ircd::m::push::program::rule::path()
+const
+{
+	return push::path
+	{
+		scope, kind, ruleid
+	};
+}
+
+ircd::m::push::rule
+ircd::m::push::program::rule::get()
+const
+{
+	return push::rule
+	{
+		json::object{source}
+	};
+}
+
 //
 // rule
 //
@@ -11,19 +11,42 @@
 namespace ircd::m::roomstrap
 {
 	struct pkg;
+	struct scanner;
+	struct pipeline;
 	using send_join_response = std::tuple<json::object, unique_buffer<mutable_buffer>>;
 
 	static event::id::buf make_join(const string_view &host, const room::id &, const user::id &, const mutable_buffer &);
-	static send_join_response send_join(const string_view &host, const room::id &, const event::id &, const json::object &event);
+	static send_join_response send_join(const string_view &host, const room::id &, const event::id &, const json::object &event, pipeline &, const bool &omit_members);
+	static void partial_mark(const room::id &, const event::id &, const string_view &host, const json::array &servers);
+	static void partial_clear(const room::id &);
+	static void partial_load();
 	static void broadcast_join(const room &, const event &, const string_view &exclude);
+	static void fetch_keys(pipeline &);
 	static void fetch_keys(const json::array &events);
 	static void eval_auth_chain(const json::array &auth_chain, vm::opts);
 	static void eval_state(const json::array &state, vm::opts);
 	static void backfill(const string_view &host, const room::id &, const event::id &, vm::opts);
+	static bool resync_state(const room::id &, const string_view &event_id, const vector_view<const std::string> &hosts, const vm::opts &);
+	static bool resync_state_ids(const room::id &, const string_view &event_id, const vector_view<const std::string> &hosts, vm::opts);
+	static size_t recheck(const room::id &, const event::idx &since);
+	static int recheck(const room::id &, const room::state &, const event::idx &);
+	static void resync_worker();
 	static void worker(pkg);
 
 	extern conf::item<seconds> make_join_timeout;
 	extern conf::item<seconds> send_join_timeout;
+	extern conf::item<milliseconds> send_join_pipeline_interval;
+	extern conf::item<size_t> send_join_content_max;
+	extern conf::item<size_t> state_batch;
+	extern conf::item<bool> partial_state;
+	extern conf::item<seconds> resync_timeout;
+	extern conf::item<seconds> resync_retry;
+	extern conf::item<size_t> recheck_batch;
+	extern std::set<std::string, std::less<>> resyncing;
+	extern context resync_context;
+	extern std::map<std::string, std::vector<std::string>, std::less<>> partial_rooms;
+	extern ctx::dock partial_dock;
+	extern bool partial_loaded;
 	extern conf::item<seconds> backfill_timeout;
 	extern conf::item<size_t> backfill_limit;
 	extern log::log log;
@@ -37,6 +60,50 @@ struct ircd::m::roomstrap::pkg
 	std::string room_version;
 };
 
+/// Incremental scanner over the send_join response content as it arrives.
+/// Each complete event object found in the "state" or "auth_chain" arrays
+/// is passed to the closure. It tracks only enough of the JSON grammar to
+/// find those objects; the full response is still parsed after completion.
+struct ircd::m::roomstrap::scanner
+{
+	using closure = std::function<void (const json::object &)>;
+
+	closure on_event;
+	std::string carry;                 // object straddling buffers
+	size_t depth {0};                  // nesting of all objects and arrays
+	size_t events_depth {0};           // depth inside an events array or 0
+	bool capture {false};              // inside an event object
+	bool string {false};
+	bool escape {false};
+	bool colon {false};                // last token at response level was ':'
+	char key[16];                      // last string at response level
+	size_t key_len {0};
+	size_t events {0};
+	size_t bytes {0};
+
+	bool section() const noexcept;
+	void operator()(const const_buffer &);
+	void reset() noexcept;
+
+	scanner(closure on_event)
+	:on_event{std::move(on_event)}
+	{}
+};
+
+/// State shared between the send_join progress callback, which runs on the
+/// ios stack as content arrives, and the bootstrap context which fetches the
+/// keys the received events were signed with while the rest is received.
+struct ircd::m::roomstrap::pipeline
+{
+	scanner scan;
+	std::vector<std::pair<std::string, std::string>> pending;
+	std::set<std::pair<std::string, std::string>> requested;
+	size_t fetched {0};
+	util::timer keys_time {util::timer::nostart};
+
+	pipeline();
+};
+
 decltype(ircd::m::roomstrap::log)
 ircd::m::roomstrap::log
 {
@@ -71,6 +138,119 @@ ircd::m::roomstrap::send_join_timeout
 	{ "default",  90L  /* spinappse */                       },
 };
 
+decltype(ircd::m::roomstrap::send_join_pipeline_interval)
+ircd::m::roomstrap::send_join_pipeline_interval
+{
+	{ "name",     "ircd.client.rooms.join.send_join.pipeline.interval" },
+	{ "default",  100L                                                 },
+};
+
+decltype(ircd::m::roomstrap::send_join_content_max)
+ircd::m::roomstrap::send_join_content_max
+{
+	{ "name",         "ircd.client.rooms.join.send_join.content_max" },
+	{ "default",      long(256_MiB)                                   },
+	{ "description",
+
+	R"(
+	Upper bound on the send_join response, which is buffered in full before
+	it is evaluated. A larger response fails the join. Partial state joins
+	request a far smaller response.
+	)"}
+};
+
+decltype(ircd::m::roomstrap::state_batch)
+ircd::m::roomstrap::state_batch
+{
+	{ "name",         "ircd.client.rooms.join.state.batch" },
+	{ "default",      512L                                 },
+	{ "description",
+
+	R"(
+	The number of state events evaluated at once after the auth_chain. This
+	bounds the working set of each evaluation for rooms with large state.
+	)"}
+};
+
+decltype(ircd::m::roomstrap::partial_state)
+ircd::m::roomstrap::partial_state
+{
+	{ "name",         "ircd.client.rooms.join.partial_state" },
+	{ "default",      false                                  },
+	{ "description",
+
+	R"(
+	Request the send_join response without the membership of the room. The
+	join completes with the state the resident server considers necessary
+	and the full state is resynced afterward. Until then the room is marked
+	partial; membership queries wait for the resync and federation is sent
+	to the servers the resident server listed at join.
+	)"}
+};
+
+decltype(ircd::m::roomstrap::resync_timeout)
+ircd::m::roomstrap::resync_timeout
+{
+	{ "name",     "ircd.client.rooms.join.resync.timeout" },
+	{ "default",  180L                                    },
+};
+
+decltype(ircd::m::roomstrap::resync_retry)
+ircd::m::roomstrap::resync_retry
+{
+	{ "name",     "ircd.client.rooms.join.resync.retry" },
+	{ "default",  300L                                   },
+	{ "description",
+
+	R"(
+	Interval in seconds between attempts to resync rooms still partial after
+	their join; rooms left partial at shutdown are resumed at startup.
+	)"}
+};
+
+decltype(ircd::m::roomstrap::recheck_batch)
+ircd::m::roomstrap::recheck_batch
+{
+	{ "name",     "ircd.client.rooms.join.resync.recheck.batch" },
+	{ "default",  64L                                           },
+	{ "description",
+
+	R"(
+	Number of state events rechecked after a resync while evaluation is held.
+	Evaluation resumes between batches.
+	)"}
+};
+
+decltype(ircd::m::roomstrap::resyncing)
+ircd::m::roomstrap::resyncing;
+
+decltype(ircd::m::roomstrap::resync_context)
+ircd::m::roomstrap::resync_context
+{
+	"m.room.resync",
+	256_KiB,
+	context::POST,
+	resync_worker,
+};
+
+static const ircd::run::changed
+resync_context_terminate
+{
+	ircd::run::level::QUIT, []
+	{
+		ircd::m::roomstrap::resync_context.terminate();
+	}
+};
+
+decltype(ircd::m::roomstrap::partial_rooms)
+ircd::m::roomstrap::partial_rooms;
+
+decltype(ircd::m::roomstrap::partial_dock)
+ircd::m::roomstrap::partial_dock;
+
+decltype(ircd::m::roomstrap::partial_loaded)
+ircd::m::roomstrap::partial_loaded;
+
 decltype(ircd::m::roomstrap::make_join_timeout)
 ircd::m::roomstrap::make_join_timeout
 {
@@ -224,10 +404,41 @@ try
 		host
 	};
 
+	util::timer timer;
+	m::roomstrap::pipeline pipe;
 	assert(event.source);
 	const auto &[response, buf]
 	{
-		m::roomstrap::send_join(host, room_id, event_id, event.source)
+		[&]
+		{
+			if(m::roomstrap::partial_state) try
+			{
+				return m::roomstrap::send_join(host, room_id, event_id, event.source, pipe, true);
+			}
+			catch(const http::error &e)
+			{
+				if(e.code != http::NOT_FOUND && e.code != http::BAD_REQUEST)
+					throw;
+			}
+
+			return m::roomstrap::send_join(host, room_id, event_id, event.source, pipe, false);
+		}()
+	};
+
+	const bool partial
+	{
+		response.get<bool>("members_omitted", false)
+	};
+
+	// Mark the room before evaluating so events arriving from the room in the
+	// meantime are not authenticated against the incomplete present state.
+	if(partial)
+		m::roomstrap::partial_mark(room_id, event_id, host, response["servers_in_room"]);
+
+	char tmbuf[4][32];
+	const string_view recv_time
+	{
+		timer.pretty(tmbuf[0])
 	};
 
 	const json::array &auth_chain
@@ -242,13 +453,20 @@ try
 
 	log::info
 	{
-		log, "Joined to %s for %s at %s to '%s' state:%zu auth_chain:%zu",
+		log, "Joined to %s for %s at %s to '%s' state:%zu auth_chain:%zu partial:%b"
+		" in %s; prefetched %zu of %zu keys for %zu events in %s",
 		string_view{room_id},
 		string_view{user_id},
 		string_view{event_id},
 		host,
 		state.size(),
 		auth_chain.size(),
+		partial,
+		recv_time,
+		pipe.fetched,
+		pipe.requested.size(),
+		pipe.scan.events,
+		pipe.keys_time.pretty(tmbuf[1]),
 	};
 
 	m::vm::opts vmopts;
@@ -259,13 +477,41 @@ try
 	vmopts.phase.reset(m::vm::phase::FETCH_PREV);
 	vmopts.phase.reset(m::vm::phase::FETCH_STATE);
 
+	// Keys received while the response was arriving have been fetched; this
+	// picks up the remainder and is otherwise satisfied from the cache.
+	timer = {};
 	m::roomstrap::fetch_keys(auth_chain);
 	m::roomstrap::eval_auth_chain(auth_chain, vmopts);
+	const string_view auth_time
+	{
+		timer.pretty(tmbuf[1])
+	};
 
+	timer = {};
 	m::roomstrap::fetch_keys(state);
 	m::roomstrap::eval_state(state, vmopts);
+	const string_view state_time
+	{
+		timer.pretty(tmbuf[2])
+	};
 
+	timer = {};
 	m::roomstrap::backfill(host, room_id, event_id, vmopts);
+	const string_view backfill_time
+	{
+		timer.pretty(tmbuf[3])
+	};
+
+	log::info
+	{
+		log, "Processed %s for %s send_join:%s auth_chain:%s state:%s backfill:%s",
+		string_view{room_id},
+		string_view{event_id},
+		recv_time,
+		auth_time,
+		state_time,
+		backfill_time,
+	};
 
 	// After we just received and processed all of this state with only a
 	// recent backfill our system doesn't know if state events which are
@@ -293,6 +539,11 @@ try
 		string_view{event_id},
 		num_reset,
 	};
+
+	// The join is usable now; this context continues in the background to
+	// obtain the state which was omitted.
+	if(partial)
+		room::bootstrap::resync(room_id);
 }
 catch(const std::exception &e)
 {
@@ -510,14 +761,27 @@ try
 {
 	log::info
 	{
-		log, "Evaluating %zu state events...",
+		log, "Evaluating %zu state events in batches of %zu...",
 		state.size(),
+		size_t(state_batch),
 	};
 
-	m::vm::eval
+	// The auth_chain has been evaluated so each batch only depends on what
+	// is already in the database; the events are sorted within each batch.
+	std::vector<m::event> events;
+	events.reserve(std::min(state.size(), size_t(state_batch)));
+	for(auto it(begin(state)); it != end(state); )
 	{
-		state, vmopts
-	};
+		events.clear();
+		for(; it != end(state) && events.size() < size_t(state_batch); ++it)
+			events.emplace_back(json::object(*it));
+
+		std::sort(begin(events), end(events));
+		m::vm::eval
+		{
+			events, vmopts
+		};
+	}
 }
 catch(const std::exception &e)
 {
@@ -562,6 +826,46 @@ catch(const std::exception &e)
 	throw;
 }
 
+void
+ircd::m::roomstrap::fetch_keys(pipeline &pipe)
+try
+{
+	std::vector<m::fed::key::server_key> queries;
+	queries.reserve(pipe.pending.size());
+
+	const auto pending
+	{
+		std::move(pipe.pending)
+	};
+
+	for(const auto &key : pending)
+		if(pipe.requested.emplace(key).second)
+			queries.emplace_back(key.first, key.second);
+
+	if(queries.empty())
+		return;
+
+	pipe.keys_time.cont();
+	const unwind stop{[&pipe]
+	{
+		pipe.keys_time.stop();
+	}};
+
+	pipe.fetched += m::keys::fetch(queries);
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::derror
+	{
+		log, "Error when prefetching keys :%s",
+		e.what(),
+	};
+}
+
 void
 ircd::m::roomstrap::fetch_keys(const json::array &events)
 try
@@ -616,7 +920,9 @@ ircd::m::roomstrap::send_join_response
 ircd::m::roomstrap::send_join(const string_view &host,
                               const m::room::id &room_id,
                               const m::event::id &event_id,
-                              const json::object &event)
+                              const json::object &event,
+                              pipeline &pipe,
+                              const bool &omit_members)
 try
 {
 	const unique_buffer<mutable_buffer> buf
@@ -624,19 +930,68 @@ try
 		16_KiB // headers in and out
 	};
 
+	// The buffered response is bounded whether or not it is chunked.
+	server::request::opts sopts;
+	sopts.content_length_maxalloc = size_t(send_join_content_max);
+
+	char uribuf[768], ridbuf[384], eidbuf[384];
 	m::fed::send_join::opts opts{host};
+	opts.sopts = &sopts;
+	if(omit_members)
+		json::get<"uri"_>(opts.request) = fmt::sprintf
+		{
+			uribuf, "/_matrix/federation/v2/send_join/%s/%s?omit_members=true",
+			url::encode(ridbuf, room_id),
+			url::encode(eidbuf, event_id),
+		};
+
 	m::fed::send_join send_join
 	{
 		room_id, event_id, event, buf, std::move(opts)
 	};
 
-	send_join.wait(seconds(send_join_timeout));
+	// The response is scanned as it arrives so key fetching can proceed
+	// while the remainder is still being received. A prior attempt may have
+	// left the scanner anywhere in its response.
+	pipe.scan.reset();
+	send_join.in.progress = [&pipe]
+	(const const_buffer &buffer, const const_buffer &)
+	{
+		pipe.scan(buffer);
+	};
 
+	const auto deadline
+	{
+		now<system_point>() + seconds(send_join_timeout)
+	};
+
+	const milliseconds interval
+	{
+		send_join_pipeline_interval
+	};
+
+	while(!send_join.wait(interval, std::nothrow))
+	{
+		if(now<system_point>() >= deadline)
+			send_join.wait_until(deadline);
+
+		fetch_keys(pipe);
+	}
+
+	fetch_keys(pipe);
 	const auto send_join_code
 	{
 		send_join.get()
 	};
 
+	// The v2 response is the object itself rather than [code, object].
+	if(omit_members)
+		return
+		{
+			json::object{send_join.in.content},
+			std::move(send_join.in.dynamic)
+		};
+
 	const json::array send_join_response
 	{
 		send_join
@@ -809,6 +1164,181 @@ catch(const std::exception &e)
 	throw;
 }
 
+bool
+ircd::m::partial(const room &room)
+{
+	if(unlikely(!roomstrap::partial_loaded))
+		roomstrap::partial_load();
+
+	return roomstrap::partial_rooms.count(room.room_id);
+}
+
+bool
+ircd::m::room::bootstrap::servers(const id &room_id,
+                                  const servers_closure &closure)
+{
+	if(unlikely(!roomstrap::partial_loaded))
+		roomstrap::partial_load();
+
+	const auto it
+	{
+		roomstrap::partial_rooms.find(room_id)
+	};
+
+	if(it == end(roomstrap::partial_rooms))
+		return true;
+
+	// Copy; the closure may yield and the entry may be erased meanwhile.
+	const auto servers
+	{
+		it->second
+	};
+
+	for(const auto &server : servers)
+		if(!closure(server))
+			return false;
+
+	return true;
+}
+
+bool
+ircd::m::room::bootstrap::wait(const id &room_id,
+                               const milliseconds &timeout)
+{
+	return roomstrap::partial_dock.wait_for(timeout, [&room_id]
+	{
+		return !partial(room_id);
+	});
+}
+
+bool
+ircd::m::room::bootstrap::resync(const id &room_id)
+try
+{
+	if(!partial(room_id))
+		return true;
+
+	// Only one resync of a room at a time; the other caller reports failure
+	// and the worker tries again later if it is still partial.
+	const auto iit
+	{
+		roomstrap::resyncing.emplace(room_id)
+	};
+
+	if(!iit.second)
+		return false;
+
+	const unwind resyncing{[&iit]
+	{
+		roomstrap::resyncing.erase(iit.first);
+	}};
+
+	const m::room::id::buf ircd_room_id
+	{
+		"ircd", my_host()
+	};
+
+	const m::room::state ircd_state
+	{
+		ircd_room_id
+	};
+
+	const auto marker_idx
+	{
+		ircd_state.get(std::nothrow, "ircd.room.partial", room_id)
+	};
+
+	std::string host, event_id;
+	m::get(std::nothrow, marker_idx, "content", [&host, &event_id]
+	(const json::object &content)
+	{
+		host = json::string(content["host"]);
+		event_id = json::string(content["event_id"]);
+	});
+
+	if(!marker_idx || event_id.empty())
+		return true;
+
+	char room_version_buf[room::VERSION_MAX_SIZE];
+	m::vm::opts vmopts;
+	vmopts.infolog_accept = false;
+	vmopts.warnlog &= ~vm::fault::EXISTS;
+	vmopts.nothrows = -1;
+	vmopts.room_version = m::version(room_version_buf, room{room_id}, std::nothrow);
+	vmopts.phase.reset(m::vm::phase::FETCH_PREV);
+	vmopts.phase.reset(m::vm::phase::FETCH_STATE);
+
+	util::timer timer;
+	log::info
+	{
+		log, "Resyncing partial state of %s at %s from '%s'",
+		string_view{room_id},
+		event_id,
+		host,
+	};
+
+	// Try the server which answered the send_join first, then the others.
+	std::vector<std::string> hosts{host};
+	servers(room_id, [&hosts](const string_view &server)
+	{
+		if(server != hosts.front() && server != my_host())
+			hosts.emplace_back(server);
+
+		return true;
+	});
+
+	const bool resynced
+	{
+		roomstrap::resync_state(room_id, event_id, hosts, vmopts) ||
+		roomstrap::resync_state_ids(room_id, event_id, hosts, vmopts)
+	};
+
+	if(!resynced)
+	{
+		log::error
+		{
+			log, "Failed to resync partial state of %s from %zu servers",
+			string_view{room_id},
+			hosts.size(),
+		};
+
+		return false;
+	}
+
+	const auto rechecked
+	{
+		roomstrap::recheck(room_id, m::index(std::nothrow, m::event::id(event_id)))
+	};
+
+	roomstrap::partial_clear(room_id);
+
+	char tmbuf[32];
+	log::notice
+	{
+		log, "Resynced partial state of %s; rechecked %zu events in %s",
+		string_view{room_id},
+		rechecked,
+		timer.pretty(tmbuf),
+	};
+
+	return true;
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "Resync of %s :%s",
+		string_view{room_id},
+		e.what(),
+	};
+
+	return false;
+}
+
 bool
 ircd::m::room::bootstrap::required(const id &room_id)
 {
@@ -829,3 +1359,740 @@ ircd::m::room::bootstrap::required(const id &room_id)
 
 	return false;
 }
+
+//
+// roomstrap::pipeline
+//
+
+ircd::m::roomstrap::pipeline::pipeline()
+:scan{[this](const json::object &event)
+{
+	const json::string origin
+	{
+		event["origin"]
+	};
+
+	if(!origin)
+		return;
+
+	for(const auto &[server_name, signatures] : json::object(event["signatures"]))
+		for(const auto &[key_id, signature] : json::object(signatures))
+			pending.emplace_back(origin, key_id);
+}}
+{
+}
+
+//
+// roomstrap::scanner
+//
+
+void
+ircd::m::roomstrap::scanner::operator()(const const_buffer &buffer)
+{
+	const char *start
+	{
+		capture? data(buffer): nullptr
+	};
+
+	bytes += size(buffer);
+	for(const char *p(data(buffer)); p != data(buffer) + size(buffer); ++p)
+	{
+		if(string)
+		{
+			if(escape)
+				escape = false;
+			else if(*p == '\\')
+				escape = true;
+			else if(*p == '"')
+				string = false;
+			else if(depth <= 2 && key_len < sizeof(key))
+				key[key_len++] = *p;
+
+			continue;
+		}
+
+		switch(*p)
+		{
+			case '"':
+				string = true;
+				if(depth <= 2)
+				{
+					key_len = 0;
+					colon = false;
+				}
+				continue;
+
+			case ':':
+				colon = depth <= 2;
+				continue;
+
+			case ',':
+				colon = false;
+				continue;
+
+			case '[':
+				if(!events_depth && depth <= 2 && colon && section())
+					events_depth = depth + 1;
+
+				++depth;
+				continue;
+
+			case '{':
+				if(events_depth && depth == events_depth)
+				{
+					capture = true;
+					start = p;
+				}
+
+				++depth;
+				continue;
+
+			case ']':
+				--depth;
+				if(events_depth && depth < events_depth)
+					events_depth = 0;
+
+				continue;
+
+			case '}':
+				--depth;
+				if(!capture || depth != events_depth)
+					continue;
+
+				capture = false;
+				++events;
+				if(!carry.empty())
+				{
+					carry.append(start, p + 1);
+					start = carry.data();
+				}
+
+				// Errors here only cost the prefetch for this event.
+				try
+				{
+					on_event(json::object
+					{
+						string_view{start, carry.empty()? p + 1: carry.data() + carry.size()}
+					});
+				}
+				catch(const std::exception &e)
+				{
+					log::dwarning
+					{
+						log, "send_join scanner :%s", e.what(),
+					};
+				}
+
+				carry.clear();
+				continue;
+		}
+	}
+
+	if(capture)
+		carry.append(start, data(buffer) + size(buffer));
+}
+
+void
+ircd::m::roomstrap::scanner::reset()
+noexcept
+{
+	carry.clear();
+	depth = 0;
+	events_depth = 0;
+	capture = false;
+	string = false;
+	escape = false;
+	colon = false;
+	key_len = 0;
+	events = 0;
+	bytes = 0;
+}
+
+bool
+ircd::m::roomstrap::scanner::section()
+const noexcept
+{
+	const string_view name
+	{
+		key, key_len
+	};
+
+	return name == "state" || name == "auth_chain";
+}
+
+//
+// roomstrap::partial
+//
+
+void
+ircd::m::roomstrap::partial_mark(const room::id &room_id,
+                                 const event::id &event_id,
+                                 const string_view &host,
+                                 const json::array &servers)
+{
+	if(unlikely(!partial_loaded))
+		partial_load();
+
+	std::vector<std::string> list;
+	list.reserve(servers.size());
+	for(const json::string server : servers)
+		list.emplace_back(server);
+
+	const m::room::id::buf ircd_room_id
+	{
+		"ircd", my_host()
+	};
+
+	send(ircd_room_id, me(), "ircd.room.partial", room_id, json::members
+	{
+		{ "event_id",  event_id  },
+		{ "host",      host      },
+		{ "servers",   servers   },
+	});
+
+	partial_rooms[std::string(room_id)] = std::move(list);
+	log::info
+	{
+		log, "Marked %s partial at %s by '%s' servers:%zu",
+		string_view{room_id},
+		string_view{event_id},
+		host,
+		servers.size(),
+	};
+}
+
+void
+ircd::m::roomstrap::partial_clear(const room::id &room_id)
+{
+	const m::room::id::buf ircd_room_id
+	{
+		"ircd", my_host()
+	};
+
+	send(ircd_room_id, me(), "ircd.room.partial", room_id, json::members
+	{
+	});
+
+	const auto it
+	{
+		partial_rooms.find(room_id)
+	};
+
+	if(it != end(partial_rooms))
+		partial_rooms.erase(it);
+
+	partial_dock.notify_all();
+}
+
+void
+ircd::m::roomstrap::partial_load()
+{
+	// Loading yields; callers arriving meanwhile wait for it to finish
+	// rather than finding the rooms missing.
+	static ctx::mutex mutex;
+	const std::lock_guard lock
+	{
+		mutex
+	};
+
+	if(partial_loaded)
+		return;
+
+	const unwind_nominal loaded{[]
+	{
+		partial_loaded = true;
+	}};
+
+	const m::room::id::buf ircd_room_id
+	{
+		"ircd", my_host()
+	};
+
+	if(!exists(ircd_room_id))
+		return;
+
+	const m::room::state state
+	{
+		ircd_room_id
+	};
+
+	state.for_each("ircd.room.partial", []
+	(const string_view &type, const string_view &state_key, const event::idx &event_idx)
+	{
+		m::get(std::nothrow, event_idx, "content", [&state_key]
+		(const json::object &content)
+		{
+			const json::array servers
+			{
+				content["servers"]
+			};
+
+			if(!content.has("event_id"))
+				return;
+
+			auto &list
+			{
+				partial_rooms[std::string(state_key)]
+			};
+
+			for(const json::string server : servers)
+				list.emplace_back(server);
+		});
+
+		return true;
+	});
+}
+
+/// Resync with one /state request for the whole state at the join event,
+/// trying each host in turn.
+bool
+ircd::m::roomstrap::resync_state(const room::id &room_id,
+                                 const string_view &event_id,
+                                 const vector_view<const std::string> &hosts,
+                                 const vm::opts &vmopts)
+{
+	for(const auto &remote : hosts) try
+	{
+		const unique_buffer<mutable_buffer> buf
+		{
+			16_KiB // headers in and out
+		};
+
+		m::fed::state::opts opts;
+		opts.remote = remote;
+		opts.event_id = event_id;
+		m::fed::state request
+		{
+			room_id, buf, std::move(opts)
+		};
+
+		request.wait(seconds(resync_timeout));
+		request.get();
+
+		const json::object response
+		{
+			request
+		};
+
+		const json::array &auth_chain
+		{
+			response["auth_chain"]
+		};
+
+		const json::array &pdus
+		{
+			response["pdus"]
+		};
+
+		fetch_keys(auth_chain);
+		eval_auth_chain(auth_chain, vmopts);
+		fetch_keys(pdus);
+		eval_state(pdus, vmopts);
+		log::info
+		{
+			log, "Resynced state of %s from '%s' state:%zu auth_chain:%zu",
+			string_view{room_id},
+			remote,
+			pdus.size(),
+			auth_chain.size(),
+		};
+
+		return true;
+	}
+	catch(const ctx::interrupted &)
+	{
+		throw;
+	}
+	catch(const std::exception &e)
+	{
+		log::derror
+		{
+			log, "Resync of %s from '%s' :%s",
+			string_view{room_id},
+			remote,
+			e.what(),
+		};
+	}
+
+	return false;
+}
+
+/// Resync from the ids of the state at the join event. Only the events we
+/// lack are fetched, each through m::fetch from any server in the room, and
+/// evaluated with their auth events fetched as required. This is the
+/// fallback when no server will answer for the whole state at once.
+bool
+ircd::m::roomstrap::resync_state_ids(const room::id &room_id,
+                                     const string_view &event_id,
+                                     const vector_view<const std::string> &hosts,
+                                     vm::opts vmopts)
+{
+	vmopts.phase.set(vm::phase::FETCH_AUTH);
+	vmopts.fetch = true;
+	for(const auto &remote : hosts) try
+	{
+		const unique_buffer<mutable_buffer> buf
+		{
+			16_KiB // headers in and out
+		};
+
+		m::fed::state::opts opts;
+		opts.remote = remote;
+		opts.event_id = event_id;
+		opts.ids_only = true;
+		m::fed::state request
+		{
+			room_id, buf, std::move(opts)
+		};
+
+		request.wait(seconds(resync_timeout));
+		request.get();
+
+		const json::object response
+		{
+			request
+		};
+
+		const json::array auth_chain_ids
+		{
+			response["auth_chain_ids"]
+		};
+
+		const json::array pdu_ids
+		{
+			response["pdu_ids"]
+		};
+
+		// The auth chain first so the state can be authenticated by it.
+		std::vector<m::event::id::buf> missing;
+		for(const json::array &ids : {auth_chain_ids, pdu_ids})
+			for(const json::string id : ids)
+				if(!m::exists(m::event::id(id)))
+					missing.emplace_back(id);
+
+		size_t evaluated(0);
+		for(size_t i(0); i < missing.size(); i += size_t(state_batch))
+		{
+			const size_t count
+			{
+				std::min(missing.size() - i, size_t(state_batch))
+			};
+
+			std::vector<ctx::future<fetch::result>> futures(count);
+			for(size_t j(0); j < count; ++j)
+			{
+				fetch::opts fopts;
+				fopts.op = fetch::op::event;
+				fopts.room_id = room_id;
+				fopts.event_id = missing[i + j];
+				fopts.hint = remote;
+				futures[j] = fetch::start(fopts);
+			}
+
+			for(size_t j(0); j < count; ++j) try
+			{
+				const fetch::result result
+				{
+					futures[j].get()
+				};
+
+				const json::object response
+				{
+					result
+				};
+
+				const json::array &pdus
+				{
+					response["pdus"]
+				};
+
+				const m::event event
+				{
+					pdus.at(0), missing[i + j]
+				};
+
+				m::vm::eval
+				{
+					event, vmopts
+				};
+
+				++evaluated;
+			}
+			catch(const ctx::interrupted &)
+			{
+				throw;
+			}
+			catch(const std::exception &e)
+			{
+				log::derror
+				{
+					log, "Resync of %s fetching %s :%s",
+					string_view{room_id},
+					string_view{missing[i + j]},
+					e.what(),
+				};
+			}
+		}
+
+		log::info
+		{
+			log, "Resynced state of %s from ids by '%s' missing:%zu evaluated:%zu",
+			string_view{room_id},
+			remote,
+			missing.size(),
+			evaluated,
+		};
+
+		return evaluated == missing.size();
+	}
+	catch(const ctx::interrupted &)
+	{
+		throw;
+	}
+	catch(const std::exception &e)
+	{
+		log::derror
+		{
+			log, "Resync of %s from ids by '%s' :%s",
+			string_view{room_id},
+			remote,
+			e.what(),
+		};
+	}
+
+	return false;
+}
+
+/// State events accepted into the room since the join were authenticated
+/// against the partial present state. Those left out of the present state
+/// are checked again against the full state and admitted if they pass now;
+/// those admitted which no longer pass are reported. The vm is held so the
+/// present state is not changing underneath.
+size_t
+ircd::m::roomstrap::recheck(const room::id &room_id,
+                            const event::idx &since)
+{
+	if(!since)
+		return 0;
+
+	const int64_t since_depth
+	{
+		m::get<int64_t>(std::nothrow, since, "depth", 0L)
+	};
+
+	const m::room room
+	{
+		room_id
+	};
+
+	// The candidates are found without holding evaluation; each is checked
+	// again under the hold.
+	std::vector<event::idx> events;
+	for(m::room::events it{room}; it; --it)
+	{
+		if(int64_t(it.depth()) < since_depth)
+			break;
+
+		const auto event_idx
+		{
+			it.event_idx()
+		};
+
+		if(event_idx > since && m::room::state::is(std::nothrow, event_idx))
+			events.emplace_back(event_idx);
+	}
+
+	const m::room::state state
+	{
+		room
+	};
+
+	size_t checked(0), admitted(0), removed(0);
+	const size_t batch_max
+	{
+		std::max(size_t(recheck_batch), 1UL)
+	};
+
+	for(size_t i(0); i < events.size(); )
+	{
+		// The present state can't change between a check and its write.
+		const vm::hold hold;
+		for(const size_t end(std::min(i + batch_max, events.size())); i < end; ++i)
+			switch(recheck(room_id, state, events[i]))
+			{
+				case 1:   ++checked; ++admitted;  break;
+				case -1:  ++checked; ++removed;   break;
+				case 0:   ++checked;              break;
+				default:                          break;
+			}
+	}
+
+	// Nothing written here went through vm.notify.
+	if(admitted || removed)
+		vm::invalidate(room_id);
+
+	log::info
+	{
+		log, "Rechecked %zu state events in %s since idx:%lu; admitted:%zu removed:%zu",
+		checked,
+		string_view{room_id},
+		since,
+		admitted,
+		removed,
+	};
+
+	return checked;
+}
+
+/// Rechecks one state event against the resynced present state. An absent
+/// event fresher than the present one which now passes is admitted (1). The
+/// present event which now fails is removed from the present state, which
+/// reverts to the prior entry of its key if that passes (-1). Otherwise the
+/// event was checked and left alone (0) or not considered (-2).
+int
+ircd::m::roomstrap::recheck(const room::id &room_id,
+                            const room::state &state,
+                            const event::idx &event_idx)
+{
+	const m::event::fetch event
+	{
+		std::nothrow, event_idx
+	};
+
+	if(!event.valid || !defined(json::get<"state_key"_>(event)))
+		return -2;
+
+	const auto pres_idx
+	{
+		state.get(std::nothrow, at<"type"_>(event), at<"state_key"_>(event))
+	};
+
+	const bool present
+	{
+		pres_idx == event_idx
+	};
+
+	const bool fresher
+	{
+		!pres_idx ||
+		m::get<int64_t>(std::nothrow, pres_idx, "depth", 0L) < json::get<"depth"_>(event)
+	};
+
+	if(!present && !fresher)
+		return -2;
+
+	const auto &[pass, fail]
+	{
+		room::auth::check_present(event)
+	};
+
+	if(present == pass)
+		return 0;
+
+	dbs::write_opts wopts;
+	wopts.appendix.reset();
+	wopts.appendix.set(dbs::appendix::ROOM_STATE);
+	wopts.appendix.set(dbs::appendix::ROOM_JOINED);
+	wopts.appendix.set(dbs::appendix::USER_MITSEIN);
+	wopts.appendix.set(dbs::appendix::ROOM_MEMBER_COUNT);
+	if(pass)
+	{
+		db::txn txn
+		{
+			*dbs::events
+		};
+
+		wopts.event_idx = event_idx;
+		dbs::write(txn, event, wopts);
+		txn();
+		return 1;
+	}
+
+	log::dwarning
+	{
+		log, "%s in %s fails auth for the resynced present state; removing :%s",
+		string_view{event.event_id},
+		string_view{room_id},
+		what(fail),
+	};
+
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	wopts.op = db::op::DELETE;
+	wopts.event_idx = event_idx;
+	dbs::write(txn, event, wopts);
+	txn();
+
+	// The prior entry of the key, which this event had replaced.
+	const m::room::state::history history
+	{
+		m::room{room_id}, json::get<"depth"_>(event)
+	};
+
+	const auto prior_idx
+	{
+		history.get(std::nothrow, at<"type"_>(event), at<"state_key"_>(event))
+	};
+
+	if(!prior_idx)
+		return -1;
+
+	const m::event::fetch prior
+	{
+		std::nothrow, prior_idx
+	};
+
+	if(!prior.valid || !std::get<0>(room::auth::check_present(prior)))
+		return -1;
+
+	db::txn prior_txn
+	{
+		*dbs::events
+	};
+
+	wopts.op = db::op::SET;
+	wopts.event_idx = prior_idx;
+	dbs::write(prior_txn, prior, wopts);
+	prior_txn();
+	return -1;
+}
+
+/// Resumes the resync of rooms still partial at startup and retries those
+/// which failed. A join resyncs in its own bootstrap context; this only
+/// picks up what that left behind.
+void
+ircd::m::roomstrap::resync_worker()
+try
+{
+	vm::dock.wait([]
+	{
+		return vm::ready;
+	});
+
+	if(unlikely(!partial_loaded))
+		partial_load();
+
+	while(1)
+	{
+		std::vector<std::string> rooms;
+		for(const auto &[room_id, servers] : partial_rooms)
+			if(!resyncing.count(room_id))
+				rooms.emplace_back(room_id);
+
+		for(const auto &room_id : rooms)
+			room::bootstrap::resync(room_id);
+
+		ctx::sleep(seconds(resync_retry));
+	}
+}
+catch(const ctx::terminated &)
+{
+	log::debug
+	{
+		log, "Partial state resync worker terminated with %zu rooms partial",
+		partial_rooms.size(),
+	};
+}
@@ -347,39 +347,34 @@ ircd::m::room::head::reset(const head &head)
 size_t
 ircd::m::room::head::rebuild(const head &head)
 {
-	size_t ret{0};
-	static const m::event::fetch::opts fopts
-	{
-		{ db::get::NO_CACHE }
-	};
+	// Only the index is walked here; the events themselves are fetched
+	// concurrently by the rebuilder.
+	std::vector<event::idx> event_idx;
+	for(m::room::events it{head.room, 0UL}; it; ++it)
+		event_idx.emplace_back(it.event_idx());
 
-	m::room::events it
-	{
-		head.room, 0UL, &fopts
-	};
+	if(event_idx.empty())
+		return 0;
 
-	if(!it)
-		return ret;
+	std::sort(begin(event_idx), end(event_idx));
 
-	db::txn txn
+	struct m::events::rebuilder::opts opts;
+	opts.events = event_idx;
+	const m::events::rebuilder rebuilder
 	{
-		*m::dbs::events
+		opts, []
+		(db::txn &txn, const event::idx &event_idx, const m::event &event)
+		{
+			m::dbs::write_opts wopts;
+			wopts.op = db::op::SET;
+			wopts.event_idx = event_idx;
+			wopts.appendix.reset();
+			wopts.appendix.set(dbs::appendix::ROOM_HEAD);
+			m::dbs::write(txn, event, wopts);
+		}
 	};
 
-	m::dbs::write_opts opts;
-	opts.op = db::op::SET;
-	for(; it; ++it)
-	{
-		const m::event &event{*it};
-		opts.event_idx = it.event_idx();
-		opts.appendix.reset();
-		opts.appendix.set(dbs::appendix::ROOM_HEAD);
-		m::dbs::write(txn, event, opts);
-		++ret;
-	}
-
-	txn();
-	return ret;
+	return rebuilder.events;
 }
 
 void
@@ -27,6 +27,15 @@ ircd::m::room::members::empty(const string_view &membership,
                               const string_view &host)
 const
 {
+	size_t count;
+	const m::room::state state
+	{
+		room
+	};
+
+	if(state.present() && dbs::room_member_count_get(room.room_id, membership, host, count))
+		return count == 0;
+
 	return for_each(membership, host, closure{[]
 	(const user::id &user_id)
 	{
@@ -54,6 +63,14 @@ ircd::m::room::members::count(const string_view &membership,
 const
 {
 	size_t ret{0};
+	const m::room::state state
+	{
+		room
+	};
+
+	if(state.present() && dbs::room_member_count_get(room.room_id, membership, host, ret))
+		return ret;
+
 	for_each(membership, host, closure{[&ret]
 	(const user::id &user_id)
 	{
@@ -222,3 +239,167 @@ const
 
 	return true;
 }
+
+//
+// members::rebuild
+//
+
+ircd::m::room::members::rebuild::rebuild()
+{
+	// Membership indexed by live evals would be lost or counted twice.
+	const vm::hold hold;
+
+	size_t rooms(0);
+	m::rooms::opts opts;
+	opts.local_joined_only = false;
+	m::rooms::for_each(opts, [&rooms]
+	(const m::room::id &room_id)
+	{
+		const rebuild rebuild
+		{
+			room_id
+		};
+
+		++rooms;
+		return true;
+	});
+
+	// The counts are only read once every room has been counted.
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	dbs::room_member_count_built(txn, true);
+	txn();
+
+	log::notice
+	{
+		log, "Rebuilt room_member_count for %zu rooms.",
+		rooms,
+	};
+}
+
+ircd::m::room::members::rebuild::rebuild(const room::id &room_id)
+{
+	// Evals of the room which index or write while the counts are made
+	// would be lost; without holding all evaluation the counts are made
+	// again until the room was quiet throughout.
+	const auto busy{[&room_id]
+	{
+		return !vm::eval::for_each([&room_id]
+		(const vm::eval &eval)
+		{
+			return eval.room_id != room_id || eval.phase < vm::phase::INDEX || eval.phase > vm::phase::RETIRE;
+		});
+	}};
+
+	static const size_t attempts_max
+	{
+		8
+	};
+
+	for(size_t attempt(1); ; ++attempt)
+	{
+		const auto head
+		{
+			m::head_idx(std::nothrow, room_id)
+		};
+
+		db::txn txn
+		{
+			*dbs::events
+		};
+
+		rebuild_txn(txn, room_id);
+		if(!busy() && m::head_idx(std::nothrow, room_id) == head && !busy())
+		{
+			txn();
+			return;
+		}
+
+		if(attempt >= attempts_max)
+		{
+			log::derror
+			{
+				log, "Rebuilding room_member_count for %s abandoned; room remained busy after %zu attempts.",
+				string_view{room_id},
+				attempt,
+			};
+
+			return;
+		}
+
+		ctx::sleep(milliseconds(attempt * 250));
+	}
+}
+
+void
+ircd::m::room::members::rebuild::rebuild_txn(db::txn &txn,
+                                             const room::id &room_id)
+{
+	// Remove the existing counts of the room.
+	db::domain &index
+	{
+		dbs::room_member_count
+	};
+
+	char pbuf[dbs::ROOM_MEMBER_COUNT_KEY_MAX_SIZE];
+	char buf[dbs::ROOM_MEMBER_COUNT_KEY_MAX_SIZE];
+	for(auto it(index.begin(dbs::room_member_count_key(pbuf, room_id))); bool(it); ++it)
+	{
+		const auto &[membership, host]
+		{
+			dbs::room_member_count_key(it->first)
+		};
+
+		db::txn::append
+		{
+			txn, index,
+			{
+				db::op::DELETE,
+				dbs::room_member_count_key(buf, room_id, membership, host),
+			}
+		};
+	}
+
+	// membership, host => count; an empty host is the total for membership.
+	std::map<std::pair<std::string, std::string>, uint64_t> counts;
+	const m::room::state state
+	{
+		room_id
+	};
+
+	state.for_each("m.room.member", [&counts]
+	(const string_view &type, const string_view &state_key, const event::idx &event_idx)
+	{
+		char membuf[32];
+		const string_view &membership
+		{
+			m::membership(membuf, event_idx)
+		};
+
+		if(!membership)
+			return true;
+
+		const m::user::id &user_id
+		{
+			state_key
+		};
+
+		++counts[{std::string{membership}, std::string{}}];
+		++counts[{std::string{membership}, std::string{user_id.host()}}];
+		return true;
+	});
+
+	for(const auto &[key, value] : counts)
+		db::txn::append
+		{
+			txn, index,
+			{
+				db::op::SET,
+				dbs::room_member_count_key(buf, room_id, key.first, key.second),
+				byte_view<string_view>(value),
+			}
+		};
+}
@@ -183,20 +183,27 @@ const
 		index.begin(query)
 	};
 
-	if(!it)
-		return false;
-
 	const string_view &key
 	{
-		lstrip(it->first, "\0"_sv)
+		it? lstrip(it->first, "\0"_sv): string_view{}
 	};
 
 	const string_view &key_origin
 	{
-		std::get<0>(dbs::room_joined_key(key))
+		key? std::get<0>(dbs::room_joined_key(key)): string_view{}
 	};
 
-	return key_origin == origin;
+	if(key && key_origin == origin)
+		return true;
+
+	if(likely(!m::partial(room)))
+		return false;
+
+	return !room::bootstrap::servers(room.room_id, [&origin]
+	(const string_view &server)
+	{
+		return server != origin;
+	});
 }
 
 void
@@ -225,6 +232,14 @@ const
 		index.begin(room.room_id)
 	};
 
+	// A room joined with partial state only has the members the resident
+	// server chose to send; the servers it listed at join are included too.
+	const bool partial
+	{
+		m::partial(room)
+	};
+
+	std::set<std::string, std::less<>> seen;
 	size_t repeat{0};
 	string_view last;
 	char lastbuf[rfc1035::NAME_BUFSIZE];
@@ -244,6 +259,9 @@ const
 			if(!view(origin))
 				return false;
 
+			if(unlikely(partial))
+				seen.emplace(origin);
+
 			// Save the witnessed origin string in this buffer for the first
 			// member of each origin; also reset the repeat ctr (see below).
 			last = { lastbuf, copy(lastbuf, origin) };
@@ -277,5 +295,15 @@ const
 		}
 	}
 
-	return true;
+	if(likely(!partial))
+		return true;
+
+	return room::bootstrap::servers(room.room_id, [&seen, &view]
+	(const string_view &origin)
+	{
+		if(seen.count(origin))
+			return true;
+
+		return view(origin);
+	});
 }
@@ -1015,4 +1015,7 @@ ircd::m::room::state::rebuild::rebuild(const room::id &room_id)
 	};
 
 	txn();
+
+	// Written outside of eval; caches of the room's state don't see it.
+	vm::invalidate(room_id);
 }
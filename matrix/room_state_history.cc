@@ -162,36 +162,121 @@ const
 	return for_each(type, string_view{}, closure);
 }
 
+/// The state at the bound is the newest entry below the bound for each
+/// (type, state_key) in the space. The whole state is constructed from the
+/// nearest snapshot, replaying the state changes between it and the bound.
+/// Otherwise the space is iterated, seeking over the entries of each
+/// (type, state_key) which are above the bound or superseded.
 bool
 ircd::m::room::state::history::for_each(const string_view &type,
                                         const string_view &state_key,
                                         const closure &closure)
 const
 {
+	if(!type && bound > -1)
+	{
+		const auto &[snapshot_depth, snapshot_seq]
+		{
+			dbs::room_state_snapshot_find(space.room.room_id, bound)
+		};
+
+		std::map<std::pair<std::string, std::string>, std::pair<int64_t, event::idx>> state;
+		const bool snapshot
+		{
+			snapshot_depth > -1 &&
+			dbs::room_state_snapshot_for_each(space.room.room_id, snapshot_depth, bound - 1, [&state]
+			(const string_view &type, const string_view &state_key, const int64_t &depth, const event::idx &event_idx)
+			{
+				const std::pair<int64_t, event::idx> val
+				{
+					depth, event_idx
+				};
+
+				auto it
+				{
+					state.try_emplace({std::string{type}, std::string{state_key}}, val)
+				};
+
+				if(!it.second && it.first->second < val)
+					it.first->second = val;
+			})
+		};
+
+		if(snapshot)
+		{
+			for(const auto &[key, val] : state)
+				if(!closure(key.first, key.second, val.first, val.second))
+					return false;
+
+			return true;
+		}
+	}
+
+	// Consecutive entries to pass over before seeking instead.
+	static const size_t skip_max
+	{
+		8
+	};
+
+	char buf[dbs::ROOM_STATE_SPACE_KEY_MAX_SIZE];
 	char type_buf[m::event::TYPE_MAX_SIZE];
 	char state_key_buf[m::event::STATE_KEY_MAX_SIZE];
 
 	string_view last_type;
 	string_view last_state_key;
 
-	return space.for_each(type, state_key, [&]
-	(const auto &type, const auto &state_key, const auto &depth, const auto &event_idx)
+	auto it
 	{
-		if(bound > -1 && depth >= bound)
-			return true;
+		dbs::room_state_space.begin(dbs::room_state_space_key(buf, space.room.room_id, type, state_key, bound > -1? bound - 1 : -1L, -1UL))
+	};
 
-		if(type == last_type && state_key == last_state_key)
-			return true;
+	for(size_t skipped(0); it; )
+	{
+		const auto &[_type, _state_key, _depth, _event_idx]
+		{
+			dbs::room_state_space_key(it->first)
+		};
 
-		if(!closure(type, state_key, depth, event_idx))
-			return false;
+		if(type && type != _type)
+			break;
 
-		if(type != last_type)
-			last_type = { type_buf, copy(type_buf, type) };
+		if(state_key && state_key != _state_key)
+			break;
 
-		if(state_key != last_state_key)
-			last_state_key = { state_key_buf, copy(state_key_buf, state_key) };
+		const bool superseded
+		{
+			_type == last_type && _state_key == last_state_key
+		};
 
-		return true;
-	});
+		if(!superseded && !(bound > -1 && _depth >= bound))
+		{
+			if(!closure(_type, _state_key, _depth, _event_idx))
+				return false;
+
+			if(_type != last_type)
+				last_type = { type_buf, copy(type_buf, _type) };
+
+			if(_state_key != last_state_key)
+				last_state_key = { state_key_buf, copy(state_key_buf, _state_key) };
+
+			skipped = 0;
+			++it;
+			continue;
+		}
+
+		if(++skipped < skip_max)
+		{
+			++it;
+			continue;
+		}
+
+		// Depth and event_idx sort descending; the lowest key of this
+		// (type, state_key) follows all of its entries.
+		skipped = 0;
+		seek(it, superseded?
+			dbs::room_state_space_key(buf, space.room.room_id, _type, _state_key, 0L, 0UL):
+			dbs::room_state_space_key(buf, space.room.room_id, _type, _state_key, bound - 1, -1UL));
+	}
+
+	return true;
 }
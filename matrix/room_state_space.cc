@@ -194,6 +194,18 @@ const
 
 ircd::m::room::state::space::rebuild::rebuild(const room::id &room_id)
 {
+	// Bulk operation; yield to latency-sensitive contexts while running.
+	const auto their_nice
+	{
+		ctx::nice(ctx::cur())
+	};
+
+	const unwind restore_nice{[&their_nice]
+	{
+		ctx::nice(ctx::cur(), their_nice);
+	}};
+
+	ctx::nice(ctx::cur(), 4);
 	db::txn txn
 	{
 		*m::dbs::events
@@ -289,6 +301,9 @@ ircd::m::room::state::space::rebuild::rebuild(const room::id &room_id)
 		};
 	}
 
+	// Snapshots were made from the prior space.
+	dbs::room_state_snapshot_clear(txn, room_id);
+
 	log::info
 	{
 		log, "room::state::space::rebuild %s complete msgs:%zu state:%zu del:%zu transaction elems:%zu size:%s",
@@ -301,4 +316,7 @@ ircd::m::room::state::space::rebuild::rebuild(const room::id &room_id)
 	};
 
 	txn();
+
+	// Written outside of eval; caches of the room's state don't see it.
+	vm::invalidate(room_id);
 }
@@ -10,44 +10,126 @@
 
 namespace ircd::m
 {
-	static bool visible_to_node(const room &, const string_view &node_id, const event &);
-	static bool visible_to_user(const room &, const string_view &history_visibility, const m::user::id &, const event &);
+	using visibility_lru = std::list<std::pair<std::string, std::shared_ptr<const visibility::timeline>>>;
+
+	static bool visible_to_node(const visibility &, const event &);
+	static bool visible_to_user(const visibility &, const string_view &history_visibility, const event &);
+	static string_view visibility_key(const mutable_buffer &, const room::id &, const string_view &state_key);
+	static void visibility_notify(const event &, vm::eval &);
+	static void visibility_invalidate(const event &);
+
+	extern hookfn<vm::eval &> visibility_hook;
+	extern hookfn<> visibility_invalidate_hook;
+	static visibility_lru visibility_timelines;
+	static std::map<string_view, visibility_lru::iterator, std::less<>> visibility_cache;
+	static uint64_t visibility_generation;
 }
 
+decltype(ircd::m::visibility::cache_max)
+ircd::m::visibility::cache_max
+{
+	{ "name",     "ircd.m.visible.cache.max" },
+	{ "default",  4096L                      },
+};
+
+decltype(ircd::m::visibility_hook)
+ircd::m::visibility_hook
+{
+	visibility_notify,
+	{
+		{ "_site",  "vm.notify" },
+	}
+};
+
+decltype(ircd::m::visibility_invalidate_hook)
+ircd::m::visibility_invalidate_hook
+{
+	visibility_invalidate,
+	{
+		{ "_site",  "vm.invalidate" },
+	}
+};
+
 bool
 ircd::m::visible(const m::event &event,
                  const string_view &mxid)
 {
-	const m::room room
+	const m::visibility visible
 	{
-		at<"room_id"_>(event), event.event_id
+		at<"room_id"_>(event), mxid
 	};
 
-	const m::room::state state
+	return visible(event);
+}
+
+size_t
+ircd::m::visible(const room::id &room_id,
+                 const string_view &mxid,
+                 const vector_view<const event> &events,
+                 const vector_view<bool> &out)
+{
+	assert(out.size() >= events.size());
+	const m::visibility visible
 	{
-		room
+		room_id, mxid
 	};
 
-	const event::idx visibility_event_idx
+	size_t ret(0);
+	for(size_t i(0); i < events.size() && i < out.size(); ++i)
+		ret += (out[i] = visible(events[i]));
+
+	return ret;
+}
+
+//
+// visibility
+//
+
+ircd::m::visibility::visibility(const m::room::id &room_id,
+                                const string_view &mxid)
+:room_id
+{
+	room_id
+}
+,mxid
+{
+	mxid
+}
+,user
+{
+	!empty(mxid) && m::valid(m::id::USER, mxid)
+}
+,node
+{
+	!empty(mxid) && !user && rfc3986::valid_remote(std::nothrow, mxid)
+}
+,history_visibility
+{
+	timeline::get(room_id, string_view{})
+}
+,membership
+{
+	user?
+		timeline::get(room_id, mxid):
+		nullptr
+}
+{
+}
+
+bool
+ircd::m::visibility::operator()(const m::event &event)
+const
+{
+	assert(json::get<"room_id"_>(event) == room_id);
+	const auto &depth
 	{
-		state.get(std::nothrow, "m.room.history_visibility", "")
+		json::get<"depth"_>(event)
 	};
 
-	char buf[32];
-	string_view history_visibility{"shared"};
-	m::get(std::nothrow, visibility_event_idx, "content", [&buf, &history_visibility]
-	(const json::object &content)
+	const string_view &history_visibility
 	{
-		const json::string &_history_visibility
-		{
-			content.get("history_visibility", "shared")
-		};
-
-		history_visibility = strncpy
-		{
-			buf, _history_visibility
-		};
-	});
+		this->history_visibility->at(depth)?: "shared"_sv
+	};
 
 	if(history_visibility == "world_readable")
 		return true;
@@ -55,38 +137,59 @@ ircd::m::visible(const m::event &event,
 	if(empty(mxid))
 		return false;
 
-	if(m::valid(m::id::USER, mxid))
-		return visible_to_user(room, history_visibility, mxid, event);
+	if(user)
+		return visible_to_user(*this, history_visibility, event);
 
-	if(rfc3986::valid_remote(std::nothrow, mxid))
-		return visible_to_node(room, mxid, event);
+	if(node)
+		return visible_to_node(*this, event);
 
 	throw m::UNSUPPORTED
 	{
 		"Cannot determine visibility of %s for '%s'",
-		string_view{room.room_id},
+		string_view{room_id},
 		mxid,
 	};
 }
 
+/// For a user: whether they're joined or invited to the room at the present
+/// state. For a node: whether it's presently joined to the room. This is
+/// only queried when an event's visibility depends on it.
 bool
-ircd::m::visible_to_user(const m::room &room,
+ircd::m::visibility::is_present()
+const
+{
+	if(present >= 0)
+		return present;
+
+	const m::room room
+	{
+		room_id
+	};
+
+	present = user?
+		m::membership(room, m::user::id(mxid), m::membership_positive): // join || invite
+		m::room::origins(room).has(mxid);
+
+	return present;
+}
+
+bool
+ircd::m::visible_to_user(const visibility &visible,
                          const string_view &history_visibility,
-                         const m::user::id &user_id,
                          const m::event &event)
 {
 	assert(history_visibility != "world_readable");
+	assert(visible.membership);
 
 	// Allow any member event where the state_key string is a user mxid.
 	if(json::get<"type"_>(event) == "m.room.member")
-		if(at<"state_key"_>(event) == user_id)
+		if(at<"state_key"_>(event) == visible.mxid)
 			return true;
 
 	// Get the membership of the user in the room at the event.
-	char buf[m::room::MEMBERSHIP_MAX_SIZE];
-	const string_view membership
+	const string_view &membership
 	{
-		m::membership(buf, room, user_id)
+		visible.membership->at(json::get<"depth"_>(event))
 	};
 
 	if(membership == "join")
@@ -106,24 +209,13 @@ ircd::m::visible_to_user(const m::room &room,
 	// or for graceful forward compatibility. We default to "shared" here.
 	//assert(history_visibility == "shared");
 
-	// If the room is not at the present event then we have to run another
-	// test for membership here. Otherwise the "join" test already failed.
-	if(!room.event_id)
-		return false;
-
-	// An m::room instance with no event_id is used to query the room at the
-	// present state.
-	const m::room present
-	{
-		room.room_id
-	};
-
-	return m::membership(present, user_id, m::membership_positive); // join || invite
+	// The membership at the event already failed the "join" test; run
+	// another test for the membership at the present.
+	return visible.is_present();
 }
 
 bool
-ircd::m::visible_to_node(const m::room &room,
-                         const string_view &node_id,
+ircd::m::visible_to_node(const visibility &visible,
                          const m::event &event)
 {
 	// Allow auth chain events XXX: this is too broad
@@ -133,17 +225,203 @@ ircd::m::visible_to_node(const m::room &room,
 	// Allow any event where the state_key string is a user mxid and the server
 	// is the host of that user. Note that applies to any type of event.
 	if(m::valid(m::id::USER, json::get<"state_key"_>(event)))
-		if(m::user::id(at<"state_key"_>(event)).host() == node_id)
+		if(m::user::id(at<"state_key"_>(event)).host() == visible.mxid)
 			return true;
 
-	const m::room::origins origins
+	// Allow joined servers
+	return visible.is_present();
+}
+
+//
+// visibility::timeline
+//
+
+/// Timelines for the history_visibility of a room (with an empty state_key)
+/// or the membership of a user in a room, cached.
+std::shared_ptr<const ircd::m::visibility::timeline>
+ircd::m::visibility::timeline::get(const m::room::id &room_id,
+                                   const string_view &state_key)
+{
+	char buf[id::MAX_SIZE * 2 + 1];
+	const string_view &key
 	{
-		room
+		visibility_key(buf, room_id, state_key)
 	};
 
-	// Allow joined servers
-	if(origins.has(node_id))
+	const auto it
+	{
+		visibility_cache.find(key)
+	};
+
+	if(it != end(visibility_cache))
+	{
+		visibility_timelines.splice(begin(visibility_timelines), visibility_timelines, it->second);
+		return it->second->second;
+	}
+
+	const auto generation
+	{
+		visibility_generation
+	};
+
+	auto ret
+	{
+		state_key?
+			std::make_shared<const timeline>(room_id, "m.room.member", state_key, "membership"):
+			std::make_shared<const timeline>(room_id, "m.room.history_visibility", state_key, "history_visibility")
+	};
+
+	// The timeline isn't cached if any state it depends on was committed
+	// while it was being made, or if another context beat us to it.
+	if(generation != visibility_generation || visibility_cache.count(key))
+		return ret;
+
+	if(!size_t(cache_max))
+		return ret;
+
+	while(!visibility_timelines.empty() && visibility_timelines.size() >= size_t(cache_max))
+	{
+		visibility_cache.erase(visibility_timelines.back().first);
+		visibility_timelines.pop_back();
+	}
+
+	visibility_timelines.emplace_front(std::string{key}, ret);
+	visibility_cache.emplace(visibility_timelines.front().first, begin(visibility_timelines));
+	return ret;
+}
+
+ircd::m::visibility::timeline::timeline(const m::room::id &room_id,
+                                        const string_view &type,
+                                        const string_view &state_key,
+                                        const string_view &content_key)
+{
+	const m::room::state::space space
+	{
+		m::room{room_id}
+	};
+
+	space.for_each(type, state_key, [this, &state_key, &content_key]
+	(const auto &, const auto &_state_key, const auto &depth, const auto &event_idx)
+	{
+		// An empty state_key is not a filter to the space.
+		if(_state_key != state_key)
+			return true;
+
+		std::string value;
+		m::get(std::nothrow, event_idx, "content", [&value, &content_key]
+		(const json::object &content)
+		{
+			value = json::string(content.get(content_key));
+		});
+
+		values.emplace_back(depth, std::move(value));
 		return true;
+	});
+}
+
+/// The value in effect at an event of the depth (i.e. the newest value below
+/// the depth) or empty when there is none.
+ircd::string_view
+ircd::m::visibility::timeline::at(const int64_t &depth)
+const
+{
+	const auto it
+	{
+		std::partition_point(begin(values), end(values), [&depth]
+		(const auto &value)
+		{
+			return value.first >= depth;
+		})
+	};
 
-	return false;
+	return it != end(values)?
+		string_view{it->second}:
+		string_view{};
+}
+
+/// A change to the history_visibility of a room or the membership of a user
+/// in it invalidates that timeline.
+void
+ircd::m::visibility_notify(const event &event,
+                           vm::eval &eval)
+{
+	const auto &type
+	{
+		json::get<"type"_>(event)
+	};
+
+	if(type != "m.room.member" && type != "m.room.history_visibility")
+		return;
+
+	if(!defined(json::get<"state_key"_>(event)))
+		return;
+
+	++visibility_generation;
+	char buf[id::MAX_SIZE * 2 + 1];
+	const string_view &key
+	{
+		visibility_key(buf, at<"room_id"_>(event), type == "m.room.member"?
+			string_view{at<"state_key"_>(event)}:
+			string_view{})
+	};
+
+	const auto it
+	{
+		visibility_cache.find(key)
+	};
+
+	if(it == end(visibility_cache))
+		return;
+
+	const auto lru_it(it->second);
+	visibility_cache.erase(it);
+	visibility_timelines.erase(lru_it);
+}
+
+/// Drops every timeline of the room, or all of them without a room_id.
+void
+ircd::m::visibility_invalidate(const event &event)
+{
+	const auto &room_id
+	{
+		json::get<"room_id"_>(event)
+	};
+
+	++visibility_generation;
+	if(!room_id)
+	{
+		visibility_cache.clear();
+		visibility_timelines.clear();
+		return;
+	}
+
+	char buf[id::MAX_SIZE * 2 + 1];
+	const string_view &prefix
+	{
+		visibility_key(buf, room_id, string_view{})
+	};
+
+	auto it
+	{
+		visibility_cache.lower_bound(prefix)
+	};
+
+	while(it != end(visibility_cache) && startswith(it->first, prefix))
+	{
+		const auto lru_it(it->second);
+		it = visibility_cache.erase(it);
+		visibility_timelines.erase(lru_it);
+	}
+}
+
+ircd::string_view
+ircd::m::visibility_key(const mutable_buffer &out_,
+                        const room::id &room_id,
+                        const string_view &state_key)
+{
+	mutable_buffer out{out_};
+	consume(out, copy(out, room_id));
+	consume(out, copy(out, '\0'));
+	consume(out, copy(out, trunc(state_key, id::MAX_SIZE)));
+	return { data(out_), data(out) };
 }
@@ -178,6 +178,193 @@ ircd::m::sync::loghead(const data &data)
 	};
 }
 
+//
+// fanout
+//
+
+decltype(ircd::m::sync::fanout::enable)
+ircd::m::sync::fanout::enable
+{
+	{ "name",         "ircd.m.sync.fanout.enable" },
+	{ "default",      true                        },
+	{ "description",
+
+	R"(
+	Compute the relevance of each new event once for every polling client:
+	the local membership of the room, the head and depth of the room, and
+	the rendering of the event common to all clients. Otherwise each client
+	computes these itself for every event.
+	)"}
+};
+
+decltype(ircd::m::sync::fanout::cache_max)
+ircd::m::sync::fanout::cache_max
+{
+	{ "name",     "ircd.m.sync.fanout.cache.max" },
+	{ "default",  64L                            },
+};
+
+decltype(ircd::m::sync::fanout::cache)
+ircd::m::sync::fanout::cache;
+
+decltype(ircd::m::sync::fanout::pending)
+ircd::m::sync::fanout::pending;
+
+decltype(ircd::m::sync::fanout::dock)
+ircd::m::sync::fanout::dock;
+
+/// Find the fanout for the event or compute it. When another client is
+/// computing it already, wait for that one rather than repeating the work.
+/// Null is returned if disabled or the computation failed; the caller then
+/// computes everything itself.
+std::shared_ptr<const ircd::m::sync::fanout>
+ircd::m::sync::fanout::get(const event &event,
+                           const event::idx &event_idx)
+{
+	if(!enable || !event_idx || !json::get<"room_id"_>(event))
+		return nullptr;
+
+	dock.wait([&event_idx]
+	{
+		return !pending.count(event_idx);
+	});
+
+	if(auto ret{find(event_idx)})
+		return ret;
+
+	pending.emplace(event_idx);
+	const unwind done{[&event_idx]
+	{
+		pending.erase(event_idx);
+		dock.notify_all();
+	}};
+
+	// Not constructed in place; the construction yields and the cache may
+	// be reordered by other clients meanwhile.
+	std::shared_ptr<const struct fanout> fanout;
+	try
+	{
+		fanout = std::make_shared<const struct fanout>(event, event_idx);
+	}
+	catch(const ctx::interrupted &)
+	{
+		throw;
+	}
+	catch(const std::exception &e)
+	{
+		log::derror
+		{
+			log, "fanout for %lu :%s",
+			event_idx,
+			e.what(),
+		};
+
+		return nullptr;
+	}
+
+	auto it
+	{
+		std::upper_bound(begin(cache), end(cache), event_idx, []
+		(const auto &event_idx, const auto &fanout)
+		{
+			return event_idx < fanout->event_idx;
+		})
+	};
+
+	cache.emplace(it, fanout);
+	while(cache.size() > size_t(cache_max))
+		cache.pop_front();
+
+	return fanout;
+}
+
+std::shared_ptr<const ircd::m::sync::fanout>
+ircd::m::sync::fanout::find(const event::idx &event_idx)
+{
+	const auto it
+	{
+		std::lower_bound(begin(cache), end(cache), event_idx, []
+		(const auto &fanout, const auto &event_idx)
+		{
+			return fanout->event_idx < event_idx;
+		})
+	};
+
+	return it != end(cache) && (*it)->event_idx == event_idx?
+		*it:
+		nullptr;
+}
+
+ircd::m::sync::fanout::fanout(const event &event,
+                              const event::idx &event_idx)
+:event_idx
+{
+	event_idx
+}
+{
+	const m::room room
+	{
+		json::get<"room_id"_>(event)
+	};
+
+	room_head = m::head_idx(std::nothrow, room);
+	room_depth = m::depth(std::nothrow, room);
+	redacted = !defined(json::get<"state_key"_>(event)) && m::redacted(event_idx);
+
+	const m::room::members members
+	{
+		room
+	};
+
+	members.for_each(string_view{}, my_host(), [this]
+	(const id::user &user_id, const event::idx &member_idx)
+	{
+		char buf[room::MEMBERSHIP_MAX_SIZE];
+		const string_view membership
+		{
+			m::membership(buf, member_idx)
+		};
+
+		if(membership)
+			this->members.emplace(user_id, membership);
+
+		return true;
+	});
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		event::MAX_SIZE + 16_KiB // prev_content
+	};
+
+	json::stack out{buf};
+	{
+		json::stack::object object
+		{
+			out
+		};
+
+		m::event::append::opts opts;
+		opts.event_idx = &event_idx;
+		m::event::append::members(object, event, opts);
+	}
+
+	rendered = out.completed();
+}
+
+ircd::string_view
+ircd::m::sync::fanout::membership(const id::user &user_id)
+const
+{
+	const auto it
+	{
+		members.find(user_id)
+	};
+
+	return it != end(members)?
+		string_view{it->second}:
+		string_view{};
+}
+
 //
 // item
 //
@@ -417,3 +417,273 @@ const
 		return closure(event_idx, state_key);
 	});
 }
+
+//
+// user::devices::cache
+//
+
+namespace ircd::m
+{
+	struct devices_cache_entry
+	{
+		json::strung device_keys;
+		json::strung master_key;
+		json::strung self_signing_key;
+		long stream_id {0};
+		system_point fetched;
+	};
+
+	using devices_cache_lru = std::list<std::pair<std::string, devices_cache_entry>>;
+
+	static void devices_cache_evict();
+
+	// Entries ordered most recently used first; the map indexes into it.
+	static devices_cache_lru devices_cache_list;
+	static std::map<string_view, devices_cache_lru::iterator, std::less<>> devices_cache;
+}
+
+decltype(ircd::m::user::devices::cache::enable)
+ircd::m::user::devices::cache::enable
+{
+	{ "name",     "ircd.m.user.devices.cache.enable" },
+	{ "default",  true                               },
+};
+
+decltype(ircd::m::user::devices::cache::ttl)
+ircd::m::user::devices::cache::ttl
+{
+	{ "name",     "ircd.m.user.devices.cache.ttl" },
+	{ "default",  3600L                           },
+};
+
+decltype(ircd::m::user::devices::cache::max)
+ircd::m::user::devices::cache::max
+{
+	{ "name",     "ircd.m.user.devices.cache.max" },
+	{ "default",  16384L                          },
+};
+
+size_t
+ircd::m::user::devices::cache::clear()
+{
+	const size_t ret
+	{
+		devices_cache.size()
+	};
+
+	devices_cache.clear();
+	devices_cache_list.clear();
+	return ret;
+}
+
+bool
+ircd::m::user::devices::cache::del(const m::user::id &user_id)
+{
+	const auto it
+	{
+		devices_cache.find(user_id)
+	};
+
+	if(it == end(devices_cache))
+		return false;
+
+	const auto lit(it->second);
+	devices_cache.erase(it);
+	devices_cache_list.erase(lit);
+	return true;
+}
+
+bool
+ircd::m::user::devices::cache::update(const device_list_update &update)
+try
+{
+	const m::user::id &user_id
+	{
+		json::at<"user_id"_>(update)
+	};
+
+	const auto it
+	{
+		devices_cache.find(user_id)
+	};
+
+	if(it == end(devices_cache))
+		return false;
+
+	auto &entry(it->second->second);
+	const long &stream_id
+	{
+		json::get<"stream_id"_>(update)
+	};
+
+	// Replayed or reordered update; whatever it describes is already
+	// reflected in (or superseded by) the entry.
+	if(stream_id && stream_id <= entry.stream_id)
+		return false;
+
+	// The update can only be applied to the entry when it references the
+	// last update we've applied; otherwise there is a gap in the sequence.
+	char buf[24];
+	const string_view last_id
+	{
+		lex_cast(entry.stream_id, buf)
+	};
+
+	const json::array &prev_id
+	{
+		json::get<"prev_id"_>(update)
+	};
+
+	// The keys query response carries no stream_id. Without a prior update
+	// to chain from, only the first update in the sequence (no prev_id) can
+	// be applied to a fetched entry; anything else may follow updates we
+	// never saw, so the entry is dropped for a refetch and this update's
+	// stream_id becomes the baseline for the next one.
+	const bool contiguous
+	{
+		entry.stream_id?
+			std::any_of(begin(prev_id), end(prev_id), [&last_id]
+			(const json::string &prev_id)
+			{
+				return prev_id == last_id;
+			}):
+			empty(prev_id)
+	};
+
+	entry.stream_id = stream_id;
+	const bool valid
+	{
+		contiguous && entry.fetched != system_point{}
+	};
+
+	const auto &device_id
+	{
+		json::at<"device_id"_>(update)
+	};
+
+	const json::object &keys
+	{
+		json::get<"keys"_>(update)
+	};
+
+	if(valid && json::get<"deleted"_>(update))
+		entry.device_keys = json::remove(entry.device_keys, device_id);
+	else if(valid && !empty(keys))
+		entry.device_keys = json::replace(entry.device_keys, json::member
+		{
+			device_id, keys
+		});
+	else if(!valid)
+	{
+		entry.device_keys = {};
+		entry.fetched = {};
+	}
+
+	return true;
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::derror
+	{
+		m::log, "Device keys cache update for %s :%s",
+		json::get<"user_id"_>(update),
+		e.what(),
+	};
+
+	del(json::get<"user_id"_>(update));
+	return false;
+}
+
+bool
+ircd::m::user::devices::cache::set(const m::user::id &user_id,
+                                   const json::object &device_keys,
+                                   const json::object &master_key,
+                                   const json::object &self_signing_key)
+{
+	if(!enable)
+		return false;
+
+	if(my_host(user_id.host()))
+		return false;
+
+	auto it
+	{
+		devices_cache.find(user_id)
+	};
+
+	if(it == end(devices_cache))
+	{
+		devices_cache_evict();
+		devices_cache_list.emplace_front(std::string{user_id}, devices_cache_entry{});
+		const auto lit(begin(devices_cache_list));
+		it = devices_cache.emplace(lit->first, lit).first;
+	}
+	else devices_cache_list.splice(begin(devices_cache_list), devices_cache_list, it->second);
+
+	// The stream_id is retained across refreshes so the EDU sequence
+	// can continue to be applied after a refetch.
+	auto &entry(it->second->second);
+	entry.device_keys = json::strung{device_keys};
+	entry.master_key = json::strung{master_key};
+	entry.self_signing_key = json::strung{self_signing_key};
+	entry.fetched = now<system_point>();
+	return true;
+}
+
+bool
+ircd::m::user::devices::cache::get(const m::user::id &user_id,
+                                   const closure &closure)
+{
+	if(!enable)
+		return false;
+
+	const auto it
+	{
+		devices_cache.find(user_id)
+	};
+
+	if(it == end(devices_cache))
+		return false;
+
+	const auto &entry(it->second->second);
+	if(entry.fetched == system_point{})
+		return false;
+
+	if(entry.fetched + seconds(ttl) < now<system_point>())
+		return false;
+
+	devices_cache_list.splice(begin(devices_cache_list), devices_cache_list, it->second);
+
+	closure
+	(
+		json::object{string_view{entry.device_keys}},
+		json::object{string_view{entry.master_key}},
+		json::object{string_view{entry.self_signing_key}}
+	);
+
+	return true;
+}
+
+void
+ircd::m::devices_cache_evict()
+{
+	const size_t max
+	{
+		user::devices::cache::max
+	};
+
+	while(!devices_cache_list.empty() && devices_cache_list.size() >= max)
+	{
+		const auto it
+		{
+			std::prev(end(devices_cache_list))
+		};
+
+		devices_cache.erase(it->first);
+		devices_cache_list.erase(it);
+	}
+}
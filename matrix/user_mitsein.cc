@@ -13,12 +13,28 @@ ircd::m::user::mitsein::has(const m::user &other,
                             const string_view &membership)
 const
 {
+	if(membership != "join" || !dbs::user_mitsein_built())
+		return !for_each(other, membership, []
+		(const m::room &, const string_view &)
+		{
+			// Break out of loop at first shared room
+			return false;
+		});
+
+	char buf[dbs::USER_MITSEIN_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		dbs::user_mitsein_key(buf, user.user_id, other.user_id)
+	};
+
+	if(db::has(dbs::user_mitsein, key))
+		return true;
+
 	// Return true if broken out of loop.
-	return !for_each(other, membership, []
-	(const m::room &, const string_view &)
+	return !for_each_large([&other]
+	(const m::room &room, const string_view &)
 	{
-		// Break out of loop at first shared room
-		return false;
+		return !m::membership(room, other.user_id, "join");
 	});
 }
 
@@ -62,15 +78,85 @@ bool
 ircd::m::user::mitsein::for_each(const string_view &membership,
                                  const closure_bool &closure)
 const
+{
+	if(membership != "join" || !dbs::user_mitsein_built())
+		return for_each_walk(membership, closure);
+
+	db::domain &index
+	{
+		dbs::user_mitsein
+	};
+
+	char buf[dbs::USER_MITSEIN_KEY_MAX_SIZE];
+	const string_view &key
+	{
+		dbs::user_mitsein_key(buf, user.user_id)
+	};
+
+	for(auto it(index.begin(key)); bool(it); ++it)
+		if(!closure(m::user{dbs::user_mitsein_key(it->first)}))
+			return false;
+
+	// Members of unindexed rooms which aren't already in the index.
+	std::set<std::string, std::less<>> seen;
+	return for_each_large([this, &closure, &seen]
+	(const m::room &room, const string_view &)
+	{
+		const m::room::members members
+		{
+			room
+		};
+
+		return members.for_each("join", [this, &closure, &seen]
+		(const user::id &other)
+		{
+			const auto it
+			{
+				seen.lower_bound(other)
+			};
+
+			if(it != end(seen) && *it == other)
+				return true;
+
+			seen.emplace_hint(it, std::string{other});
+			char buf[dbs::USER_MITSEIN_KEY_MAX_SIZE];
+			if(db::has(dbs::user_mitsein, dbs::user_mitsein_key(buf, user.user_id, other)))
+				return true;
+
+			return closure(m::user{other});
+		});
+	});
+}
+
+bool
+ircd::m::user::mitsein::for_each_large(const rooms::closure_bool &closure)
+const
+{
+	const m::user::rooms rooms
+	{
+		user
+	};
+
+	return rooms.for_each("join", rooms::closure_bool{[&closure]
+	(const m::room &room, const string_view &membership)
+	{
+		if(!dbs::user_mitsein_large(room.room_id))
+			return true;
+
+		return closure(room, membership);
+	}});
+}
+
+bool
+ircd::m::user::mitsein::for_each_walk(const string_view &membership,
+                                      const closure_bool &closure)
+const
 {
 	const m::user::rooms rooms
 	{
 		user
 	};
 
-	// here we gooooooo :/
-	///TODO: ideal: db schema
-	///TODO: minimally: custom alloc?
 	std::set<std::string, std::less<>> seen;
 	return rooms.for_each(membership, rooms::closure_bool{[&membership, &closure, &seen]
 	(m::room room, const string_view &)
@@ -143,3 +229,154 @@ const
 		return closure(room, membership);
 	}});
 }
+
+//
+// mitsein::rebuild
+//
+
+ircd::m::user::mitsein::rebuild::rebuild()
+{
+	// Membership indexed by live evals would be lost or counted twice. The
+	// hold admits the evals of this ctx, so the rebuild may be issued from
+	// a control room command.
+	const vm::hold hold;
+
+	db::txn txn
+	{
+		*dbs::events
+	};
+
+	// Start from an empty index; the pair counts are accumulated per room.
+	db::column &index
+	{
+		dbs::user_mitsein
+	};
+
+	for(auto it(index.begin()); bool(it); ++it)
+		db::txn::append
+		{
+			txn, index,
+			{
+				db::op::DELETE,
+				it->first,
+			}
+		};
+
+	txn();
+	txn.clear();
+
+	// Pair counts are accumulated in memory across rooms and written in
+	// bounded batches; a key is read back only when an earlier batch wrote.
+	std::map<std::string, uint64_t, std::less<>> counts;
+	size_t rooms(0), large(0), pairs(0), flushes(0);
+	const auto flush{[&txn, &counts, &flushes]
+	{
+		for(const auto &[key, count] : counts)
+		{
+			char valbuf[8];
+			bool found {false};
+			const string_view &existing
+			{
+				flushes?
+					db::read(dbs::user_mitsein, key, found, valbuf):
+					string_view{}
+			};
+
+			const uint64_t value
+			{
+				(found && size(existing) == sizeof(uint64_t)? uint64_t(byte_view<uint64_t>(existing)) : 0UL) + count
+			};
+
+			db::txn::append
+			{
+				txn, dbs::user_mitsein,
+				{
+					db::op::SET,
+					key,
+					byte_view<string_view>(value),
+				}
+			};
+		}
+
+		txn();
+		txn.clear();
+		counts.clear();
+		++flushes;
+	}};
+
+	m::rooms::opts opts;
+	opts.local_joined_only = false;
+	m::rooms::for_each(opts, [&txn, &counts, &flush, &rooms, &large, &pairs]
+	(const m::room::id &room_id)
+	{
+		const m::room::members members
+		{
+			room_id
+		};
+
+		std::vector<std::string> joined;
+		members.for_each("join", [&joined]
+		(const m::user::id &user_id)
+		{
+			joined.emplace_back(user_id);
+			return true;
+		});
+
+		++rooms;
+		if(joined.size() > size_t(dbs::user_mitsein_room_max))
+		{
+			char buf[dbs::USER_MITSEIN_KEY_MAX_SIZE];
+			static const uint64_t zero {0};
+			db::txn::append
+			{
+				txn, dbs::user_mitsein,
+				{
+					db::op::SET,
+					dbs::user_mitsein_room_key(buf, room_id),
+					byte_view<string_view>(zero),
+				}
+			};
+
+			++large;
+			return true;
+		}
+
+		for(const auto &a : joined)
+			for(const auto &b : joined)
+			{
+				char buf[dbs::USER_MITSEIN_KEY_MAX_SIZE];
+				const string_view &key
+				{
+					dbs::user_mitsein_key(buf, m::user::id{a}, m::user::id{b})
+				};
+
+				auto it
+				{
+					counts.lower_bound(key)
+				};
+
+				if(it == end(counts) || it->first != key)
+					it = counts.emplace_hint(it, std::string{key}, 0UL);
+
+				++it->second;
+				++pairs;
+			}
+
+		if(counts.size() >= 1_MiB)
+			flush();
+
+		return true;
+	});
+
+	flush();
+	dbs::user_mitsein_built(txn, true);
+	txn();
+
+	log::notice
+	{
+		m::log, "Rebuilt user_mitsein from %zu rooms (%zu unindexed) with %zu pairs.",
+		rooms,
+		large,
+		pairs,
+	};
+}
@@ -26,6 +26,25 @@ ircd::m::vm::default_copts;
 decltype(ircd::m::vm::default_opts)
 ircd::m::vm::default_opts;
 
+namespace ircd::m::vm::sequence
+{
+	static void follow_worker();
+
+	extern conf::item<milliseconds> follow_interval;
+	extern std::unique_ptr<context> follow_context;
+}
+
+/// Interval at which a secondary instance catches up with the primary.
+decltype(ircd::m::vm::sequence::follow_interval)
+ircd::m::vm::sequence::follow_interval
+{
+	{ "name",     "ircd.m.vm.sequence.follow.interval" },
+	{ "default",  250L                                 },
+};
+
+decltype(ircd::m::vm::sequence::follow_context)
+ircd::m::vm::sequence::follow_context;
+
 //
 // init
 //
@@ -37,6 +56,15 @@ ircd::m::vm::init::init()
 	sequence::committed = sequence::retired;
 	sequence::uncommitted = sequence::committed;
 
+	if(ircd::secondary)
+		sequence::follow_context.reset(new context
+		{
+			"m.vm.follow",
+			256_KiB,
+			&sequence::follow_worker,
+			context::POST
+		});
+
 	vm::ready = true;
 	vm::dock.notify_all();
 
@@ -56,6 +84,7 @@ ircd::m::vm::init::~init()
 noexcept
 {
 	vm::ready = false;
+	sequence::follow_context.reset(nullptr);
 
 	if(!eval::list.empty())
 		log::warning
@@ -110,6 +139,58 @@ noexcept
 	assert(retired == sequence::retired);
 }
 
+/// Secondary instances have no evals of their own; the sequence follows what
+/// the primary has written to the database.
+void
+ircd::m::vm::sequence::follow_worker()
+try
+{
+	while(1) try
+	{
+		ctx::sleep(milliseconds(follow_interval));
+		if(unlikely(!dbs::events->secondary))
+			return;
+
+		// Every database is followed, not just events; e.g. media.
+		db::refresh();
+
+		id::event::buf event_id;
+		const auto retired
+		{
+			sequence::get(event_id)
+		};
+
+		if(retired == sequence::retired)
+			continue;
+
+		assert(retired > sequence::retired);
+		sequence::retired = retired;
+		sequence::committed = retired;
+		sequence::uncommitted = retired;
+		sequence::dock.notify_all();
+	}
+	catch(const ctx::interrupted &)
+	{
+		throw;
+	}
+	catch(const std::exception &e)
+	{
+		log::error
+		{
+			log, "Following the primary's database :%s",
+			e.what(),
+		};
+	}
+}
+catch(const ctx::interrupted &)
+{
+	log::debug
+	{
+		log, "Follow worker interrupted @%lu",
+		sequence::retired,
+	};
+}
+
 //
 // m/vm.h
 //
@@ -211,6 +292,108 @@ ircd::m::vm::reflect(const enum fault &code)
 	return "??????";
 }
 
+//
+// invalidate
+//
+
+namespace ircd::m::vm
+{
+	extern hook::site<> invalidate_hook;
+}
+
+decltype(ircd::m::vm::invalidate_hook)
+ircd::m::vm::invalidate_hook
+{
+	{ "name",        "vm.invalidate" },
+	{ "exceptions",  false           },
+};
+
+/// Announce that the room (or every room when none is given) was written
+/// outside of evaluation, i.e. by an import or a rebuild. Nothing was sent
+/// to vm.notify for those writes, so anything cached from it is dropped.
+/// The hook receives an event with only the room_id.
+void
+ircd::m::vm::invalidate(const id::room &room_id)
+{
+	m::event event;
+	json::get<"room_id"_>(event) = room_id;
+	invalidate_hook(event);
+}
+
+//
+// hold
+//
+
+decltype(ircd::m::vm::hold::holder)
+ircd::m::vm::hold::holder;
+
+void
+ircd::m::vm::hold::wait(const eval &eval)
+{
+	if(likely(!holder))
+		return;
+
+	if(holder == ctx::current || eval.parent)
+		return;
+
+	vm::dock.wait([]
+	{
+		return !holder;
+	});
+}
+
+ircd::m::vm::hold::hold()
+{
+	vm::dock.wait([]
+	{
+		return !holder;
+	});
+
+	// Evals of this context can't finish until the hold is released; e.g. a
+	// command from a control room runs on the effect hook of its own eval.
+	uint own_executing(0), own_injecting(0);
+	eval::for_each(ctx::current, [&own_executing, &own_injecting]
+	(const eval &eval)
+	{
+		own_executing += eval.phase >= phase::EXECUTE;
+		own_injecting += eval.issue != nullptr;
+		return true;
+	});
+
+	holder = ctx::current;
+	log::notice
+	{
+		log, "Holding evaluation; waiting for exec:%u inject:%u pending:%zu (own exec:%u inject:%u)",
+		eval::executing,
+		eval::injecting,
+		sequence::pending,
+		own_executing,
+		own_injecting,
+	};
+
+	vm::dock.wait([&own_executing, &own_injecting]
+	{
+		return eval::executing <= own_executing && eval::injecting <= own_injecting;
+	});
+
+	sequence::dock.wait([]
+	{
+		return !sequence::pending;
+	});
+}
+
+ircd::m::vm::hold::~hold()
+noexcept
+{
+	assert(holder == ctx::current);
+	holder = nullptr;
+	vm::dock.notify_all();
+	log::notice
+	{
+		log, "Released hold on evaluation."
+	};
+}
+
 //
 // sequence
 //
@@ -135,6 +135,10 @@ try
 	// danger close; try increasing your stack size.
 	const ctx::stack_usage_assertion sua;
 
+	// Evals admitted by inject() already passed the hold.
+	if(!eval.issue)
+		hold::wait(eval);
+
 	// m::vm bookkeeping that someone entered this function
 	const scope_count executing
 	{
@@ -906,6 +910,7 @@ ircd::m::vm::write_append(eval &eval,
 	wopts.event_idx = eval.sequence;
 	wopts.json_source = opts.json_source;
 	wopts.appendix.set(dbs::appendix::ROOM_STATE_SPACE, opts.history);
+	wopts.appendix.set(dbs::appendix::ROOM_STATE_SNAPSHOT, opts.history);
 
 	// Don't update or resolve the room head with this shit.
 	const bool dummy_event(json::get<"type"_>(event) == "org.matrix.dummy_event");
@@ -948,7 +953,17 @@ ircd::m::vm::write_append(eval &eval,
 					room::auth::passfail{true, {}}
 			};
 
-			if(fail)
+			// A room joined with partial state lacks the membership to judge
+			// this by; the resync rechecks what is left out here.
+			if(fail && partial(room))
+				log::dwarning
+				{
+					log, "%s fails auth for partial state of %s; deferred to resync :%s",
+					loghead(eval),
+					string_view{room.room_id},
+					what(fail),
+				};
+			else if(fail)
 				log::dwarning
 				{
 					log, "%s fails auth for present state of %s :%s",
@@ -959,6 +974,8 @@ ircd::m::vm::write_append(eval &eval,
 
 			wopts.appendix.set(dbs::appendix::ROOM_STATE, pass);
 			wopts.appendix.set(dbs::appendix::ROOM_JOINED, pass);
+			wopts.appendix.set(dbs::appendix::USER_MITSEIN, pass);
+			wopts.appendix.set(dbs::appendix::ROOM_MEMBER_COUNT, pass);
 		}
 	}
 
@@ -10,10 +10,52 @@
 
 namespace ircd::m::vm
 {
+	struct authoring;
+
 	static fault inject3(eval &, json::iov &, const json::iov &);
 	static fault inject1(eval &, json::iov &, const json::iov &);
+
+	static event::id::buf authoring_state(authoring &, const room::id &, const string_view &type, const string_view &state_key);
+	static json::array authoring_auth(const mutable_buffer &, authoring &, const room::id &, const event &);
+	static json::array authoring_prev(const mutable_buffer &, const authoring &);
+	static void authoring_seed(authoring &, const json::array &prev_events, const int64_t &depth);
+	static std::shared_ptr<authoring> authoring_get(const room::id &);
+	static void authoring_notify(const event &, eval &);
+	static void authoring_invalidate(const event &);
+
+	extern conf::item<bool> authoring_enable;
+	extern conf::item<size_t> authoring_max;
+	extern conf::item<seconds> authoring_ttl;
+	extern hookfn<eval &> authoring_hook;
+	extern hookfn<> authoring_invalidate_hook;
 }
 
+/// Per-room context for authoring events on this server. This holds what
+/// inject() would otherwise query for every event: the room version, the
+/// event_id's of the auth state and a summary of the room head. It is kept
+/// current by observing every event evaluated in the room; state changes
+/// invalidate the affected auth reference and events which extend the known
+/// head replace it, while anything else drops the head summary so the next
+/// injection regenerates it from the database.
+struct ircd::m::vm::authoring
+{
+	struct head
+	{
+		event::id::buf event_id;
+		bool mine {false};
+	};
+
+	std::string room_version;
+	std::vector<head> heads;
+	int64_t depth {-1};
+	event::id::buf my_head;
+	int64_t my_depth {-1};
+	std::map<std::string, std::string, std::less<>> auth;
+	uint64_t generation {0};
+	system_point created;
+	system_point last;
+};
+
 ///
 /// Figure 1:
 ///          in     .  <-- injection
@@ -37,6 +79,9 @@ ircd::m::vm::inject(eval &eval,
                     json::iov &event,
                     const json::iov &contents)
 {
+	// Wait out any exclusive hold on the vm before composing anything.
+	hold::wait(eval);
+
 	// We need a copts structure in addition to the opts structure in order
 	// to inject a new event. If one isn't supplied a default is referenced.
 	eval.copts = !eval.copts?
@@ -98,6 +143,15 @@ ircd::m::vm::inject(eval &eval,
 			string_view{eval.room_id}
 	};
 
+	// Fetch or create the authoring context for this room; null when the
+	// cache is disabled or this injection isn't for an existing room.
+	const auto author
+	{
+		authoring_enable && eval.room_id && !is_room_create?
+			authoring_get(eval.room_id):
+			std::shared_ptr<authoring>{}
+	};
+
 	// Attempt to resolve the room version at this point for interface
 	// exposure at vm::eval::room_version.
 	char room_version_buf[room::VERSION_MAX_SIZE];
@@ -126,11 +180,18 @@ ircd::m::vm::inject(eval &eval,
 		!eval.room_id?
 			string_view{}:
 
+		// The authoring context has the version from a prior injection.
+		author && !empty(author->room_version)?
+			string_view{author->room_version}:
+
 		// Make a query to find the version. The version string will be hosted
 		// by the stack buffer.
 			m::version(room_version_buf, room{eval.room_id}, std::nothrow)
 	};
 
+	if(author && empty(author->room_version) && eval.room_version)
+		author->room_version = std::string{eval.room_version};
+
 	// Conditionally add the room_id from the eval structure to the actual
 	// event iov being injected. This is the inverse of the above satisfying
 	// the case where the room_id is supplied via the reference, not the iov;
@@ -197,19 +258,40 @@ ircd::m::vm::inject(eval &eval,
 			0UL
 	};
 
+	// When the authoring context has a summary of the head the references
+	// are composed from it without querying the room head.
+	const json::array cached_prev_events
+	{
+		add_prev_events && author?
+			authoring_prev(prev_buf, *author):
+			json::array{}
+	};
+
+	const bool cached_prev
+	{
+		!empty(cached_prev_events)
+	};
+
+	// Any event evaluated in the room while the head is being queried
+	// prevents the result from seeding the authoring context.
+	const uint64_t generation
+	{
+		author? author->generation: 0UL
+	};
+
 	// Conduct the prev_events composition into our buffer. This sub returns
 	// a finished json::array in our buffer as well as a depth integer for
 	// the event which will be using the references.
 	const room::head head
 	{
-		add_prev_events?
+		add_prev_events && !cached_prev?
 			room::head{room{eval.room_id}}:
 			room::head{}
 	};
 
 	const room::head::generate prev_events
 	{
-		prev_buf, head,
+		!cached_prev? mutable_buffer{prev_buf}: mutable_buffer{}, head,
 		{
 			16,                 // .limit = 16,
 			true,               // .need_top_head = true,
@@ -218,21 +300,34 @@ ircd::m::vm::inject(eval &eval,
 		}
 	};
 
+	if(author && add_prev_events && !cached_prev && author->generation == generation)
+		if(prev_events.array.count() < 16)
+			authoring_seed(*author, prev_events.array, prev_events.depth[1]);
+
+	const json::array &prev_events_array
+	{
+		cached_prev?
+			cached_prev_events:
+			prev_events.array
+	};
+
 	// Add the prev_events
 	const json::iov::add prev_events_
 	{
-		event, add_prev_events && !empty(prev_events.array),
+		event, add_prev_events && !empty(prev_events_array),
 		{
-			"prev_events", [&prev_events]() -> json::value
+			"prev_events", [&prev_events_array]() -> json::value
 			{
-				return prev_events.array;
+				return prev_events_array;
 			}
 		}
 	};
 
-	const auto &depth
+	const int64_t depth
 	{
-		prev_events.depth[1]
+		cached_prev?
+			author->depth:
+			prev_events.depth[1]
 	};
 
 	// Conditionally add the depth property to the event iov.
@@ -275,6 +370,8 @@ ircd::m::vm::inject(eval &eval,
 	// Conditionally compose the auth events. efault to an empty array.
 	const json::array auth_events
 	{
+		add_auth_events && author?
+			authoring_auth(auth_buf, *author, eval.room_id, m::event{event}):
 		add_auth_events?
 			room::auth::generate(auth_buf, m::room{eval.room_id}, m::event{event}):
 			json::empty_array
@@ -510,3 +607,451 @@ ircd::m::vm::inject3(eval &eval,
 
 	return execute(eval, event_tuple);
 }
+
+//
+// authoring
+//
+
+namespace ircd::m::vm
+{
+	static std::map<std::string, std::shared_ptr<authoring>, std::less<>> authoring_rooms;
+}
+
+decltype(ircd::m::vm::authoring_enable)
+ircd::m::vm::authoring_enable
+{
+	{ "name",         "ircd.m.vm.inject.authoring.enable" },
+	{ "default",      true                                },
+	{
+		"description",
+		"Cache the room version, auth references and head of rooms"
+		" this server authors events in so they are not queried for"
+		" every injection."
+	},
+};
+
+decltype(ircd::m::vm::authoring_max)
+ircd::m::vm::authoring_max
+{
+	{ "name",     "ircd.m.vm.inject.authoring.max" },
+	{ "default",  4096L                            },
+};
+
+decltype(ircd::m::vm::authoring_ttl)
+ircd::m::vm::authoring_ttl
+{
+	{ "name",     "ircd.m.vm.inject.authoring.ttl" },
+	{ "default",  900L                             },
+};
+
+decltype(ircd::m::vm::authoring_hook)
+ircd::m::vm::authoring_hook
+{
+	authoring_notify,
+	{
+		{ "_site",  "vm.notify" },
+	}
+};
+
+decltype(ircd::m::vm::authoring_invalidate_hook)
+ircd::m::vm::authoring_invalidate_hook
+{
+	authoring_invalidate,
+	{
+		{ "_site",  "vm.invalidate" },
+	}
+};
+
+/// The room was written outside of evaluation; nothing is kept for it.
+void
+ircd::m::vm::authoring_invalidate(const event &event)
+{
+	const auto &room_id
+	{
+		json::get<"room_id"_>(event)
+	};
+
+	if(!room_id)
+	{
+		authoring_rooms.clear();
+		return;
+	}
+
+	authoring_rooms.erase(room_id);
+}
+
+void
+ircd::m::vm::authoring_notify(const event &event,
+                              eval &eval)
+{
+	const auto &room_id
+	{
+		json::get<"room_id"_>(event)
+	};
+
+	if(!room_id)
+		return;
+
+	const auto it
+	{
+		authoring_rooms.find(room_id)
+	};
+
+	if(it == end(authoring_rooms))
+		return;
+
+	assert(it->second);
+	auto &author(*it->second);
+	++author.generation;
+
+	// Any reference we hold to the state this event replaces is dropped;
+	// it's looked up again when next needed.
+	if(defined(json::get<"state_key"_>(event)))
+	{
+		const auto &type(json::get<"type"_>(event));
+		const auto &state_key(json::get<"state_key"_>(event));
+		const auto key
+		{
+			std::string(type) + '\0' + std::string(state_key)
+		};
+
+		author.auth.erase(key);
+	}
+
+	const int64_t &depth
+	{
+		json::get<"depth"_>(event)
+	};
+
+	const bool mine
+	{
+		my(event)
+	};
+
+	if(mine && depth > author.my_depth)
+	{
+		author.my_head = event.event_id;
+		author.my_depth = depth;
+	}
+
+	// An event referencing every known head becomes the only head; this is
+	// the common case of a linear timeline. Otherwise the summary can't be
+	// advanced without the database and it is dropped.
+	const event::prev prev{event};
+	const bool extends
+	{
+		!author.heads.empty() &&
+		std::all_of(begin(author.heads), end(author.heads), [&prev]
+		(const auto &head)
+		{
+			for(size_t i(0); i < prev.prev_events_count(); ++i)
+				if(prev.prev_event(i) == head.event_id)
+					return true;
+
+			return false;
+		})
+	};
+
+	author.heads.clear();
+	if(!extends)
+		return;
+
+	author.heads.emplace_back(authoring::head
+	{
+		event.event_id, mine
+	});
+
+	author.depth = depth;
+}
+
+std::shared_ptr<ircd::m::vm::authoring>
+ircd::m::vm::authoring_get(const room::id &room_id)
+{
+	const auto now
+	{
+		ircd::now<system_point>()
+	};
+
+	auto it
+	{
+		authoring_rooms.lower_bound(room_id)
+	};
+
+	if(it != end(authoring_rooms) && it->first == room_id)
+	{
+		// Writers outside of evaluation call vm::invalidate(); this only
+		// bounds the age of anything those miss.
+		if(it->second->created + seconds(authoring_ttl) < now)
+			it->second = std::make_shared<authoring>();
+
+		if(it->second->created == system_point{})
+			it->second->created = now;
+
+		it->second->last = now;
+		return it->second;
+	}
+
+	const size_t max
+	{
+		authoring_max
+	};
+
+	if(!max)
+		return {};
+
+	while(authoring_rooms.size() >= max)
+		authoring_rooms.erase(std::min_element(begin(authoring_rooms), end(authoring_rooms), []
+		(const auto &a, const auto &b)
+		{
+			return a.second->last < b.second->last;
+		}));
+
+	auto author
+	{
+		std::make_shared<authoring>()
+	};
+
+	author->created = now;
+	author->last = now;
+	authoring_rooms.emplace(std::string{room_id}, author);
+	return author;
+}
+
+void
+ircd::m::vm::authoring_seed(authoring &author,
+                            const json::array &prev_events,
+                            const int64_t &depth)
+{
+	const bool v1
+	{
+		author.room_version == "1" || author.room_version == "2"
+	};
+
+	// The generated references are a superset of the head which may include
+	// a reference to our own most recent event; only a reference to an event
+	// sent from this server satisfies that requirement in authoring_prev().
+	author.heads.clear();
+	for(const auto &prev : prev_events)
+	{
+		const json::string event_id
+		{
+			v1? json::array(prev).at(0): prev
+		};
+
+		const auto event_idx
+		{
+			m::index(std::nothrow, m::event::id{event_id})
+		};
+
+		char buf[m::id::MAX_SIZE];
+		const string_view sender
+		{
+			event_idx?
+				string_view{m::get(std::nothrow, event_idx, "sender", buf)}:
+				string_view{}
+		};
+
+		const bool mine
+		{
+			sender && my(m::user::id{sender})
+		};
+
+		author.heads.emplace_back(authoring::head
+		{
+			event_id, mine
+		});
+	}
+
+	author.depth = depth;
+}
+
+ircd::json::array
+ircd::m::vm::authoring_prev(const mutable_buffer &buf,
+                            const authoring &author)
+{
+	if(author.heads.empty() || author.depth < 0)
+		return {};
+
+	const bool have_mine
+	{
+		std::any_of(begin(author.heads), end(author.heads), []
+		(const auto &head)
+		{
+			return head.mine;
+		})
+	};
+
+	// The head requires a reference to our own last event which we don't
+	// know; the generator has to find it.
+	if(!have_mine && !author.my_head)
+		return {};
+
+	const bool v1
+	{
+		author.room_version == "1" || author.room_version == "2"
+	};
+
+	const auto append{[&v1]
+	(json::stack::array &out, const event::id &event_id)
+	{
+		if(!v1)
+			return out.append(event_id);
+
+		json::stack::array prev{out};
+		prev.append(event_id);
+		{
+			json::stack::object nilly{prev};
+			json::stack::member willy
+			{
+				nilly, "", ""
+			};
+		}
+	}};
+
+	json::stack out{buf};
+	{
+		json::stack::array array{out};
+		for(const auto &head : author.heads)
+			append(array, head.event_id);
+
+		if(!have_mine)
+			append(array, author.my_head);
+	}
+
+	return out.completed();
+}
+
+ircd::json::array
+ircd::m::vm::authoring_auth(const mutable_buffer &buf,
+                            authoring &author,
+                            const room::id &room_id,
+                            const event &event)
+{
+	// Selection follows room::auth::generate() with references resolved
+	// through the authoring context.
+	const auto &type
+	{
+		json::get<"type"_>(event)
+	};
+
+	if(!type || type == "m.room.create")
+		return room::auth::generate(buf, room_id, event);
+
+	const bool v1
+	{
+		author.room_version == "1" || author.room_version == "2"
+	};
+
+	const auto append{[&v1]
+	(json::stack::array &out, const event::id &event_id)
+	{
+		if(!event_id)
+			return;
+
+		if(!v1)
+			return out.append(event_id);
+
+		json::stack::array auth{out};
+		auth.append(event_id);
+		{
+			json::stack::object nilly{auth};
+			json::stack::member willy
+			{
+				nilly, "", ""
+			};
+		}
+	}};
+
+	const m::user::id member_sender
+	{
+		defined(json::get<"sender"_>(event))?
+			m::user::id{at<"sender"_>(event)}:
+			m::user::id{}
+	};
+
+	m::user::id member_target;
+	if(json::get<"sender"_>(event) && json::get<"state_key"_>(event))
+		if(at<"sender"_>(event) != at<"state_key"_>(event))
+			if(valid(m::id::USER, at<"state_key"_>(event)))
+				member_target = at<"state_key"_>(event);
+
+	const bool need_join_rules
+	{
+		type == "m.room.member" &&
+		(!m::membership(event) || m::membership(event) == "join" || m::membership(event) == "invite")
+	};
+
+	// Resolve everything before composing; lookups may yield.
+	const event::id::buf refs[]
+	{
+		authoring_state(author, room_id, "m.room.create", ""),
+		authoring_state(author, room_id, "m.room.power_levels", ""),
+		need_join_rules?
+			authoring_state(author, room_id, "m.room.join_rules", ""):
+			event::id::buf{},
+		member_sender?
+			authoring_state(author, room_id, "m.room.member", member_sender):
+			event::id::buf{},
+		member_target?
+			authoring_state(author, room_id, "m.room.member", member_target):
+			event::id::buf{},
+	};
+
+	json::stack out{buf};
+	{
+		json::stack::array array{out};
+		for(const auto &event_id : refs)
+			append(array, event_id);
+	}
+
+	return out.completed();
+}
+
+ircd::m::event::id::buf
+ircd::m::vm::authoring_state(authoring &author,
+                             const room::id &room_id,
+                             const string_view &type,
+                             const string_view &state_key)
+{
+	auto key
+	{
+		std::string(type) + '\0' + std::string(state_key)
+	};
+
+	const auto it
+	{
+		author.auth.find(key)
+	};
+
+	// Absent state is cached as an empty string.
+	if(it != end(author.auth))
+		return !it->second.empty()?
+			event::id::buf{it->second}:
+			event::id::buf{};
+
+	const uint64_t generation
+	{
+		author.generation
+	};
+
+	event::id::buf ret;
+	const m::room::state state
+	{
+		room_id
+	};
+
+	const event::id::closure closure{[&ret]
+	(const event::id &event_id)
+	{
+		ret = event_id;
+	}};
+
+	state.get(std::nothrow, type, state_key, closure);
+
+	// Only remember the result if nothing was evaluated in the room while
+	// we were querying; the answer might already be stale.
+	if(author.generation == generation)
+		author.auth.emplace(std::move(key), std::string{ret});
+
+	return ret;
+}
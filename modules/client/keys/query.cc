@@ -17,6 +17,13 @@ namespace
 	using query_map = std::map<string_view, m::fed::user::keys::query>;
 	using failure_map = std::map<string_view, std::exception_ptr, std::less<>>;
 	using buffer_list = std::vector<unique_buffer<mutable_buffer>>;
+	using keys_map = std::map<std::string, std::string, std::less<>>;
+
+	struct cross_signing_map
+	{
+		keys_map master_keys;
+		keys_map self_signing_keys;
+	};
 }
 
 static host_users_map
@@ -37,15 +44,28 @@ send_requests(const host_users_map &,
 static void
 recv_response(const string_view &,
               m::fed::user::keys::query &,
+              const user_devices_map &,
               failure_map &,
+              cross_signing_map &,
               json::stack::object &);
 
 static void
-recv_responses(query_map &,
+recv_responses(const host_users_map &,
+               query_map &,
                failure_map &,
+               cross_signing_map &,
                json::stack::object &,
                const milliseconds &);
 
+static void
+respond_cached(host_users_map &,
+               cross_signing_map &,
+               json::stack::object &);
+
+static void
+respond_cross_signing(const cross_signing_map &,
+                      json::stack::object &);
+
 static void
 handle_failures(const failure_map &,
                 json::stack::object &);
@@ -84,6 +104,7 @@ method_post
 	query_resource, "POST", post__keys_query,
 	{
 		method_post.REQUIRES_AUTH
+		| method_post.RATE_LIMITED
 	}
 };
 
@@ -93,6 +114,7 @@ method_post__unstable
 	query_resource__unstable, "POST", post__keys_query,
 	{
 		method_post.REQUIRES_AUTH
+		| method_post.RATE_LIMITED
 	}
 };
 
@@ -147,18 +169,11 @@ post__keys_query(client &client,
 		request.at("device_keys")
 	};
 
-	const host_users_map map
+	host_users_map map
 	{
 		parse_user_request(request_keys)
 	};
 
-	buffer_list buffers;
-	failure_map failures;
-	query_map queries
-	{
-		send_requests(map, buffers, failures)
-	};
-
 	m::resource::response::chunked response
 	{
 		client, http::OK
@@ -174,11 +189,136 @@ post__keys_query(client &client,
 		out
 	};
 
-	recv_responses(queries, failures, top, timeout);
+	buffer_list buffers;
+	failure_map failures;
+	cross_signing_map cross_signing;
+	{
+		json::stack::object response_keys
+		{
+			top, "device_keys"
+		};
+
+		// Users answered from the cache are removed from the map so only
+		// the stale or unknown remainder is queried over federation.
+		respond_cached(map, cross_signing, response_keys);
+
+		query_map queries
+		{
+			send_requests(map, buffers, failures)
+		};
+
+		recv_responses(map, queries, failures, cross_signing, response_keys, timeout);
+	}
+
+	respond_cross_signing(cross_signing, top);
 	handle_failures(failures, top);
 	return {};
 }
 
+void
+respond_cross_signing(const cross_signing_map &cross_signing,
+                      json::stack::object &out)
+{
+	{
+		json::stack::object master_keys
+		{
+			out, "master_keys"
+		};
+
+		for(const auto &[user_id, key] : cross_signing.master_keys)
+			json::stack::member
+			{
+				master_keys, user_id, json::object{key}
+			};
+	}
+
+	{
+		json::stack::object self_signing_keys
+		{
+			out, "self_signing_keys"
+		};
+
+		for(const auto &[user_id, key] : cross_signing.self_signing_keys)
+			json::stack::member
+			{
+				self_signing_keys, user_id, json::object{key}
+			};
+	}
+}
+
+void
+respond_cached(host_users_map &hosts,
+               cross_signing_map &cross_signing,
+               json::stack::object &out)
+{
+	for(auto hit(begin(hosts)); hit != end(hosts); )
+	{
+		auto &[host, users] (*hit);
+		if(m::my_host(host))
+		{
+			++hit;
+			continue;
+		}
+
+		for(auto uit(begin(users)); uit != end(users); )
+		{
+			const auto &[user_id, device_ids] (*uit);
+
+			// Copied out of the cache because writing the response can yield.
+			std::string device_keys;
+			const bool cached
+			{
+				m::user::devices::cache::get(user_id, [&]
+				(const json::object &keys, const json::object &master_key, const json::object &self_signing_key)
+				{
+					device_keys = std::string{string_view{keys}};
+					if(!empty(master_key))
+						cross_signing.master_keys.emplace(user_id, master_key);
+
+					if(!empty(self_signing_key))
+						cross_signing.self_signing_keys.emplace(user_id, self_signing_key);
+				})
+			};
+
+			if(!cached)
+			{
+				++uit;
+				continue;
+			}
+
+			json::stack::object user_object
+			{
+				out, user_id
+			};
+
+			for(const auto &[device_id, keys] : json::object(device_keys))
+			{
+				const bool requested
+				{
+					empty(device_ids) ||
+					std::any_of(begin(device_ids), end(device_ids), [&device_id]
+					(const json::string &requested_id)
+					{
+						return requested_id == device_id;
+					})
+				};
+
+				if(requested)
+					json::stack::member
+					{
+						user_object, device_id, keys
+					};
+			}
+
+			uit = users.erase(uit);
+		}
+
+		hit = users.empty()?
+			hosts.erase(hit):
+			std::next(hit);
+	}
+}
+
 void
 handle_failures(const failure_map &failures,
                 json::stack::object &out)
@@ -200,9 +340,11 @@ handle_failures(const failure_map &failures,
 }
 
 void
-recv_responses(query_map &queries,
+recv_responses(const host_users_map &hosts,
+               query_map &queries,
                failure_map &failures,
-               json::stack::object &out,
+               cross_signing_map &cross_signing,
+               json::stack::object &response_keys,
                const milliseconds &timeout)
 try
 {
@@ -211,11 +353,6 @@ try
 		ircd::now<system_point>() + timeout
 	};
 
-	json::stack::object response_keys
-	{
-		out, "device_keys"
-	};
-
 	while(!queries.empty())
 	{
 		static const auto dereferencer{[]
@@ -243,7 +380,12 @@ try
 		if(failures.count(remote))
 			continue;
 
-		recv_response(remote, request, failures, response_keys);
+		const auto &users
+		{
+			hosts.at(remote)
+		};
+
+		recv_response(remote, request, users, failures, cross_signing, response_keys);
 	}
 }
 catch(const std::exception &)
@@ -255,7 +397,9 @@ catch(const std::exception &)
 void
 recv_response(const string_view &remote,
               m::fed::user::keys::query &request,
+              const user_devices_map &users,
               failure_map &failures,
+              cross_signing_map &cross_signing,
               json::stack::object &object)
 try
 {
@@ -274,6 +418,16 @@ try
 		response["device_keys"]
 	};
 
+	const json::object &master_keys
+	{
+		response["master_keys"]
+	};
+
+	const json::object &self_signing_keys
+	{
+		response["self_signing_keys"]
+	};
+
 	for(const auto &[_user_id, device_keys] : device_keys)
 	{
 		const m::user::id &user_id
@@ -281,16 +435,47 @@ try
 			_user_id
 		};
 
-		json::stack::object user_object
 		{
-			object, user_id
-		};
-
-		for(const auto &[device_id, keys] : json::object(device_keys))
-			json::stack::member
+			json::stack::object user_object
 			{
-				user_object, device_id, keys
+				object, user_id
 			};
+
+			for(const auto &[device_id, keys] : json::object(device_keys))
+				json::stack::member
+				{
+					user_object, device_id, keys
+				};
+		}
+
+		// Only the user's origin is authoritative for its keys.
+		if(user_id.host() != remote)
+			continue;
+
+		const json::object &master_key
+		{
+			master_keys[user_id]
+		};
+
+		const json::object &self_signing_key
+		{
+			self_signing_keys[user_id]
+		};
+
+		if(!empty(master_key))
+			cross_signing.master_keys.emplace(user_id, master_key);
+
+		if(!empty(self_signing_key))
+			cross_signing.self_signing_keys.emplace(user_id, self_signing_key);
+
+		// Responses filtered to specific devices are incomplete and not cached.
+		const auto it
+		{
+			users.find(user_id)
+		};
+
+		if(it != end(users) && empty(it->second))
+			m::user::devices::cache::set(user_id, device_keys, master_key, self_signing_key);
 	}
 }
 catch(const std::exception &e)
@@ -245,10 +245,7 @@ put__presence_status(client &client,
 			client, http::OK
 		};
 
-	const auto eid
-	{
-		m::presence::set(user, presence, status_msg)
-	};
+	m::presence::queue(user, presence, status_msg);
 
 	return m::resource::response
 	{
@@ -39,13 +39,19 @@ get__publicrooms(client &,
 resource::method
 post_method
 {
-	publicrooms_resource, "POST", get__publicrooms
+	publicrooms_resource, "POST", get__publicrooms,
+	{
+		post_method.READ_ONLY
+	}
 };
 
 resource::method
 get_method
 {
-	publicrooms_resource, "GET", get__publicrooms
+	publicrooms_resource, "GET", get__publicrooms,
+	{
+		get_method.READ_ONLY
+	}
 };
 
 resource::response
@@ -153,6 +153,11 @@ get__context(client &client,
 	}
 	counts;
 
+	const m::visibility visible
+	{
+		room_id, request.user_id
+	};
+
 	m::event::id::buf start;
 	{
 		json::stack::array array
@@ -172,7 +177,7 @@ get__context(client &client,
 		{
 			const m::event &event{*before};
 			start = event.event_id;
-			if(!visible(event, request.user_id))
+			if(!visible(event))
 				continue;
 
 			counts.before += _append(array, event, before.event_idx(), user_room, room_depth);
@@ -212,7 +217,7 @@ get__context(client &client,
 		{
 			const m::event &event{*after};
 			end = event.event_id;
-			if(!visible(event, request.user_id))
+			if(!visible(event))
 				continue;
 
 			counts.after += _append(array, event, after.event_idx(), user_room, room_depth);
@@ -270,7 +275,7 @@ get__context(client &client,
 			if(!seek(std::nothrow, event, event_idx))
 				return true;
 
-			if(!visible(event, request.user_id))
+			if(!visible(event))
 				return true;
 
 			counts.state += _append(array, event, event_idx, user_room, room_depth, false);
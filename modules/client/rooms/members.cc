@@ -12,6 +12,13 @@
 
 using namespace ircd;
 
+static conf::item<seconds>
+partial_state_wait
+{
+	{ "name",     "ircd.client.rooms.members.partial_state.wait" },
+	{ "default",  15L                                            },
+};
+
 m::resource::response
 get__members(client &client,
              const m::resource::request &request,
@@ -88,6 +95,11 @@ get__members(client &client,
 			string_view{room_id}
 		};
 
+	// Membership is incomplete in a room joined with partial state until the
+	// resync completes; give it a chance before answering.
+	if(m::partial(room))
+		m::room::bootstrap::wait(room_id, seconds(partial_state_wait));
+
 	m::resource::response::chunked response
 	{
 		client, http::OK
@@ -156,7 +168,7 @@ get__members(client &client,
 			m::prefetch(event_idx, "content");
 
 		// Prefetch the event JSON
-		m::prefetch(event_idx);
+		m::prefetch(event_idx, m::event::fetch::interactive_opts);
 		return true;
 	});
 
@@ -205,6 +217,11 @@ get__joined_members(client &client,
 			string_view{room_id}
 		};
 
+	// Membership is incomplete in a room joined with partial state until the
+	// resync completes; give it a chance before answering.
+	if(m::partial(room))
+		m::room::bootstrap::wait(room_id, seconds(partial_state_wait));
+
 	m::resource::response::chunked response
 	{
 		client, http::OK
@@ -233,7 +250,7 @@ get__joined_members(client &client,
 	members.for_each("join", []
 	(const m::user::id &user_id, const m::event::idx &event_idx)
 	{
-		m::prefetch(event_idx);
+		m::prefetch(event_idx, m::event::fetch::interactive_opts);
 		return true;
 	});
 
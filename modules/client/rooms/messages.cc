@@ -131,6 +131,11 @@ get__messages(client &client,
 		room
 	};
 
+	const m::visibility visible
+	{
+		room_id, request.user_id
+	};
+
 	for(; it; page.dir == 'b'? --it : ++it)
 	{
 		const m::event &event
@@ -146,7 +151,7 @@ get__messages(client &client,
 		{
 			(empty(filter_json) || match(filter, event))
 
-			&& visible(event, request.user_id)
+			&& visible(event)
 
 			&& _append(chunk, event, it.event_idx(), user_room, room_depth)
 		};
@@ -184,7 +189,7 @@ get__messages(client &client,
 	for(size_t i(0); i <= page.limit && it; ++i, page.dir == 'b'? --it : ++it)
 	{
 		const auto &event_idx(it.event_idx());
-		postfetched += m::prefetch(event_idx);
+		postfetched += m::prefetch(event_idx, m::event::fetch::interactive_opts);
 	}
 
 	log::debug
@@ -91,13 +91,51 @@ get_rooms(client &client,
 m::resource::method
 method_get
 {
-	rooms_resource, "GET", get_rooms
+	rooms_resource, "GET", get_rooms,
+	{
+		// Flags
+		method_get.READ_ONLY,
+
+		// Timeout
+		30s,
+
+		// Payload maximum
+		128_KiB,
+
+		// MIME type
+		{},
+
+		// Concurrency maximum for all origins
+		0,
+
+		// Concurrency maximum for each origin (i.e. /messages floods)
+		16,
+	}
 };
 
 m::resource::method
 method_get_unstable
 {
-	rooms_resource_unstable, "GET", get_rooms
+	rooms_resource_unstable, "GET", get_rooms,
+	{
+		// Flags
+		method_get_unstable.READ_ONLY,
+
+		// Timeout
+		30s,
+
+		// Payload maximum
+		128_KiB,
+
+		// MIME type
+		{},
+
+		// Concurrency maximum for all origins
+		0,
+
+		// Concurrency maximum for each origin (i.e. /messages floods)
+		16,
+	}
 };
 
 m::resource::response
@@ -10,13 +10,30 @@
 
 using namespace ircd;
 
+namespace
+{
+	struct target_message
+	{
+		m::user::id user_id;
+		string_view device_id;
+		json::object message;
+	};
+
+	using target_messages = std::vector<target_message>;
+}
+
 static void
 send_to_device(const string_view &txnid,
                const m::user::id &sender,
                const m::user::id &target,
-               const string_view &device_id,
                const string_view &type,
-               const json::object &message);
+               const json::object &messages);
+
+static void
+send_to_host(const string_view &txnid,
+             const m::user::id &sender,
+             const string_view &type,
+             const target_messages &);
 
 static m::resource::response
 put__send_to_device(client &client,
@@ -66,6 +83,13 @@ method_put__unstable
 	}
 };
 
+conf::item<size_t>
+send_to_device_batch_max_size
+{
+	{ "name",     "ircd.client.send_to_device.batch.max_size" },
+	{ "default",  long(32_KiB)                                 },
+};
+
 m::resource::response
 put__send_to_device(client &client,
                     const m::resource::request &request)
@@ -99,9 +123,31 @@ put__send_to_device(client &client,
 		request["messages"]
 	};
 
+	// Messages are grouped by the server hosting each target so every
+	// destination (including ourselves) is sent batches rather than one
+	// EDU for each device.
+	std::map<string_view, target_messages> hosts;
 	for(const auto &[user_id, messages] : targets)
+	{
+		const m::user::id target
+		{
+			user_id
+		};
+
+		auto &batch
+		{
+			hosts[target.host()]
+		};
+
 		for(const auto &[device_id, message] : json::object(messages))
-			send_to_device(txnid, request.user_id, user_id, device_id, type, message);
+			batch.emplace_back(target_message
+			{
+				target, device_id, message
+			});
+	}
+
+	for(const auto &[host, messages] : hosts)
+		send_to_host(txnid, request.user_id, type, messages);
 
 	return m::resource::response
 	{
@@ -110,39 +156,87 @@ put__send_to_device(client &client,
 }
 
 void
-send_to_device(const string_view &txnid,
-               const m::user::id &sender,
-               const m::user::id &target,
-               const string_view &device_id,
-               const string_view &type,
-               const json::object &message)
-try
+send_to_host(const string_view &txnid,
+             const m::user::id &sender,
+             const string_view &type,
+             const target_messages &messages)
 {
+	const size_t max_size
+	{
+		send_to_device_batch_max_size
+	};
+
 	const unique_buffer<mutable_buffer> buf
 	{
-		48_KiB
+		m::event::MAX_SIZE
 	};
 
-	json::stack out{buf};
+	size_t batch(0);
+	for(auto it(begin(messages)); it != end(messages); ++batch)
 	{
-		json::stack::object _messages
+		// Find the end of this batch; at least one message is always taken.
+		auto stop(it);
+		for(size_t len(0); stop != end(messages); ++stop)
 		{
-			out
-		};
+			len += size(stop->user_id) + size(stop->device_id) + size(stop->message) + 8;
+			if(len > max_size && stop != it)
+				break;
+		}
 
-		json::stack::object _target
+		const m::user::id &target
 		{
-			_messages, target
+			it->user_id
 		};
 
-		json::stack::object _device
+		json::stack out{buf};
 		{
-			_target, device_id
+			json::stack::object _messages
+			{
+				out
+			};
+
+			while(it != stop)
+			{
+				const m::user::id &user_id
+				{
+					it->user_id
+				};
+
+				json::stack::object _target
+				{
+					_messages, user_id
+				};
+
+				for(; it != stop && it->user_id == user_id; ++it)
+					json::stack::member
+					{
+						_target, it->device_id, it->message
+					};
+			}
+		}
+
+		// Each batch after the first needs its own message_id so receivers
+		// don't deduplicate it against the first.
+		char idbuf[320];
+		const string_view message_id
+		{
+			batch?
+				fmt::sprintf{idbuf, "%s.%zu", txnid, batch}:
+				txnid
 		};
 
-		_device.append(message);
+		send_to_device(message_id, sender, target, type, out.completed());
 	}
+}
 
+void
+send_to_device(const string_view &txnid,
+               const m::user::id &sender,
+               const m::user::id &target,
+               const string_view &type,
+               const json::object &messages)
+try
+{
 	json::iov event, content;
 	const json::iov::push push[]
 	{
@@ -151,7 +245,7 @@ try
 		{ content, { "sender",       sender                } },
 		{ content, { "target",       target                } },
 		{ content, { "message_id",   txnid                 } },
-		{ content, { "messages",     out.completed()       } },
+		{ content, { "messages",     messages              } },
 	};
 
 	m::vm::copts opts;
@@ -172,12 +266,12 @@ catch(const std::exception &e)
 {
 	log::error
 	{
-		m::log, "Send %s '%s' by %s to device '%s' belonging to %s :%s",
+		m::log, "Send %s '%s' by %s to %zu users on %s :%s",
 		type,
 		txnid,
 		string_view{sender},
-		device_id,
-		string_view{target},
+		messages.size(),
+		target.host(),
 		e.what(),
 	};
 }
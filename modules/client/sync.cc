@@ -16,8 +16,9 @@ namespace ircd::m::sync
 	struct data;
 	struct response;
 
-	static const_buffer flush(data &, resource::response::chunked &, const const_buffer &);
+	static const_buffer flush(data &, resource::response::chunked &, std::string *const &, const const_buffer &);
 	static void empty_response(data &, const uint64_t &next_batch);
+	static bool snapshot_handle(data &);
 	static bool linear_handle(data &);
 	static bool polylog_handle(data &);
 	static bool longpoll_handle(data &);
@@ -41,6 +42,33 @@ namespace ircd::m::sync::longpoll
 	static void fini() noexcept;
 }
 
+namespace ircd::m::sync::snapshot
+{
+	struct entry;
+	using lru = std::list<std::pair<std::string, std::shared_ptr<const entry>>>;
+
+	static bool live(const string_view &item_name);
+	static void strip(json::stack::object &, const json::object &, const size_t &depth = 0);
+	static std::string strip(const string_view &content);
+	static std::shared_ptr<const entry> find(const data &);
+	static void save(const data &, std::string content, const uint64_t &next_batch);
+	static void drop(const lru::iterator &);
+	static void drop_room(const string_view &room_id);
+	static void drop_user(const string_view &user_id);
+	static void handle_notify(const m::event &, m::vm::eval &);
+	static void handle_invalidate(const m::event &);
+
+	extern conf::item<bool> enable;
+	extern conf::item<size_t> max_size;
+	extern conf::item<size_t> cache_max;
+	extern m::hookfn<m::vm::eval &> notified;
+	extern m::hookfn<> invalidated;
+	extern lru cache_lru;
+	extern std::map<string_view, lru::iterator, std::less<>> cache;
+	extern std::multimap<std::string, string_view, std::less<>> cache_rooms;
+	extern size_t cache_bytes;
+}
+
 ircd::mapi::header
 IRCD_MODULE
 {
@@ -254,12 +282,25 @@ ircd::m::sync::handle_get(client &client,
 		)
 	};
 
+	// Conditions for capturing the output of this sync as the snapshot
+	// served to the next initial sync from this device.
+	const bool should_snapshot
+	{
+		snapshot::enable
+		&& initial_sync
+		&& !data.phased
+		&& !args.semaphore
+		&& !args.full_state
+	};
+
 	// Start the chunked encoded response.
 	resource::response::chunked response
 	{
 		client, http::OK, buffer_size
 	};
 
+	std::string capture;
+
 	// Start the JSON stream for this response. As the sync items are iterated
 	// the supplied response buffer will be flushed out to the supplied
 	// callback; in this case, both are provided by the chunked encoding
@@ -269,7 +310,7 @@ ircd::m::sync::handle_get(client &client,
 	json::stack out
 	{
 		response.buf,
-		std::bind(sync::flush, std::ref(data), std::ref(response), ph::_1),
+		std::bind(sync::flush, std::ref(data), std::ref(response), should_snapshot? &capture: nullptr, ph::_1),
 		size_t(flush_hiwat)
 	};
 	data.out = &out;
@@ -349,11 +390,18 @@ ircd::m::sync::handle_get(client &client,
 	{
 		should_linear?
 			linear_handle(data):
+		should_snapshot && snapshot_handle(data)?
+			true:
 		should_polylog?
 			polylog_handle(data):
 			false
 	};
 
+	// The output of a polylog initial sync is retained for the next one. All
+	// but the residue in the stack buffer has been flushed into the capture.
+	if(complete && should_snapshot && should_polylog && capture.size() < size_t(snapshot::max_size))
+		snapshot::save(data, snapshot::strip(capture + std::string(out.completed())), data.range.second);
+
 	if(complete)
 		return std::move(response);
 
@@ -413,6 +461,7 @@ ircd::m::sync::empty_response(data &data,
 ircd::const_buffer
 ircd::m::sync::flush(data &data,
                      resource::response::chunked &response,
+                     std::string *const &capture,
                      const const_buffer &buffer)
 {
 	assert(size(buffer) <= size(response.buf));
@@ -421,6 +470,10 @@ ircd::m::sync::flush(data &data,
 		response.flush(buffer)
 	};
 
+	// Stop capturing once the snapshot would exceed the limit.
+	if(capture && capture->size() < size_t(snapshot::max_size))
+		capture->append(buffer::data(wrote), size(wrote));
+
 	assert(size(wrote) <= size(buffer));
 	if(data.stats)
 	{
@@ -665,6 +718,16 @@ ircd::m::sync::linear_proffer(data &data,
 			data.event_idx, event_idx
 		};
 
+		const auto fanout
+		{
+			fanout::find(event_idx)
+		};
+
+		const scope_restore their_fanout
+		{
+			data.fanout, fanout.get()
+		};
+
 		wb([&data, &ret, &event_idx]
 		(const mutable_buffer &buf)
 		{
@@ -945,6 +1008,18 @@ ircd::m::sync::longpoll::polled(data &data,
 		data.event_idx, event.event_idx
 	};
 
+	// The first client woken for this event computes what is common to all
+	// of them; the notify hook is left to only wake them.
+	const auto fanout
+	{
+		fanout::get(event, event.event_idx)
+	};
+
+	const scope_restore their_fanout
+	{
+		data.fanout, fanout.get()
+	};
+
 	const unique_buffer<mutable_buffer> scratch
 	{
 		128_KiB
@@ -1074,3 +1149,534 @@ ircd::m::sync::data::~data()
 noexcept
 {
 }
+
+//
+// snapshot
+//
+// The result of a polylog initial sync is retained per device and served to
+// the next initial sync from that device merged with the linear sync of the
+// events since. The linear sync can't amend the state of a room in the
+// snapshot, so entries are dropped on a state change in any room they
+// include, on changes to the user's memberships, and when rooms are written
+// outside of eval. Entries are LZ4 compressed when available and evicted in
+// least-recently-used order.
+//
+
+struct ircd::m::sync::snapshot::entry
+{
+	std::string filter_id;
+	uint64_t next_batch {0};
+	system_point made;
+	std::string content;
+	size_t size {0};
+	bool compressed {false};
+	std::vector<std::string> rooms;
+};
+
+decltype(ircd::m::sync::snapshot::enable)
+ircd::m::sync::snapshot::enable
+{
+	{ "name",         "ircd.client.sync.snapshot.enable" },
+	{ "default",      false                              },
+	{ "description",
+
+	R"(
+	Retain the result of an initial sync for each device and serve it to the
+	next initial sync from that device, merged with a linear sync of the
+	events since. Clients clearing their cache will not recompute every room.
+	)"}
+};
+
+decltype(ircd::m::sync::snapshot::max_size)
+ircd::m::sync::snapshot::max_size
+{
+	{ "name",     "ircd.client.sync.snapshot.max_size" },
+	{ "default",  long(8_MiB)                          },
+};
+
+decltype(ircd::m::sync::snapshot::cache_max)
+ircd::m::sync::snapshot::cache_max
+{
+	{ "name",     "ircd.client.sync.snapshot.cache.max" },
+	{ "default",  long(256_MiB)                         },
+};
+
+decltype(ircd::m::sync::snapshot::notified)
+ircd::m::sync::snapshot::notified
+{
+	handle_notify,
+	{
+		{ "_site",  "vm.notify"  },
+	}
+};
+
+decltype(ircd::m::sync::snapshot::invalidated)
+ircd::m::sync::snapshot::invalidated
+{
+	handle_invalidate,
+	{
+		{ "_site",  "vm.invalidate"  },
+	}
+};
+
+decltype(ircd::m::sync::snapshot::cache_lru)
+ircd::m::sync::snapshot::cache_lru;
+
+decltype(ircd::m::sync::snapshot::cache)
+ircd::m::sync::snapshot::cache;
+
+decltype(ircd::m::sync::snapshot::cache_rooms)
+ircd::m::sync::snapshot::cache_rooms;
+
+decltype(ircd::m::sync::snapshot::cache_bytes)
+ircd::m::sync::snapshot::cache_bytes;
+
+/// Serve the snapshot for this device and merge the linear sync of events
+/// since the snapshot was taken. Returns false when there is no snapshot or
+/// too many events have occurred since; a polylog sync is conducted instead.
+bool
+ircd::m::sync::snapshot_handle(data &data)
+try
+{
+	const auto snapshot
+	{
+		snapshot::find(data)
+	};
+
+	if(!snapshot)
+		return false;
+
+	if(data.range.second - snapshot->next_batch > size_t(linear_delta_max))
+		return false;
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		std::max(size_t(linear_buffer_size), size_t(128_KiB))
+	};
+
+	// The events since the snapshot; the range is restored afterward for the
+	// live members, which are rendered as for any initial sync.
+	window_buffer wb{buf};
+	const auto proffered
+	{
+		[&data, &wb, &snapshot]
+		{
+			const scope_restore range_first
+			{
+				data.range.first, snapshot->next_batch
+			};
+
+			return linear_proffer(data, wb);
+		}()
+	};
+
+	const auto &[last, completed]
+	{
+		proffered
+	};
+
+	if(!completed)
+		return false;
+
+	char since_buf[64];
+	const json::strung next_batch
+	{
+		json::members
+		{
+			{ "next_batch", make_since(since_buf, data.range.second) }
+		}
+	};
+
+	// The live members are rendered below instead; the snapshot was saved
+	// without them and they are stripped from the linear residue here.
+	const std::string residue
+	{
+		snapshot::strip(wb.completed())
+	};
+
+	const unique_buffer<mutable_buffer> inflated
+	{
+		snapshot->compressed? snapshot->size : 0UL
+	};
+
+	const string_view content
+	{
+		snapshot->compressed?
+			string_view{lz4::decompress(inflated, const_buffer{snapshot->content})}:
+			string_view{snapshot->content}
+	};
+
+	// The snapshot, the residues of the linear sync, and the new next_batch
+	// are merged as a vector; later members supersede earlier ones.
+	std::string vector;
+	vector.reserve(size(content) + size(residue) + size(next_batch));
+	vector.append(content);
+	vector.append(residue);
+	vector.append(next_batch);
+
+	json::stack::object top
+	{
+		*data.out
+	};
+
+	json::merge(top, json::vector{vector});
+
+	m::sync::for_each(string_view{}, [&data]
+	(item &item)
+	{
+		if(!snapshot::live(item.name()))
+			return true;
+
+		json::stack::checkpoint checkpoint
+		{
+			*data.out
+		};
+
+		json::stack::object object
+		{
+			*data.out, item.member_name()
+		};
+
+		if(!item.polylog(data))
+			checkpoint.committing(false);
+
+		return true;
+	});
+
+	log::debug
+	{
+		log, "request %s snapshot @%lu delta events:%zu",
+		loghead(data),
+		snapshot->next_batch,
+		last? data.range.second - snapshot->next_batch : 0UL,
+	};
+
+	return true;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "snapshot %s FAILED :%s",
+		loghead(data),
+		e.what()
+	};
+
+	throw;
+}
+
+/// Top-level members which are not replayed from a snapshot: messages which
+/// were delivered already, and current states which would be stale.
+bool
+ircd::m::sync::snapshot::live(const string_view &item_name)
+{
+	return item_name == "to_device"
+	|| item_name == "presence"
+	|| item_name == "device_one_time_keys_count";
+}
+
+/// The content is a vector of sync output objects (the linear residue has
+/// one for each event); each is stripped and the result is again a vector.
+std::string
+ircd::m::sync::snapshot::strip(const string_view &content)
+{
+	std::string ret;
+	ret.reserve(size(content));
+	for(const json::object object : json::vector{content})
+	{
+		const unique_buffer<mutable_buffer> buf
+		{
+			size(string_view(object)) + 16
+		};
+
+		json::stack out{buf};
+		{
+			json::stack::object top
+			{
+				out
+			};
+
+			strip(top, object);
+		}
+
+		ret.append(out.completed());
+	}
+
+	return ret;
+}
+
+/// Copy the sync output without the live members; these are the top-level
+/// members named by live() and the typing notifications in the ephemeral
+/// events of each room (rooms.<membership>.<room_id>.ephemeral).
+void
+ircd::m::sync::snapshot::strip(json::stack::object &out,
+                               const json::object &object,
+                               const size_t &depth)
+{
+	for(const auto &[key, val] : object)
+	{
+		if(depth == 0 && live(key))
+			continue;
+
+		const bool ephemeral
+		{
+			depth == 3 && key == "ephemeral" &&
+			json::type(json::object(val)["events"], std::nothrow) == json::ARRAY
+		};
+
+		const bool descend
+		{
+			json::type(val, std::nothrow) == json::OBJECT &&
+			(depth == 0? key == "rooms": depth < 3)
+		};
+
+		if(ephemeral)
+		{
+			json::stack::object ephemeral
+			{
+				out, key
+			};
+
+			json::stack::array events
+			{
+				ephemeral, "events"
+			};
+
+			for(const json::object event : json::array(json::object(val)["events"]))
+				if(json::string(event["type"]) != "m.typing")
+					events.append(event);
+		}
+		else if(descend)
+		{
+			json::stack::object object
+			{
+				out, key
+			};
+
+			strip(object, val, depth + 1);
+		}
+		else json::stack::member
+		{
+			out, key, json::value{val}
+		};
+	}
+}
+
+std::shared_ptr<const ircd::m::sync::snapshot::entry>
+ircd::m::sync::snapshot::find(const data &data)
+{
+	const std::string key
+	{
+		std::string(data.user.user_id) + ' ' + std::string(data.device_id)
+	};
+
+	const auto it
+	{
+		cache.find(key)
+	};
+
+	if(it == end(cache))
+		return {};
+
+	const auto &filter_id
+	{
+		data.args?
+			data.args->filter_id:
+			string_view{}
+	};
+
+	const auto &entry
+	{
+		it->second->second
+	};
+
+	if(entry->filter_id != filter_id)
+		return {};
+
+	cache_lru.splice(begin(cache_lru), cache_lru, it->second);
+	return entry;
+}
+
+void
+ircd::m::sync::snapshot::save(const data &data,
+                              std::string content,
+                              const uint64_t &next_batch)
+{
+	if(size(content) > size_t(max_size))
+		return;
+
+	std::string key
+	{
+		std::string(data.user.user_id) + ' ' + std::string(data.device_id)
+	};
+
+	auto entry
+	{
+		std::make_shared<snapshot::entry>()
+	};
+
+	entry->filter_id = data.args? std::string(data.args->filter_id): std::string{};
+	entry->next_batch = next_batch;
+	entry->made = now<system_point>();
+	entry->size = size(content);
+
+	// The rooms included; a state change in any of them drops the entry.
+	std::set<std::string, std::less<>> rooms;
+	for(const json::object object : json::vector{content})
+		for(const auto &[membership, rooms_] : json::object{object["rooms"]})
+			if(json::type(rooms_, std::nothrow) == json::OBJECT)
+				for(const auto &[room_id, room] : json::object{rooms_})
+					rooms.emplace(room_id);
+
+	entry->rooms.assign(begin(rooms), end(rooms));
+
+	const unique_buffer<mutable_buffer> buf
+	{
+		lz4::compress_bound(size(content))
+	};
+
+	const const_buffer compressed
+	{
+		lz4::compress(buf, const_buffer{content})
+	};
+
+	entry->compressed = !empty(compressed) && size(compressed) < size(content);
+	entry->content = entry->compressed?
+		std::string(string_view{compressed}):
+		std::move(content);
+
+	const auto existing
+	{
+		cache.find(key)
+	};
+
+	if(existing != end(cache))
+		drop(existing->second);
+
+	cache_bytes += size(entry->content);
+	cache_lru.emplace_front(std::move(key), std::move(entry));
+	const auto &it
+	{
+		begin(cache_lru)
+	};
+
+	cache.emplace(it->first, it);
+	for(const auto &room_id : it->second->rooms)
+		cache_rooms.emplace(room_id, it->first);
+
+	// Evict the least recently used snapshots beyond the budget.
+	while(cache_bytes > size_t(cache_max) && !cache_lru.empty())
+		drop(std::prev(end(cache_lru)));
+}
+
+void
+ircd::m::sync::snapshot::drop(const lru::iterator &it)
+{
+	const string_view &key
+	{
+		it->first
+	};
+
+	for(const auto &room_id : it->second->rooms)
+	{
+		auto range
+		{
+			cache_rooms.equal_range(room_id)
+		};
+
+		for(; range.first != range.second; ++range.first)
+			if(range.first->second == key)
+			{
+				cache_rooms.erase(range.first);
+				break;
+			}
+	}
+
+	cache_bytes -= size(it->second->content);
+	cache.erase(key);
+	cache_lru.erase(it);
+}
+
+void
+ircd::m::sync::snapshot::drop_room(const string_view &room_id)
+{
+	for(auto it(cache_rooms.find(room_id)); it != end(cache_rooms); it = cache_rooms.find(room_id))
+	{
+		const auto entry
+		{
+			cache.find(it->second)
+		};
+
+		assert(entry != end(cache));
+		drop(entry->second);
+	}
+}
+
+/// All of the user's devices; the key is the user_id and device_id
+/// separated by a space.
+void
+ircd::m::sync::snapshot::drop_user(const string_view &user_id)
+{
+	auto it
+	{
+		cache.lower_bound(user_id)
+	};
+
+	while(it != end(cache) && startswith(it->first, user_id))
+	{
+		if(it->first.size() > size(user_id) && it->first[size(user_id)] != ' ')
+		{
+			++it;
+			continue;
+		}
+
+		const auto entry
+		{
+			it->second
+		};
+
+		++it;
+		drop(entry);
+	}
+}
+
+void
+ircd::m::sync::snapshot::handle_notify(const m::event &event,
+                                       m::vm::eval &eval)
+{
+	if(cache.empty())
+		return;
+
+	if(!defined(json::get<"state_key"_>(event)))
+		return;
+
+	drop_room(at<"room_id"_>(event));
+	if(at<"type"_>(event) != "m.room.member")
+		return;
+
+	const m::user::id &user_id
+	{
+		at<"state_key"_>(event)
+	};
+
+	if(my(user_id))
+		drop_user(user_id);
+}
+
+/// The room was written outside of eval; every room when not given.
+void
+ircd::m::sync::snapshot::handle_invalidate(const m::event &event)
+{
+	const auto &room_id
+	{
+		json::get<"room_id"_>(event)
+	};
+
+	if(room_id)
+		return drop_room(room_id);
+
+	cache_rooms.clear();
+	cache.clear();
+	cache_lru.clear();
+	cache_bytes = 0;
+}
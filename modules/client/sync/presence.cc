@@ -162,6 +162,26 @@ ircd::m::sync::presence_polylog(data &data)
 		};
 	}};
 
+	// For an incremental sync covered by the change log only the users who
+	// changed within the range are considered, rather than every user visible
+	// to our user.
+	const m::user::mitsein mitsein{data.user};
+	const bool logged
+	{
+		data.range.first && m::presence::changes(data.range, [&mitsein, &append_event]
+		(const m::user::id &user_id, const event::idx &event_idx)
+		{
+			if(!mitsein.has(user_id, "join"))
+				return true;
+
+			m::get(std::nothrow, event_idx, "content", append_event);
+			return true;
+		})
+	};
+
+	if(logged)
+		return ret;
+
 	// Setup for concurrentization.
 	static const size_t fibers(64);
 	sync::pool.min(fibers);
@@ -182,7 +202,6 @@ ircd::m::sync::presence_polylog(data &data)
 	};
 
 	// Iterate all of the users visible to our user in joined rooms.
-	const m::user::mitsein mitsein{data.user};
 	mitsein.for_each("join", [&concurrent]
 	(const m::user &user)
 	{
@@ -53,9 +53,19 @@ ircd::m::sync::rooms_linear(data &data)
 		data.room, &room
 	};
 
+	// The fanout for this event has already computed these for all users.
+	const auto *const fanout
+	{
+		data.fanout && data.fanout->event_idx == data.event_idx && room != data.user_room?
+			data.fanout:
+			nullptr
+	};
+
 	char membuf[room::MEMBERSHIP_MAX_SIZE];
 	const string_view &membership
 	{
+		fanout?
+			fanout->membership(data.user):
 		data.room?
 			m::membership(membuf, room, data.user):
 			string_view{}
@@ -71,6 +81,8 @@ ircd::m::sync::rooms_linear(data &data)
 
 	const auto room_head
 	{
+		fanout?
+			fanout->room_head:
 		data.event_idx && room != data.user_room?
 			m::head_idx(std::nothrow, room):
 			0UL
@@ -83,6 +95,8 @@ ircd::m::sync::rooms_linear(data &data)
 
 	const auto room_depth
 	{
+		fanout?
+			fanout->room_depth:
 		data.event_idx && room != data.user_room?
 			m::depth(std::nothrow, room):
 			-1L
@@ -276,6 +290,20 @@ ircd::m::sync::_rooms_polylog_room(data &data,
 bool
 ircd::m::sync::should_ignore(const data &data)
 {
+	// A room joined with partial state is withheld from clients which have
+	// not asked for lazy-loaded members, since its membership is incomplete;
+	// it appears once the resync has completed.
+	if(data.membership == "join")
+	{
+		const auto &state_filter
+		{
+			json::get<"state"_>(json::get<"room"_>(data.filter))
+		};
+
+		assert(data.room);
+		return !json::get<"lazy_load_members"_>(state_filter) && m::partial(*data.room);
+	}
+
 	if(data.membership != "invite")
 		return false;
 
@@ -520,6 +520,18 @@ ircd::m::sync::room_state_append(data &data,
                                  const m::event::idx &event_idx,
                                  const bool &query_prev)
 {
+	const bool fanout
+	{
+		query_prev && data.fanout && data.fanout->event_idx == event_idx
+	};
+
+	const json::object rendered
+	{
+		fanout?
+			string_view{data.fanout->rendered}:
+			string_view{}
+	};
+
 	m::event::append::opts opts;
 	opts.event_idx = &event_idx;
 	opts.user_id = &data.user.user_id;
@@ -527,5 +539,6 @@ ircd::m::sync::room_state_append(data &data,
 	opts.query_txnid = false;
 	opts.room_depth = &data.room_depth;
 	opts.query_prev_state = query_prev;
+	opts.rendered = fanout? &rendered : nullptr;
 	return m::event::append(events, event, opts);
 }
@@ -291,7 +291,7 @@ ircd::m::sync::_room_timeline_polylog_events(data &data,
 			break;
 
 		if(limit > 1)
-			prefetched += m::prefetch(event_idx);
+			prefetched += m::prefetch(event_idx, m::event::fetch::interactive_opts);
 
 		++i;
 	}
@@ -303,17 +303,32 @@ ircd::m::sync::_room_timeline_polylog_events(data &data,
 	if(i > 1 && it)
 		--i, ++it;
 
+	std::deque<m::event::fetch> fetched;
+	std::vector<m::event::idx> idxs;
+	std::vector<m::event> events;
 	if(i > 0 && it)
 		for(++it; i > 0 && it; --i, ++it)
 		{
-			const m::event &event
-			{
-				*it
-			};
+			fetched.emplace_back(std::nothrow, it.event_idx());
+			if(!fetched.back().valid)
+				continue;
 
-			ret |= _room_timeline_append(data, array, it.event_idx(), event);
+			idxs.emplace_back(it.event_idx());
+			events.emplace_back(fetched.back());
 		}
 
+	// The visibility of the whole timeline is decided at once.
+
+	const std::unique_ptr<bool[]> visible
+	{
+		new bool[events.size()]
+	};
+
+	m::visible(room.room_id, data.user.user_id, events, vector_view<bool>(visible.get(), events.size()));
+	for(size_t j(0); j < events.size(); ++j)
+		if(visible[j])
+			ret |= _room_timeline_append(data, array, idxs[j], events[j]);
+
 	return m::event_id(std::nothrow, event_idx);
 }
 
@@ -323,11 +338,28 @@ ircd::m::sync::_room_timeline_append(data &data,
                                      const m::event::idx &event_idx,
                                      const m::event &event)
 {
+	const bool fanout
+	{
+		data.fanout && data.fanout->event_idx == event_idx
+	};
+
+	if(fanout && data.fanout->redacted)
+		return false;
+
+	const json::object rendered
+	{
+		fanout?
+			string_view{data.fanout->rendered}:
+			string_view{}
+	};
+
 	m::event::append::opts opts;
 	opts.event_idx = &event_idx;
 	opts.client_txnid = &data.client_txnid;
 	opts.user_id = &data.user.user_id;
 	opts.user_room = &data.user_room;
 	opts.room_depth = &data.room_depth;
+	opts.rendered = fanout? &rendered : nullptr;
+	opts.query_redacted = !fanout;
 	return m::event::append(events, event, opts);
 }
@@ -10,7 +10,8 @@
 
 namespace ircd::m::sync
 {
-	static void _to_device_append(data &, const json::object &, json::stack::array &);
+	static json::object _to_device_message(const data &, const json::object &);
+	static void _to_device_append(data &, const json::object &, const json::object &, json::stack::array &);
 	static bool to_device_polylog(data &);
 	static bool to_device_linear(data &);
 
@@ -50,12 +51,12 @@ ircd::m::sync::to_device_linear(data &data)
 		json::get<"content"_>(event)
 	};
 
-	const json::string &device_id
+	const json::object &message
 	{
-		content.at("device_id")
+		_to_device_message(data, content)
 	};
 
-	if(device_id != "*" && device_id != data.device_id)
+	if(!message)
 		return false;
 
 	json::stack::object to_device
@@ -68,7 +69,7 @@ ircd::m::sync::to_device_linear(data &data)
 		to_device, "events"
 	};
 
-	_to_device_append(data, content, array);
+	_to_device_append(data, content, message, array);
 	return true;
 }
 
@@ -95,15 +96,15 @@ ircd::m::sync::to_device_polylog(data &data)
 		m::get(std::nothrow, event_idx, "content", [&data, &array, &ret]
 		(const json::object &content)
 		{
-			const json::string &device_id
+			const json::object &message
 			{
-				content.at("device_id")
+				_to_device_message(data, content)
 			};
 
-			if(device_id != "*" && device_id != data.device_id)
+			if(!message)
 				return;
 
-			_to_device_append(data, content, array);
+			_to_device_append(data, content, message, array);
 			ret = true;
 		});
 
@@ -113,9 +114,45 @@ ircd::m::sync::to_device_polylog(data &data)
 	return ret;
 }
 
+/// Select the message addressed to this device from an ircd.to_device
+/// content. Batched deliveries carry a "messages" object keyed by device_id
+/// in place of a single "device_id" and "content"; "*" is any device.
+ircd::json::object
+ircd::m::sync::_to_device_message(const data &data,
+                                  const json::object &content)
+{
+	const json::object &messages
+	{
+		content["messages"]
+	};
+
+	if(messages)
+	{
+		const json::object &message
+		{
+			messages[data.device_id]
+		};
+
+		return message?
+			message:
+			json::object{messages["*"]};
+	}
+
+	const json::string &device_id
+	{
+		content.at("device_id")
+	};
+
+	if(device_id != "*" && device_id != data.device_id)
+		return {};
+
+	return content.at("content");
+}
+
 void
 ircd::m::sync::_to_device_append(data &data,
                                  const json::object &content,
+                                 const json::object &message,
                                  json::stack::array &array)
 {
 	json::stack::object event
@@ -141,9 +178,6 @@ ircd::m::sync::_to_device_append(data &data,
 
 	json::stack::member
 	{
-		event, "content", json::object
-		{
-			content.at("content")
-		}
+		event, "content", message
 	};
 }
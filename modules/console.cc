@@ -1498,6 +1498,7 @@ console_cmd__ios(opt &out, const string_view &line)
 	    << " " << std::right << std::setw(10) << "CALLS"
 	    << " " << std::right << std::setw(10) << "ALLOCS"
 	    << " " << std::right << std::setw(10) << "FREES"
+	    << " " << std::right << std::setw(7) << "POOL"
 	    << " " << std::right << std::setw(26) << "ALLOCATED"
 	    << " " << std::right << std::setw(26) << "FREED"
 	    << " " << std::right << std::setw(8) << "FAULTS"
@@ -1522,6 +1523,13 @@ console_cmd__ios(opt &out, const string_view &line)
 				0.0L
 		};
 
+		const auto pool_hit_pct
+		{
+			s.allocs?
+				(long double)s.pool_hits / (long double)s.allocs * 100.0L:
+				0.0L
+		};
+
 		out
 		<< " " << std::right << std::setw(6) << s.queued
 		<< " " << std::right << std::setw(13) << pretty(pbuf, si(ulong(s.latency_last)), 2)
@@ -1531,6 +1539,7 @@ console_cmd__ios(opt &out, const string_view &line)
 		<< " " << std::right << std::setw(10) << s.calls
 		<< " " << std::right << std::setw(10) << s.allocs
 		<< " " << std::right << std::setw(10) << s.frees
+		<< " " << std::right << std::setw(6) << std::fixed << std::setprecision(2) << pool_hit_pct << '%'
 		<< " " << std::right << std::setw(26) << pretty(pbuf, iec(s.alloc_bytes))
 		<< " " << std::right << std::setw(26) << pretty(pbuf, iec(s.free_bytes))
 		<< " " << std::right << std::setw(8) << s.faults
@@ -2607,6 +2616,46 @@ console_cmd__ctx__list(opt &out, const string_view &line)
 		return true;
 	});
 
+	if(name_filter)
+		return true;
+
+	// Scheduling delay (queued to resumed) histogram for each priority class.
+	static const string_view class_name[ctx::prof::sched::CLASSES]
+	{
+		"high", "normal", "low"
+	};
+
+	out << std::endl
+	    << std::setw(7) << std::left << "CLASS"
+	    << " " << std::setw(6) << std::right << "QUEUED"
+	    << " " << std::setw(10) << std::right << "RESUMED"
+	    << " " << std::setw(10) << std::right << "DEFERRED"
+	    << " " << std::setw(10) << std::right << "THROTTLED";
+
+	static const string_view bucket_name[ctx::prof::sched::BUCKETS]
+	{
+		"<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms"
+	};
+
+	for(const auto &name : bucket_name)
+		out << " " << std::setw(10) << std::right << name;
+
+	out << std::endl;
+	for(size_t i(0); i < ctx::prof::sched::CLASSES; ++i)
+	{
+		const auto &sched(ctx::prof::get_sched(i));
+		out << std::setw(7) << std::left << class_name[i]
+		    << " " << std::setw(6) << std::right << sched.queued
+		    << " " << std::setw(10) << std::right << sched.resumed
+		    << " " << std::setw(10) << std::right << sched.deferred
+		    << " " << std::setw(10) << std::right << sched.throttled;
+
+		for(const auto &count : sched.delay)
+			out << " " << std::setw(10) << std::right << count;
+
+		out << std::endl;
+	}
+
 	return true;
 }
 
@@ -3203,6 +3252,57 @@ try
 		    << std::endl;
 	}
 
+	// The prefetcher is shared by all databases
+	if(!db::prefetcher)
+		return true;
+
+	const auto &pt
+	{
+		*db::prefetcher->ticker
+	};
+
+	out << std::endl
+	    << std::left << std::setw(48) << std::setfill('_') << "ircd.db.prefetch.concurrency"
+	    << " " << db::prefetcher->concurrency
+	    << " workers:" << db::prefetcher->request_workers
+	    << " avg:" << pt.avg_req_fin.count() << "us"
+	    << std::endl;
+
+	static const string_view class_name[db::prefetcher::prio::_NUM_]
+	{
+		"interactive", "background", "bulk",
+	};
+
+	for(size_t i(0); i < db::prefetcher::prio::_NUM_; ++i)
+	{
+		if(!pt.class_request[i] && ticker != "-a")
+			continue;
+
+		thread_local char buf[64];
+		const string_view name
+		{
+			fmt::sprintf
+			{
+				buf, "ircd.db.prefetch.%s", class_name[i]
+			}
+		};
+
+		const auto avg
+		{
+			pt.class_fetched[i]?
+				pt.class_accum_snd_fin[i].count() / pt.class_fetched[i]:
+				0L
+		};
+
+		out << std::left << std::setw(48) << std::setfill('_') << name
+		    << std::setfill(' ') << std::right
+		    << " " << std::setw(10) << pt.class_request[i] << " req "
+		    << " " << std::setw(10) << pt.class_fetched[i] << " fin "
+		    << " " << std::setw(10) << pt.class_expired[i] << " exp "
+		    << " " << std::setw(10) << avg << " avg(us) "
+		    << std::endl;
+	}
+
 	return true;
 }
 catch(const std::out_of_range &e)
@@ -3377,6 +3477,8 @@ try
 		size_t misses;
 		size_t inserts;
 		size_t inserts_bytes;
+		size_t rejects;
+		size_t promotes;
 
 		stats &operator+=(const stats &b)
 		{
@@ -3387,6 +3489,8 @@ try
 			misses += b.misses;
 			inserts += b.inserts;
 			inserts_bytes += b.inserts_bytes;
+			rejects += b.rejects;
+			promotes += b.promotes;
 			return *this;
 		}
 	};
@@ -3469,6 +3573,10 @@ try
 	    << " "
 	    << std::setw(9) << "INSERT"
 	    << " "
+	    << std::setw(9) << "REJECT"
+	    << " "
+	    << std::setw(9) << "PROMOTE"
+	    << " "
 	    << std::setw(26) << "CACHED"
 	    << " "
 	    << std::setw(26) << "CAPACITY"
@@ -3499,6 +3607,10 @@ try
 		    << " "
 		    << std::setw(9) << s.inserts
 		    << " "
+		    << std::setw(9) << s.rejects
+		    << " "
+		    << std::setw(9) << s.promotes
+		    << " "
 		    << std::setw(26) << std::right << pretty(iec(s.usage))
 		    << " "
 		    << std::setw(26) << std::right << pretty(iec(s.capacity))
@@ -3545,6 +3657,8 @@ try
 			db::ticker(cache(column), db::ticker_id("rocksdb.block.cache.miss")),
 			db::ticker(cache(column), db::ticker_id("rocksdb.block.cache.add")),
 			db::ticker(cache(column), db::ticker_id("rocksdb.block.cache.data.bytes.insert")),
+			db::admission(cache(column)).reject,
+			db::admission(cache(column)).promote,
 		};
 
 		const stats compressed
@@ -3555,7 +3669,9 @@ try
 			db::ticker(cache_compressed(column), db::ticker_id("rocksdb.block.cache.hit")),
 			0,
 			db::ticker(cache_compressed(column), db::ticker_id("rocksdb.block.cache.add")),
-			0
+			0,
+			0,
+			0,
 		};
 
 		output(colname, uncompressed, compressed);
@@ -3595,6 +3711,21 @@ catch(const std::out_of_range &e)
 	return true;
 }
 
+bool
+console_cmd__db__cache__check(opt &out, const string_view &line)
+{
+	const bool ok
+	{
+		db::cache_check()
+	};
+
+	out << "cache admission check "
+	    << (ok? "passed" : "FAILED; see the log")
+	    << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__db__cache__clear(opt &out, const string_view &line)
 try
@@ -6259,8 +6390,18 @@ console_cmd__resource(opt &out, const string_view &line)
 		    << (m.opts->flags & resource::method::RATE_LIMITED? " RATE_LIMITED" : "")
 		    << (m.opts->flags & resource::method::VERIFY_ORIGIN? " VERIFY_ORIGIN" : "")
 		    << (m.opts->flags & resource::method::CONTENT_DISCRETION? " CONTENT_DISCRETION" : "")
+		    << (m.opts->flags & resource::method::READ_ONLY? " READ_ONLY" : "")
 		    << std::endl;
 
+		out << "concurrency max:         " << m.opts->concurrency_max << std::endl
+		    << "origin concurrency max:  " << m.opts->origin_concurrency_max << std::endl
+		    << "origin rate:             " << m.opts->origin_rate << std::endl
+		    << "origin burst:            " << m.opts->origin_burst << std::endl
+		    << "origins:                 " << m.origins.size() << std::endl
+		    << "queued:                  " << m.stats->queued << std::endl
+		    << "rejected:                " << m.stats->rejected << std::endl
+		    << "shed:                    " << m.stats->shed << std::endl;
+
 		return true;
 	}
 
@@ -6283,6 +6424,9 @@ console_cmd__resource(opt &out, const string_view &line)
 			    << " | RET " << std::setw(8) << m.stats->completions
 			    << " | TIM " << std::setw(8) << m.stats->timeouts
 			    << " | ERR " << std::setw(8) << m.stats->internal_errors
+			    << " | QUE " << std::setw(8) << m.stats->queued
+			    << " | REJ " << std::setw(8) << m.stats->rejected
+			    << " | SHD " << std::setw(8) << m.stats->shed
 			    << std::endl;
 		}
 	}
@@ -7282,6 +7426,51 @@ console_cmd__events__dump(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__events__import(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"filename", "verify", "limit"
+	}};
+
+	const auto filename
+	{
+		param.at("filename")
+	};
+
+	const auto verify
+	{
+		param["verify"]
+	};
+
+	struct m::events::import::opts opts;
+	opts.limit = param.at<size_t>("limit", 0UL);
+	opts.verify =
+		verify == "none"?
+			m::events::import::NONE:
+		verify == "event_id"?
+			m::events::import::EVENT_ID:
+		verify == "signatures"?
+			m::events::import::SIGNATURES:
+			m::events::import::CONFORMS;
+
+	const m::events::import import
+	{
+		filename, opts
+	};
+
+	out << "imported " << import.events
+	    << " skipped " << import.skipped
+	    << " errors " << import.errors
+	    << " in " << import.batches << " batches"
+	    << " idx " << import.range.first
+	    << " to " << import.range.second
+	    << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__events__rebuild(opt &out, const string_view &line)
 {
@@ -9261,6 +9450,154 @@ console_cmd__room__members__count(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__room__members__count__rebuild(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"room_id"
+	}};
+
+	if(param["room_id"] == "*")
+	{
+		const m::room::members::rebuild rebuild;
+		out << "done" << std::endl;
+		return true;
+	}
+
+	const auto &room_id
+	{
+		m::room_id(param.at("room_id"))
+	};
+
+	const m::room::members::rebuild rebuild
+	{
+		room_id
+	};
+
+	out << "done" << std::endl;
+	return true;
+}
+
+/// Compares the room_member_count index of a room with counts taken from
+/// its present state, the same way the rebuild computes them. Evals of the
+/// room during the check may show as transient mismatches.
+bool
+console_cmd__room__members__count__check(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"room_id"
+	}};
+
+	const auto &room_id
+	{
+		m::room_id(param.at("room_id"))
+	};
+
+	if(!m::dbs::room_member_count_built())
+	{
+		out << "The member count index is not built; see `room members count rebuild *`."
+		    << std::endl;
+
+		return true;
+	}
+
+	// membership, host => count; an empty host is the total for membership.
+	std::map<std::pair<std::string, std::string>, uint64_t> expect;
+	const m::room::state state
+	{
+		room_id
+	};
+
+	state.for_each("m.room.member", [&expect]
+	(const string_view &type, const string_view &state_key, const m::event::idx &event_idx)
+	{
+		char membuf[32];
+		const string_view &membership
+		{
+			m::membership(membuf, event_idx)
+		};
+
+		if(!membership)
+			return true;
+
+		const m::user::id &user_id
+		{
+			state_key
+		};
+
+		++expect[{std::string{membership}, std::string{}}];
+		++expect[{std::string{membership}, std::string{user_id.host()}}];
+		return true;
+	});
+
+	size_t checked(0), mismatch(0);
+	const auto report{[&out, &mismatch]
+	(const string_view &membership, const string_view &host, const uint64_t &have, const uint64_t &want)
+	{
+		++mismatch;
+		out << "MISMATCH "
+		    << std::left << std::setw(8) << membership << " "
+		    << std::left << std::setw(40) << (host?: "*"_sv) << " "
+		    << "index:" << have << " "
+		    << "state:" << want
+		    << std::endl;
+	}};
+
+	db::domain &index
+	{
+		m::dbs::room_member_count
+	};
+
+	char buf[m::dbs::ROOM_MEMBER_COUNT_KEY_MAX_SIZE];
+	for(auto it(index.begin(m::dbs::room_member_count_key(buf, room_id))); bool(it); ++it)
+	{
+		const auto &[membership, host]
+		{
+			m::dbs::room_member_count_key(it->first)
+		};
+
+		const uint64_t have
+		{
+			size(it->second) == sizeof(uint64_t)?
+				uint64_t(byte_view<uint64_t>(it->second)):
+				-1UL
+		};
+
+		const auto eit
+		{
+			expect.find({std::string{membership}, std::string{host}})
+		};
+
+		const uint64_t want
+		{
+			eit != end(expect)? eit->second : 0UL
+		};
+
+		if(eit != end(expect))
+			expect.erase(eit);
+
+		++checked;
+		if(have != want)
+			report(membership, host, have, want);
+	}
+
+	// Counts of the state which have no key in the index.
+	for(const auto &[key, want] : expect)
+	{
+		++checked;
+		report(key.first, key.second, 0UL, want);
+	}
+
+	out << (mismatch? "FAILED" : "passed") << " "
+	    << "checked:" << checked << " "
+	    << "mismatch:" << mismatch
+	    << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__room__members__origin(opt &out, const string_view &line)
 {
@@ -9799,6 +10136,175 @@ console_cmd__room__state__history(opt &out, const string_view &line)
 	return true;
 }
 
+/// Compares room::state::history at a depth (or at and above every snapshot
+/// of the room) with a linear scan of the state space. Both the snapshot
+/// replay of the whole state and the per-type seeking scan are compared.
+bool
+console_cmd__room__state__history__check(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"room_id", "[depth]"
+	}};
+
+	const auto &room_id
+	{
+		m::room_id(param.at("room_id"))
+	};
+
+	std::vector<int64_t> bounds;
+	if(param["[depth]"])
+		bounds.emplace_back(param.at<int64_t>("[depth]"));
+	else
+	{
+		char buf[m::dbs::ROOM_STATE_SNAPSHOT_KEY_MAX_SIZE];
+		for(auto it(m::dbs::room_state_snapshot.begin(m::dbs::room_state_snapshot_key(buf, room_id))); bool(it); ++it)
+		{
+			const int64_t depth
+			{
+				m::dbs::room_state_snapshot_key(it->first)
+			};
+
+			if(depth < 0)
+				continue;
+
+			bounds.emplace_back(depth);
+			bounds.emplace_back(depth + 1);
+		}
+
+		bounds.emplace_back(m::depth(std::nothrow, room_id) + 1);
+	}
+
+	// (type, state_key) => (depth, event_idx)
+	using state_map = std::map<std::pair<std::string, std::string>, std::pair<int64_t, m::event::idx>>;
+
+	size_t failed(0);
+	const auto compare{[&out]
+	(const int64_t &bound, const string_view &path, const state_map &expect, const state_map &got)
+	{
+		size_t ret(0);
+		for(const auto &[key, val] : expect)
+		{
+			const auto it(got.find(key));
+			if(it != end(got) && it->second == val)
+				continue;
+
+			++ret;
+			out << "MISMATCH " << bound << " " << path << " "
+			    << key.first << "," << key.second << " "
+			    << "space:" << val.first << ":" << val.second << " "
+			    << "got:";
+
+			if(it != end(got))
+				out << it->second.first << ":" << it->second.second;
+			else
+				out << "-";
+
+			out << std::endl;
+		}
+
+		for(const auto &[key, val] : got)
+		{
+			if(expect.count(key))
+				continue;
+
+			++ret;
+			out << "MISMATCH " << bound << " " << path << " "
+			    << key.first << "," << key.second << " "
+			    << "space:- "
+			    << "got:" << val.first << ":" << val.second
+			    << std::endl;
+		}
+
+		return ret;
+	}};
+
+	const m::room room
+	{
+		room_id
+	};
+
+	for(const auto &bound : bounds)
+	{
+		state_map expect;
+		char buf[m::dbs::ROOM_STATE_SPACE_KEY_MAX_SIZE];
+		for(auto it(m::dbs::room_state_space.begin(m::dbs::room_state_space_key(buf, room_id))); bool(it); ++it)
+		{
+			const auto &[type, state_key, depth, event_idx]
+			{
+				m::dbs::room_state_space_key(it->first)
+			};
+
+			if(bound > -1 && depth >= bound)
+				continue;
+
+			const std::pair<int64_t, m::event::idx> val
+			{
+				depth, event_idx
+			};
+
+			auto eit
+			{
+				expect.try_emplace({std::string{type}, std::string{state_key}}, val)
+			};
+
+			if(!eit.second && eit.first->second < val)
+				eit.first->second = val;
+		}
+
+		const m::room::state::history history
+		{
+			room, bound
+		};
+
+		const auto append{[](state_map &map)
+		{
+			return [&map](const auto &type, const auto &state_key, const auto &depth, const auto &event_idx)
+			{
+				map.emplace(std::make_pair(std::string{type}, std::string{state_key}), std::make_pair(depth, event_idx));
+				return true;
+			};
+		}};
+
+		state_map replay;
+		history.for_each(append(replay));
+
+		state_map seek;
+		std::set<std::string, std::less<>> types;
+		for(const auto &[key, val] : expect)
+			types.emplace(key.first);
+
+		for(const auto &type : types)
+			history.for_each(type, append(seek));
+
+		const auto snapshot
+		{
+			m::dbs::room_state_snapshot_find(room_id, bound).first
+		};
+
+		const size_t mismatch
+		{
+			compare(bound, snapshot > -1? "replay"_sv : "scan"_sv, expect, replay) +
+			compare(bound, "seek", expect, seek)
+		};
+
+		failed += mismatch > 0;
+		out << (mismatch? "FAILED" : "passed") << " "
+		    << "depth:" << bound << " "
+		    << "snapshot:" << snapshot << " "
+		    << "state:" << expect.size() << " "
+		    << "mismatch:" << mismatch
+		    << std::endl;
+	}
+
+	out << (failed? "FAILED" : "passed") << " "
+	    << "depths:" << bounds.size() << " "
+	    << "failed:" << failed
+	    << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__room__state__space(opt &out, const string_view &line)
 {
@@ -9872,19 +10378,56 @@ console_cmd__room__state__space__rebuild(opt &out, const string_view &line)
 
 	if(room_id == "*" || room_id == "remote_joined_only")
 	{
+		// Rooms are independent so they are rebuilt concurrently; the
+		// submission blocks while all workers are busy.
+		static const ctx::pool::opts pool_opts
+		{
+			512_KiB,   // stack sz
+			16,        // pool sz
+			-1,        // queue max hard
+			0,         // queue max soft
+			true,      // queue max blocking
+			false,     // queue max warning
+			3,         // ionice
+			3,         // nice
+		};
+
+		ctx::pool pool
+		{
+			"console.rebuild", pool_opts
+		};
+
+		ctx::dock dock;
+		size_t submitted(0), completed(0);
 		m::rooms::opts opts;
 		opts.remote_joined_only = room_id == "remote_joined_only";
-		m::rooms::for_each(opts, []
+		m::rooms::for_each(opts, [&pool, &dock, &submitted, &completed]
 		(const m::room::id &room_id)
 		{
-			m::room::state::space::rebuild
+			++submitted;
+			pool([&dock, &completed, room_id(m::room::id::buf(room_id))]
 			{
-				room_id
-			};
+				const unwind complete{[&dock, &completed]
+				{
+					++completed;
+					dock.notify_one();
+				}};
+
+				m::room::state::space::rebuild
+				{
+					room_id
+				};
+			});
 
 			return true;
 		});
 
+		dock.wait([&submitted, &completed]
+		{
+			return completed >= submitted;
+		});
+
+		out << "done " << completed << " rooms" << std::endl;
 		return true;
 	}
 
@@ -9952,6 +10495,12 @@ console_cmd__room__state__rebuild(opt &out, const string_view &line)
 				room_id
 			};
 
+			// The member counts are derived from the present state.
+			m::room::members::rebuild
+			{
+				room_id
+			};
+
 			return true;
 		});
 
@@ -9963,6 +10512,11 @@ console_cmd__room__state__rebuild(opt &out, const string_view &line)
 		room_id
 	};
 
+	m::room::members::rebuild
+	{
+		room_id
+	};
+
 	out << "done" << std::endl;
 	return true;
 }
@@ -10846,6 +11400,132 @@ console_cmd__room__auth(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__room__partial__resync(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"room_id"
+	}};
+
+	const auto &room_id
+	{
+		m::room_id(param.at("room_id"))
+	};
+
+	const bool resynced
+	{
+		m::room::bootstrap::resync(room_id)
+	};
+
+	out << (resynced? "resynced" : "still partial; see the log") << std::endl;
+	return true;
+}
+
+/// Checks the partial-state bookkeeping of a room against its marker in the
+/// server's room. Once resynced, every event of the present state must pass
+/// auth against the present state, which the resync recheck guarantees.
+bool
+console_cmd__room__partial__check(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"room_id"
+	}};
+
+	const auto &room_id
+	{
+		m::room_id(param.at("room_id"))
+	};
+
+	const bool partial
+	{
+		m::partial(m::room{room_id})
+	};
+
+	const m::room::id::buf ircd_room_id
+	{
+		"ircd", my_host()
+	};
+
+	const auto marker_idx
+	{
+		m::room::state{ircd_room_id}.get(std::nothrow, "ircd.room.partial", room_id)
+	};
+
+	bool marked {false};
+	m::get(std::nothrow, marker_idx, "content", [&marked]
+	(const json::object &content)
+	{
+		marked = content.has("event_id");
+	});
+
+	size_t servers(0);
+	m::room::bootstrap::servers(room_id, [&servers]
+	(const string_view &server)
+	{
+		++servers;
+		return true;
+	});
+
+	out << "partial:  " << partial << std::endl
+	    << "marked:   " << marked << std::endl
+	    << "servers:  " << servers << std::endl;
+
+	if(partial != marked)
+	{
+		out << "FAILED partial state differs from the marker" << std::endl;
+		return true;
+	}
+
+	if(partial)
+	{
+		out << "passed; resync pending" << std::endl;
+		return true;
+	}
+
+	size_t checked(0), failed(0);
+	const m::room::state state
+	{
+		room_id
+	};
+
+	state.for_each([&out, &checked, &failed]
+	(const string_view &type, const string_view &state_key, const m::event::idx &event_idx)
+	{
+		const m::event::fetch event
+		{
+			std::nothrow, event_idx
+		};
+
+		if(!event.valid)
+			return true;
+
+		const auto &[pass, fail]
+		{
+			m::room::auth::check_present(event)
+		};
+
+		++checked;
+		if(pass)
+			return true;
+
+		++failed;
+		out << "FAIL " << pretty_oneline(event)
+		    << " :" << what(fail)
+		    << std::endl;
+
+		return true;
+	});
+
+	out << (failed? "FAILED" : "passed") << " "
+	    << "checked:" << checked << " "
+	    << "failed:" << failed
+	    << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__room__stats(opt &out, const string_view &line)
 {
@@ -11836,6 +12516,138 @@ console_cmd__user__mitsein(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__user__mitsein__rebuild(opt &out, const string_view &line)
+{
+	m::user::mitsein::rebuild();
+	out << "done" << std::endl;
+	return true;
+}
+
+/// Compares the user_mitsein pair counts of a user with counts taken by
+/// walking the members of each indexed room the user is joined to. Evals
+/// during the check may show as transient mismatches.
+bool
+console_cmd__user__mitsein__check(opt &out, const string_view &line)
+{
+	const params param{line, " ",
+	{
+		"user_id"
+	}};
+
+	const m::user user
+	{
+		m::user(param.at("user_id"))
+	};
+
+	if(!m::dbs::user_mitsein_built())
+	{
+		out << "The user_mitsein index is not built; see `user mitsein rebuild`."
+		    << std::endl;
+
+		return true;
+	}
+
+	// other user => count of common rooms; the user is paired with itself.
+	std::map<std::string, uint64_t, std::less<>> expect;
+	size_t rooms(0), large(0);
+	const m::user::rooms user_rooms
+	{
+		user
+	};
+
+	user_rooms.for_each("join", m::user::rooms::closure_bool{[&expect, &rooms, &large]
+	(const m::room &room, const string_view &)
+	{
+		++rooms;
+		if(m::dbs::user_mitsein_large(room.room_id))
+		{
+			++large;
+			return true;
+		}
+
+		const m::room::members members
+		{
+			room
+		};
+
+		members.for_each("join", [&expect]
+		(const m::user::id &other)
+		{
+			++expect[std::string{other}];
+			return true;
+		});
+
+		return true;
+	}});
+
+	size_t checked(0), mismatch(0);
+	const auto report{[&out, &mismatch]
+	(const string_view &other, const uint64_t &have, const uint64_t &want)
+	{
+		++mismatch;
+		out << "MISMATCH "
+		    << std::left << std::setw(48) << other << " "
+		    << "index:" << have << " "
+		    << "rooms:" << want
+		    << std::endl;
+	}};
+
+	db::domain &index
+	{
+		m::dbs::user_mitsein
+	};
+
+	char buf[m::dbs::USER_MITSEIN_KEY_MAX_SIZE];
+	for(auto it(index.begin(m::dbs::user_mitsein_key(buf, user.user_id))); bool(it); ++it)
+	{
+		const string_view &other
+		{
+			m::dbs::user_mitsein_key(it->first)
+		};
+
+		const uint64_t have
+		{
+			size(it->second) == sizeof(uint64_t)?
+				uint64_t(byte_view<uint64_t>(it->second)):
+				-1UL
+		};
+
+		const auto eit
+		{
+			expect.find(other)
+		};
+
+		const uint64_t want
+		{
+			eit != end(expect)? eit->second : 0UL
+		};
+
+		if(eit != end(expect))
+			expect.erase(eit);
+
+		++checked;
+		if(have != want)
+			report(other, have, want);
+	}
+
+	// Users in common which have no pair in the index.
+	for(const auto &[other, want] : expect)
+	{
+		++checked;
+		report(other, 0UL, want);
+	}
+
+	out << (mismatch? "FAILED" : "passed") << " "
+	    << "rooms:" << rooms << " "
+	    << "unindexed:" << large << " "
+	    << "checked:" << checked << " "
+	    << "mismatch:" << mismatch
+	    << std::endl;
+
+	return true;
+}
+
 bool
 console_cmd__user__tokens(opt &out, const string_view &line)
 {
@@ -14982,6 +15794,26 @@ console_cmd__vm(opt &out, const string_view &line)
 	return true;
 }
 
+bool
+console_cmd__vm__hold(opt &out, const string_view &line)
+{
+	const ircd::timer timer;
+
+	// Issued from a control room this runs within the effect hook of the
+	// command's own eval, which must not be waited for.
+	const m::vm::hold hold;
+
+	char buf[48];
+	out << "held in "
+	    << pretty(buf, timer.at<microseconds>())
+	    << " with executing:" << m::vm::eval::executing
+	    << " injecting:" << m::vm::eval::injecting
+	    << " pending:" << m::vm::sequence::pending
+	    << std::endl;
+
+	return true;
+}
+
 //
 // mc
 //
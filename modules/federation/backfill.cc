@@ -117,11 +117,16 @@ get__backfill(client &client,
 		top, "pdus"
 	};
 
+	const m::visibility visible
+	{
+		room_id, request.node_id
+	};
+
 	size_t count{0};
 	for(; it && count < limit; ++count, --it)
 	{
 		const m::event &event(*it);
-		if(!visible(event, request.node_id))
+		if(!visible(event))
 			continue;
 
 		pdus.append(event);
@@ -274,6 +274,16 @@ method_put
 		90s, //TODO: conf
 
 		// Payload maximum
-		4_MiB // larger = HTTP 413  //TODO: conf
+		4_MiB, // larger = HTTP 413  //TODO: conf
+
+		// MIME type
+		{},
+
+		// Concurrency maximum for all origins
+		0,
+
+		// Concurrency maximum for each origin; refused with 429 before the
+		// X-Matrix signature is verified. See also eval.max_per_node.
+		8,
 	}
 };
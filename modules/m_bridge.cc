@@ -8,19 +8,218 @@
 // copyright notice and this permission notice is present in all copies. The
 // full license for this software is available in the LICENSE file.
 
-ircd::mapi::header
-IRCD_MODULE
-{
-	"Bridges (Application Services)"
-};
+#include <regex>
 
 namespace ircd::m::bridge
 {
+	struct automaton;
+	struct pusher;
+	struct matcher;
+
+	static std::vector<std::string> room_aliases(const room::id &);
+	static std::vector<bool> room_interest(const room::id &);
+	static void match(const matcher &, const event &, const std::vector<std::string> &, std::vector<bool> &);
+	static void enqueue(pusher &, const event::idx &);
+	static void replay(pusher &);
+	static bool push(pusher &);
+	static void save(pusher &, const bool &force = false);
+	static void compile();
+	static void worker();
+	static void handle_config(const m::event &, vm::eval &);
 	static void handle_event(const m::event &, vm::eval &);
 
+	extern conf::item<bool> push_enable;
+	extern conf::item<size_t> push_txn_max;
+	extern conf::item<size_t> push_queue_max;
+	extern conf::item<size_t> push_replay_max;
+	extern conf::item<seconds> push_timeout;
+	extern conf::item<seconds> push_backoff_min;
+	extern conf::item<seconds> push_backoff_max;
+	extern conf::item<seconds> push_checkpoint_interval;
+	extern conf::item<size_t> push_checkpoint_txns;
+	extern hookfn<vm::eval &> config_hook;
 	extern hookfn<vm::eval &> notify_hook;
+	extern std::unique_ptr<matcher> matching;
+	extern uint64_t compiled;
+	extern std::map<std::string, std::vector<bool>, std::less<>> interest;
+	extern bool recompile;
+	extern ctx::dock push_dock;
+	extern context push_context;
 }
 
+/// All of one kind of namespace regex (users, aliases or rooms) from every
+/// bridge compiled into a single alternation. An input which matches none
+/// of the bridges is rejected by one evaluation of the combined expression;
+/// on a match the winning alternative identifies the first bridge and only
+/// the patterns after it are tested individually.
+struct ircd::m::bridge::automaton
+{
+	std::vector<std::string> source;
+	std::vector<std::regex> each;
+	std::vector<size_t> group;
+	std::vector<size_t> owner;
+	std::unique_ptr<std::regex> combined;
+
+	bool add(const string_view &regex, const size_t &owner);
+	void compile();
+	void match(const string_view &, std::vector<bool> &marks) const;
+};
+
+/// Delivery state for one bridge. The queue holds the event_idx of matched
+/// events awaiting a transaction; cursor is the last event_idx delivered and
+/// is checkpointed with a reserved txn_id in the bridge room.
+struct ircd::m::bridge::pusher
+{
+	std::string id;
+	std::string url;
+	std::string hs_token;
+	m::user::id::buf sender;
+	std::deque<event::idx> queue;
+	event::idx cursor {0};
+	event::idx scanned {0};
+	event::idx horizon {0};
+	uint64_t txn_id {0};
+	uint64_t txn_reserved {0};
+	bool overflow {false};
+	size_t failures {0};
+	steady_point backoff;
+	steady_point saved;
+};
+
+struct ircd::m::bridge::matcher
+{
+	std::vector<std::shared_ptr<pusher>> pushers;
+	automaton users;
+	automaton aliases;
+	automaton rooms;
+};
+
+ircd::mapi::header
+IRCD_MODULE
+{
+	"Bridges (Application Services)", nullptr, []
+	{
+		ircd::m::bridge::push_context.terminate();
+		ircd::m::bridge::push_context.join();
+
+		// Final checkpoint of what was delivered since the last one.
+		if(ircd::m::bridge::matching)
+			for(const auto &p : ircd::m::bridge::matching->pushers)
+				ircd::m::bridge::save(*p, true);
+	}
+};
+
+decltype(ircd::m::bridge::push_enable)
+ircd::m::bridge::push_enable
+{
+	{ "name",     "ircd.m.bridge.push.enable" },
+	{ "default",  true                        },
+};
+
+decltype(ircd::m::bridge::push_txn_max)
+ircd::m::bridge::push_txn_max
+{
+	{ "name",     "ircd.m.bridge.push.txn.max" },
+	{ "default",  100L                         },
+};
+
+decltype(ircd::m::bridge::push_queue_max)
+ircd::m::bridge::push_queue_max
+{
+	{ "name",     "ircd.m.bridge.push.queue.max" },
+	{ "default",  4096L                          },
+};
+
+decltype(ircd::m::bridge::push_replay_max)
+ircd::m::bridge::push_replay_max
+{
+	{ "name",     "ircd.m.bridge.push.replay.max" },
+	{ "default",  1048576L                        },
+};
+
+decltype(ircd::m::bridge::push_timeout)
+ircd::m::bridge::push_timeout
+{
+	{ "name",     "ircd.m.bridge.push.timeout" },
+	{ "default",  30L                          },
+};
+
+decltype(ircd::m::bridge::push_backoff_min)
+ircd::m::bridge::push_backoff_min
+{
+	{ "name",     "ircd.m.bridge.push.backoff.min" },
+	{ "default",  2L                               },
+};
+
+decltype(ircd::m::bridge::push_backoff_max)
+ircd::m::bridge::push_backoff_max
+{
+	{ "name",     "ircd.m.bridge.push.backoff.max" },
+	{ "default",  600L                             },
+};
+
+decltype(ircd::m::bridge::push_checkpoint_interval)
+ircd::m::bridge::push_checkpoint_interval
+{
+	{ "name",         "ircd.m.bridge.push.checkpoint.interval" },
+	{ "default",      30L                                      },
+	{ "description",
+
+	R"(
+	Minimum seconds between checkpoints of a bridge's delivery cursor in the
+	bridge room. Events delivered after the last checkpoint are delivered
+	again after a restart.
+	)"}
+};
+
+decltype(ircd::m::bridge::push_checkpoint_txns)
+ircd::m::bridge::push_checkpoint_txns
+{
+	{ "name",         "ircd.m.bridge.push.checkpoint.txns" },
+	{ "default",      256L                                 },
+	{ "description",
+
+	R"(
+	Number of txn_ids reserved by each checkpoint. A restart resumes after
+	the reservation so no txn_id is reused; a checkpoint is made early when
+	the reservation runs out.
+	)"}
+};
+
+decltype(ircd::m::bridge::matching)
+ircd::m::bridge::matching;
+
+decltype(ircd::m::bridge::compiled)
+ircd::m::bridge::compiled;
+
+decltype(ircd::m::bridge::interest)
+ircd::m::bridge::interest;
+
+decltype(ircd::m::bridge::recompile)
+ircd::m::bridge::recompile
+{
+	true
+};
+
+decltype(ircd::m::bridge::push_dock)
+ircd::m::bridge::push_dock;
+
+decltype(ircd::m::bridge::push_context)
+ircd::m::bridge::push_context
+{
+	"m.bridge", 512_KiB, context::POST, worker
+};
+
+decltype(ircd::m::bridge::config_hook)
+ircd::m::bridge::config_hook
+{
+	handle_config,
+	{
+		{ "_site",  "vm.effect"    },
+		{ "type",   "ircd.bridge"  },
+	}
+};
+
 decltype(ircd::m::bridge::notify_hook)
 ircd::m::bridge::notify_hook
 {
@@ -30,6 +229,22 @@ ircd::m::bridge::notify_hook
 	}
 };
 
+void
+ircd::m::bridge::handle_config(const m::event &event,
+                               vm::eval &eval)
+{
+	const m::room::id::buf bridge_room_id
+	{
+		"bridge", my_host()
+	};
+
+	if(json::get<"room_id"_>(event) != bridge_room_id)
+		return;
+
+	recompile = true;
+	push_dock.notify_all();
+}
+
 void
 ircd::m::bridge::handle_event(const m::event &event,
                               vm::eval &eval)
@@ -43,7 +258,59 @@ try
 	if(!event.event_id)
 		return;
 
+	if(!matching || matching->pushers.empty())
+		return;
+
+	const m::room::id &room_id
+	{
+		at<"room_id"_>(event)
+	};
+
+	// A change of membership may change which bridges have a member here.
+	if(json::get<"type"_>(event) == "m.room.member")
+		interest.erase(room_id);
+
+	// Aliases are only queried when some bridge has an alias namespace; this
+	// and the members of the room can yield so the matcher is dereferenced
+	// afterward.
+	const auto generation
+	{
+		compiled
+	};
 
+	const auto aliases
+	{
+		!matching->aliases.each.empty()?
+			room_aliases(room_id):
+			std::vector<std::string>{}
+	};
+
+	auto marks
+	{
+		room_interest(room_id)
+	};
+
+	if(unlikely(!matching || generation != compiled))
+		return;
+
+	const auto &m(*matching);
+	marks.resize(m.pushers.size());
+	match(m, event, aliases, marks);
+
+	bool queued(false);
+	for(size_t i(0); i < marks.size(); ++i)
+		if(marks[i])
+		{
+			enqueue(*m.pushers[i], eval.sequence);
+			queued = true;
+		}
+
+	if(queued)
+		push_dock.notify_all();
+}
+catch(const ctx::interrupted &)
+{
+	throw;
 }
 catch(const std::exception &e)
 {
@@ -53,3 +320,729 @@ catch(const std::exception &e)
 		e.what(),
 	};
 }
+
+void
+ircd::m::bridge::worker()
+try
+{
+	while(1)
+	{
+		const auto ready{[](const pusher &p)
+		{
+			return (!p.queue.empty() || p.overflow)
+			&& p.backoff <= now<steady_point>();
+		}};
+
+		push_dock.wait_for(seconds(push_backoff_min), [&ready]
+		{
+			if(recompile)
+				return true;
+
+			if(!matching || !push_enable)
+				return false;
+
+			return std::any_of(begin(matching->pushers), end(matching->pushers), [&ready]
+			(const auto &p)
+			{
+				return ready(*p);
+			});
+		});
+
+		if(!vm::ready)
+			continue;
+
+		if(recompile)
+		{
+			recompile = false;
+			compile();
+		}
+
+		if(!matching || !push_enable)
+			continue;
+
+		// Hold references so a recompile during delivery doesn't pull the
+		// state out from under us.
+		const auto pushers
+		{
+			matching->pushers
+		};
+
+		for(const auto &p : pushers)
+		{
+			if(!ready(*p))
+				continue;
+
+			if(p->queue.empty() && p->overflow)
+				replay(*p);
+
+			if(!p->queue.empty())
+				push(*p);
+		}
+	}
+}
+catch(const ctx::interrupted &)
+{
+	log::dwarning
+	{
+		log, "Bridge push worker interrupted."
+	};
+}
+catch(const std::exception &e)
+{
+	log::critical
+	{
+		log, "Bridge push worker :%s",
+		e.what(),
+	};
+}
+
+bool
+ircd::m::bridge::push(pusher &p)
+try
+{
+	assert(!p.queue.empty());
+	const rfc3986::uri base_url
+	{
+		p.url
+	};
+
+	const unique_mutable_buffer buf
+	{
+		std::max(size_t(push_txn_max), 1UL) * event::MAX_SIZE / 4 + 2 * event::MAX_SIZE
+	};
+
+	// Compose the transaction content; events are taken from the front of
+	// the queue in order while there's room for another worst-case event.
+	size_t taken(0);
+	event::idx last(p.cursor);
+	json::stack out{buf};
+	{
+		json::stack::object top{out};
+		json::stack::array events
+		{
+			top, "events"
+		};
+
+		const size_t max(push_txn_max);
+		for(; taken < p.queue.size() && taken < max; ++taken)
+		{
+			if(out.remaining() < event::MAX_SIZE * 3 / 2)
+				break;
+
+			const auto &event_idx
+			{
+				p.queue.at(taken)
+			};
+
+			const m::event::fetch event
+			{
+				std::nothrow, event_idx
+			};
+
+			last = event_idx;
+			if(!event.valid)
+				continue;
+
+			m::event::append::opts opts;
+			opts.event_idx = &event_idx;
+			opts.query_txnid = false;
+			m::event::append
+			{
+				events, event, opts
+			};
+		}
+	}
+
+	const string_view content
+	{
+		out.completed()
+	};
+
+	const unique_mutable_buffer head
+	{
+		16_KiB
+	};
+
+	const string_view uri
+	{
+		fmt::sprintf
+		{
+			head, "%s/_matrix/app/v1/transactions/%lu?access_token=%s",
+			base_url.path,
+			p.txn_id,
+			p.hs_token,
+		}
+	};
+
+	char authbuf[512];
+	const http::header headers[]
+	{
+		{ "Authorization", fmt::sprintf{authbuf, "Bearer %s", p.hs_token} },
+	};
+
+	window_buffer wb
+	{
+		head + size(uri)
+	};
+
+	http::request
+	{
+		wb,
+		base_url.remote,
+		"PUT",
+		uri,
+		size(content),
+		"application/json; charset=utf-8",
+		headers,
+	};
+
+	server::request request
+	{
+		net::hostport  { base_url.remote                },
+		server::out    { wb.completed(),  content       },
+		server::in     { wb.remains(),    wb.remains()  },
+	};
+
+	const auto code
+	{
+		request.get(seconds(push_timeout))
+	};
+
+	log::debug
+	{
+		log, "Bridge '%s' txn:%lu %zu events through idx:%lu :%u %s",
+		p.id,
+		p.txn_id,
+		taken,
+		last,
+		uint(code),
+		http::status(code),
+	};
+
+	p.queue.erase(begin(p.queue), begin(p.queue) + taken);
+	p.cursor = last;
+	p.txn_id += 1;
+	p.failures = 0;
+	p.backoff = {};
+	save(p);
+	return true;
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	// The same txn_id and events are retried after the backoff; the
+	// bridge uses the txn_id to recognize a retransmission.
+	const auto backoff
+	{
+		std::min
+		(
+			seconds(push_backoff_min) * (1L << std::min(p.failures, 16UL)),
+			seconds(push_backoff_max)
+		)
+	};
+
+	++p.failures;
+	p.backoff = now<steady_point>() + backoff;
+	log::derror
+	{
+		log, "Bridge '%s' txn:%lu failed (%zu) retry in %ld seconds :%s",
+		p.id,
+		p.txn_id,
+		p.failures,
+		backoff.count(),
+		e.what(),
+	};
+
+	return false;
+}
+
+/// Checkpoint the cursor of the bridge in the bridge room. This is at most
+/// once per checkpoint interval unless forced or the reserved txn_ids run
+/// out. The txn_id saved is the end of a reservation, so events replayed
+/// from the checkpoint after a restart are sent under new txn_ids.
+void
+ircd::m::bridge::save(pusher &p,
+                      const bool &force)
+try
+{
+	const bool due
+	{
+		force
+		|| p.txn_id >= p.txn_reserved
+		|| p.saved + seconds(push_checkpoint_interval) <= now<steady_point>()
+	};
+
+	if(!due)
+		return;
+
+	const m::room::id::buf bridge_room_id
+	{
+		"bridge", my_host()
+	};
+
+	const uint64_t reserved
+	{
+		p.txn_id + std::max(size_t(push_checkpoint_txns), 1UL)
+	};
+
+	m::send(bridge_room_id, m::me(), "ircd.bridge.cursor", p.id, json::members
+	{
+		{ "event_idx",  long(p.cursor)  },
+		{ "txn_id",     long(reserved)  },
+	});
+
+	p.txn_reserved = reserved;
+	p.saved = now<steady_point>();
+}
+catch(const ctx::interrupted &)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::error
+	{
+		log, "Failed to save cursor for bridge '%s' at idx:%lu :%s",
+		p.id,
+		p.cursor,
+		e.what(),
+	};
+}
+
+/// Refill the queue by scanning the events following what was last queued.
+/// This covers events which were matched while the queue was full as well as
+/// those evaluated while the server was down.
+void
+ircd::m::bridge::replay(pusher &p)
+{
+	assert(p.overflow);
+	const auto horizon
+	{
+		std::max(p.horizon, vm::sequence::retired)
+	};
+
+	if(horizon - p.scanned > size_t(push_replay_max))
+	{
+		log::warning
+		{
+			log, "Bridge '%s' skipping %lu events past the replay limit.",
+			p.id,
+			horizon - p.scanned - size_t(push_replay_max),
+		};
+
+		p.scanned = horizon - size_t(push_replay_max);
+	}
+
+	const size_t max(push_queue_max);
+	const m::events::range range
+	{
+		p.scanned + 1, horizon + 1
+	};
+
+	const m::events::closure each{[&p, &max]
+	(const event::idx &event_idx, const m::event &event)
+	{
+		const m::room::id &room_id
+		{
+			json::get<"room_id"_>(event)
+		};
+
+		if(!room_id || !event.event_id || m::internal(room_id))
+		{
+			p.scanned = event_idx;
+			return true;
+		}
+
+		const auto generation
+		{
+			compiled
+		};
+
+		const auto aliases
+		{
+			matching && !matching->aliases.each.empty()?
+				room_aliases(room_id):
+				std::vector<std::string>{}
+		};
+
+		auto marks
+		{
+			room_interest(room_id)
+		};
+
+		if(!matching || generation != compiled)
+			return false;
+
+		const auto &m(*matching);
+		const auto it
+		{
+			std::find_if(begin(m.pushers), end(m.pushers), [&p]
+			(const auto &pusher)
+			{
+				return pusher.get() == &p;
+			})
+		};
+
+		// This pusher was replaced by a recompile.
+		if(it == end(m.pushers))
+			return false;
+
+		marks.resize(m.pushers.size());
+		match(m, event, aliases, marks);
+		if(marks.at(std::distance(begin(m.pushers), it)))
+			p.queue.emplace_back(event_idx);
+
+		p.scanned = event_idx;
+		return p.queue.size() < max;
+	}};
+
+	const bool completed
+	{
+		m::events::for_each(range, each)
+	};
+
+	// Indexes without an event at the end of the range are passed over too.
+	if(completed)
+		p.scanned = std::max(p.scanned, std::min(horizon, vm::sequence::retired));
+
+	// Resume normal queueing only once the scan has caught up with every
+	// event which could have been dropped in the interim.
+	if(p.scanned >= std::max(p.horizon, horizon) && p.queue.size() < max)
+		p.overflow = false;
+}
+
+void
+ircd::m::bridge::enqueue(pusher &p,
+                         const event::idx &event_idx)
+{
+	p.horizon = std::max(p.horizon, event_idx);
+	if(p.overflow)
+		return;
+
+	if(p.queue.size() >= size_t(push_queue_max))
+	{
+		p.overflow = true;
+		return;
+	}
+
+	p.queue.emplace_back(event_idx);
+	p.scanned = event_idx;
+}
+
+void
+ircd::m::bridge::match(const matcher &m,
+                       const event &event,
+                       const std::vector<std::string> &aliases,
+                       std::vector<bool> &marks)
+{
+	const auto &sender
+	{
+		json::get<"sender"_>(event)
+	};
+
+	const string_view member
+	{
+		json::get<"type"_>(event) == "m.room.member"?
+			string_view{json::get<"state_key"_>(event)}:
+			string_view{}
+	};
+
+	m.users.match(sender, marks);
+	if(member)
+		m.users.match(member, marks);
+
+	m.rooms.match(json::get<"room_id"_>(event), marks);
+	for(const auto &alias : aliases)
+		m.aliases.match(alias, marks);
+
+	// The bridge's own user is always within its namespace.
+	for(size_t i(0); i < m.pushers.size(); ++i)
+		if(m.pushers[i]->sender == sender || (member && m.pushers[i]->sender == member))
+			marks[i] = true;
+}
+
+std::vector<std::string>
+ircd::m::bridge::room_aliases(const room::id &room_id)
+{
+	std::vector<std::string> ret;
+	const m::room::aliases aliases
+	{
+		room_id
+	};
+
+	aliases.for_each([&ret]
+	(const m::room::alias &alias)
+	{
+		ret.emplace_back(alias);
+		return true;
+	});
+
+	return ret;
+}
+
+/// Bridges with a joined member of the room in their user namespace; these
+/// are interested in every event in the room. This is cached per room until
+/// its membership changes or the bridges are recompiled. The result is empty
+/// if the bridges were recompiled while the members were iterated.
+std::vector<bool>
+ircd::m::bridge::room_interest(const room::id &room_id)
+{
+	const auto it
+	{
+		interest.find(room_id)
+	};
+
+	if(it != end(interest))
+		return it->second;
+
+	if(!matching || matching->users.each.empty())
+		return {};
+
+	const auto generation
+	{
+		compiled
+	};
+
+	std::vector<bool> ret(matching->pushers.size());
+	const m::room::members members
+	{
+		room_id
+	};
+
+	members.for_each("join", my_host(), [&ret, &generation]
+	(const id::user &user_id)
+	{
+		if(generation != compiled)
+			return false;
+
+		matching->users.match(user_id, ret);
+		return !std::all_of(begin(ret), end(ret), [](const bool mark)
+		{
+			return mark;
+		});
+	});
+
+	if(generation != compiled)
+		return {};
+
+	interest.emplace(std::string(room_id), ret);
+	return ret;
+}
+
+void
+ircd::m::bridge::compile()
+{
+	const m::room::id::buf bridge_room_id
+	{
+		"bridge", my_host()
+	};
+
+	const m::room::state state
+	{
+		bridge_room_id
+	};
+
+	auto ret
+	{
+		std::make_unique<matcher>()
+	};
+
+	config::for_each([&ret, &state]
+	(const event::idx &event_idx, const config &config)
+	{
+		const auto &id(json::get<"id"_>(config));
+		const auto &url(json::get<"url"_>(config));
+		if(!id || !url)
+			return true;
+
+		const size_t pos(ret->pushers.size());
+		const auto &namespaces(json::get<"namespaces"_>(config));
+		const auto add{[&id, &pos]
+		(automaton &a, const json::array &namespaces)
+		{
+			for(const json::object ns : namespaces)
+				if(!a.add(json::string(ns["regex"]), pos))
+					log::error
+					{
+						log, "Bridge '%s' has an invalid namespace regex :%s",
+						id,
+						json::string(ns["regex"]),
+					};
+		}};
+
+		auto p
+		{
+			std::make_shared<pusher>()
+		};
+
+		p->id = id;
+		p->url = url;
+		p->hs_token = json::get<"hs_token"_>(config);
+		p->sender = m::user::id::buf
+		{
+			json::get<"sender_localpart"_>(config), my_host()
+		};
+
+		const auto cursor_idx
+		{
+			state.get(std::nothrow, "ircd.bridge.cursor", id)
+		};
+
+		m::get(std::nothrow, cursor_idx, "content", [&p]
+		(const json::object &content)
+		{
+			p->cursor = content.get<event::idx>("event_idx", 0UL);
+			p->txn_id = content.get<uint64_t>("txn_id", 0UL);
+		});
+
+		p->txn_reserved = p->txn_id;
+
+		// A bridge without a cursor starts with events from now; otherwise
+		// whatever was missed while down is replayed.
+		p->cursor = p->cursor?: vm::sequence::retired;
+		p->scanned = p->cursor;
+		p->overflow = p->cursor < vm::sequence::retired;
+
+		add(ret->users, json::get<"users"_>(namespaces));
+		add(ret->aliases, json::get<"aliases"_>(namespaces));
+		add(ret->rooms, json::get<"rooms"_>(namespaces));
+		ret->pushers.emplace_back(std::move(p));
+		return true;
+	});
+
+	ret->users.compile();
+	ret->aliases.compile();
+	ret->rooms.compile();
+
+	// Carry over the delivery state of bridges from the prior compilation;
+	// nothing yields from here through the swap so nothing queued is lost.
+	if(matching)
+		for(auto &p : ret->pushers)
+			for(const auto &prev : matching->pushers)
+				if(prev->id == p->id)
+				{
+					p->queue = prev->queue;
+					p->cursor = prev->cursor;
+					p->scanned = prev->scanned;
+					p->horizon = prev->horizon;
+					p->txn_id = prev->txn_id;
+					p->txn_reserved = prev->txn_reserved;
+					p->saved = prev->saved;
+					p->overflow = prev->overflow;
+					p->failures = prev->failures;
+					p->backoff = prev->backoff;
+				}
+
+	log::info
+	{
+		log, "Compiled %zu bridges with %zu user, %zu alias, %zu room namespaces.",
+		ret->pushers.size(),
+		ret->users.each.size(),
+		ret->aliases.each.size(),
+		ret->rooms.each.size(),
+	};
+
+	matching = std::move(ret);
+	interest.clear();
+	++compiled;
+}
+
+//
+// automaton
+//
+
+bool
+ircd::m::bridge::automaton::add(const string_view &regex,
+                                const size_t &owner)
+try
+{
+	static const auto flags
+	{
+		std::regex::ECMAScript | std::regex::optimize
+	};
+
+	each.emplace_back(begin(regex), end(regex), flags);
+	source.emplace_back(regex);
+	this->owner.emplace_back(owner);
+	return true;
+}
+catch(const std::regex_error &e)
+{
+	return false;
+}
+
+void
+ircd::m::bridge::automaton::compile()
+try
+{
+	combined.reset();
+	group.clear();
+	if(each.empty())
+		return;
+
+	// Each pattern is wrapped in a capture group; the group numbering
+	// accounts for any groups within the patterns themselves.
+	std::string alternation;
+	for(size_t i(0), g(1); i < each.size(); ++i)
+	{
+		alternation += i? "|(" : "(";
+		alternation += source.at(i);
+		alternation += ")";
+		group.emplace_back(g);
+		g += 1 + each.at(i).mark_count();
+	}
+
+	combined = std::make_unique<std::regex>
+	(
+		alternation, std::regex::ECMAScript | std::regex::optimize
+	);
+}
+catch(const std::regex_error &e)
+{
+	// Patterns which can't be combined (i.e. with backreferences) are still
+	// matched individually.
+	combined.reset();
+	group.clear();
+	log::warning
+	{
+		log, "Failed to combine %zu namespace regexes :%s",
+		each.size(),
+		e.what(),
+	};
+}
+
+void
+ircd::m::bridge::automaton::match(const string_view &input,
+                                  std::vector<bool> &marks)
+const
+{
+	static const auto flags
+	{
+		std::regex_constants::match_continuous
+	};
+
+	if(each.empty() || !input)
+		return;
+
+	size_t i(0);
+	if(combined)
+	{
+		std::cmatch m;
+		if(!std::regex_search(begin(input), end(input), m, *combined, flags))
+			return;
+
+		while(i < each.size() && !m[group.at(i)].matched)
+			++i;
+
+		if(likely(i < each.size()))
+			marks.at(owner.at(i++)) = true;
+	}
+
+	for(; i < each.size(); ++i)
+		if(!marks.at(owner.at(i)))
+			if(std::regex_search(begin(input), end(input), each.at(i), flags))
+				marks.at(owner.at(i)) = true;
+}
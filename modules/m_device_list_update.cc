@@ -14,6 +14,10 @@ static void
 handle_edu_m_device_list_update(const m::event &,
                                 m::vm::eval &);
 
+static void
+handle_edu_m_signing_key_update(const m::event &,
+                                m::vm::eval &);
+
 mapi::header
 IRCD_MODULE
 {
@@ -30,6 +34,16 @@ _m_device_list_update_eval
 	}
 };
 
+m::hookfn<m::vm::eval &>
+_m_signing_key_update_eval
+{
+	handle_edu_m_signing_key_update,
+	{
+		{ "_site",   "vm.effect"             },
+		{ "type",    "m.signing_key_update"  },
+	}
+};
+
 void
 handle_edu_m_device_list_update(const m::event &event,
                                 m::vm::eval &eval)
@@ -56,6 +70,10 @@ try
 	if(user_id.host() != at<"origin"_>(event))
 		return;
 
+	// Apply to the remote keys cache first; the cache tracks users we've
+	// queried regardless of whether they're known to the devices interface.
+	m::user::devices::cache::update(update);
+
 	const bool updated
 	{
 		m::user::devices::update(update)
@@ -89,3 +107,50 @@ catch(const std::exception &e)
 		e.what(),
 	};
 }
+
+/// The cross-signing keys of a remote user changed; the cached keys of the
+/// user are dropped and the next keys query goes to the origin.
+void
+handle_edu_m_signing_key_update(const m::event &event,
+                                m::vm::eval &eval)
+try
+{
+	if(m::my_host(at<"origin"_>(event)))
+		return;
+
+	const json::object &content
+	{
+		at<"content"_>(event)
+	};
+
+	const m::user::id &user_id
+	{
+		json::string(content["user_id"])
+	};
+
+	if(user_id.host() != at<"origin"_>(event))
+		return;
+
+	if(!m::user::devices::cache::del(user_id))
+		return;
+
+	log::debug
+	{
+		m::log, "Signing key update from :%s for %s; cached keys dropped",
+		json::get<"origin"_>(event),
+		string_view{user_id},
+	};
+}
+catch(const ctx::interrupted &e)
+{
+	throw;
+}
+catch(const std::exception &e)
+{
+	log::derror
+	{
+		m::log, "m.signing_key_update from %s :%s",
+		json::get<"origin"_>(event),
+		e.what(),
+	};
+}
@@ -20,8 +20,7 @@ static void
 handle_m_direct_to_device(m::vm::eval &,
                           const m::direct_to_device &,
                           const m::user::id &user_id,
-                          const string_view &device_id,
-                          const json::object &message);
+                          const json::object &device_messages);
 
 static void
 handle_edu_m_direct_to_device(const m::event &,
@@ -79,8 +78,7 @@ try
 			user_messages.second
 		};
 
-		for(const auto &[device_id, message_body] : device_messages)
-			handle_m_direct_to_device(eval, edu, user_id, device_id, message_body);
+		handle_m_direct_to_device(eval, edu, user_id, device_messages);
 	}
 }
 catch(const std::exception &e)
@@ -93,12 +91,13 @@ catch(const std::exception &e)
 	};
 }
 
+/// All of a user's messages in the EDU are delivered to their user room as
+/// a single event; the sync to_device item selects each device's message.
 static void
 handle_m_direct_to_device(m::vm::eval &eval,
                           const m::direct_to_device &edu,
                           const m::user::id &user_id,
-                          const string_view &device_id,
-                          const json::object &message)
+                          const json::object &device_messages)
 try
 {
 	const m::user::room user_room
@@ -110,27 +109,26 @@ try
 	{
 		{ "sender",    at<"sender"_>(edu) },
 		{ "type",      at<"type"_>(edu)   },
-		{ "device_id", device_id          },
-		{ "content",   message            },
+		{ "messages",  device_messages    },
 	});
 
 	log::info
 	{
-		m::log, "%s sent '%s' to %s device '%s' (%zu bytes)",
+		m::log, "%s sent '%s' to %zu devices of %s (%zu bytes)",
 		at<"sender"_>(edu),
 		at<"type"_>(edu),
+		device_messages.size(),
 		string_view{user_id},
-		device_id,
-		size(string_view{message})
+		size(string_view{device_messages})
 	};
 }
 catch(const std::exception &e)
 {
 	log::derror
 	{
-		m::log, "m.direct_to_device %s to %s device of %s from %s :%s ",
+		m::log, "m.direct_to_device %s to %zu devices of %s from %s :%s ",
 		at<"type"_>(edu),
-		device_id,
+		device_messages.size(),
 		string_view{user_id},
 		at<"sender"_>(edu),
 		e.what()
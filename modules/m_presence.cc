@@ -195,10 +195,7 @@ try
 		return;
 	}
 
-	const auto evid
-	{
-		m::presence::set(object)
-	};
+	m::presence::queue(object);
 
 	log::info
 	{
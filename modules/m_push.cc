@@ -11,9 +11,7 @@
 namespace ircd::m::push
 {
 	static void execute(const event &, vm::eval &, const user::id &, const path &, const rule &, const event::idx &);
-	static bool matching(const event &, vm::eval &, const user::id &, const path &, const rule &);
-	static bool handle_kind(const event &, vm::eval &, const user::id &, const path &);
-	static void handle_rules(const event &, vm::eval &, const user::id &, const string_view &scope);
+	static void handle_user(const event &, vm::eval &, match::cache &, const user::id &);
 	static void handle_event(const m::event &, vm::eval &);
 	extern hookfn<vm::eval &> hook_event;
 }
@@ -56,7 +54,10 @@ try
 		room_id
 	};
 
-	members.for_each("join", my_host(), [&event, &eval]
+	// Shared by every member's evaluation of this event.
+	match::cache cache;
+
+	members.for_each("join", my_host(), [&event, &eval, &cache]
 	(const user::id &user_id, const event::idx &membership_event_idx)
 	{
 		// r0.6.0-13.13.15 Homeservers MUST NOT notify the Push Gateway for
@@ -64,7 +65,7 @@ try
 		if(user_id == at<"sender"_>(event))
 			return true;
 
-		handle_rules(event, eval, user_id, "global");
+		handle_user(event, eval, cache, user_id);
 		return true;
 	});
 }
@@ -83,85 +84,29 @@ catch(const std::exception &e)
 }
 
 void
-ircd::m::push::handle_rules(const event &event,
-                            vm::eval &eval,
-                            const user::id &user_id,
-                            const string_view &scope)
-{
-	const push::path path[]
-	{
-		{ scope, "override",   string_view{}         },
-		{ scope, "content",    string_view{}         },
-		{ scope, "room",       at<"room_id"_>(event) },
-		{ scope, "sender",     at<"sender"_>(event)  },
-		{ scope, "underride",  string_view{}         },
-	};
-
-	for(const auto &p : path)
-		if(!handle_kind(event, eval, user_id, p))
-			break;
-}
-
-bool
-ircd::m::push::handle_kind(const event &event,
+ircd::m::push::handle_user(const event &event,
                            vm::eval &eval,
-                           const user::id &user_id,
-                           const path &path)
-{
-	const user::pushrules pushrules
-	{
-		user_id
-	};
-
-	return pushrules.for_each(path, [&event, &eval, &user_id]
-	(const auto &event_idx, const auto &path, const auto &rule)
-	{
-		if(matching(event, eval, user_id, path, rule))
-		{
-			execute(event, eval, user_id, path, rule, event_idx);
-			return false; // false to break due to match
-		}
-		else return true;
-	});
-}
-
-bool
-ircd::m::push::matching(const event &event,
-                        vm::eval &eval,
-                        const user::id &user_id,
-                        const path &path,
-                        const rule &rule)
+                           match::cache &cache,
+                           const user::id &user_id)
 try
 {
-	const auto &[scope, kind, ruleid]
+	const auto program
 	{
-		path
+		program::get(user_id)
 	};
 
-	if(!json::get<"enabled"_>(rule))
-		return false;
-
-	push::match::opts opts;
+	match::opts opts;
 	opts.user_id = user_id;
-	const push::match match
+	opts.cache = &cache;
+	const auto *const rule
 	{
-		event, rule, opts
+		program->match(event, opts)
 	};
 
-	#if 0
-	log::debug
-	{
-		log, "event %s rule { %s, %s, %s } for %s %s",
-		string_view{event.event_id},
-		scope,
-		kind,
-		ruleid,
-		string_view{user_id},
-		bool(match)? "MATCH"_sv : string_view{}
-	};
-	#endif
+	if(!rule)
+		return;
 
-	return bool(match);
+	execute(event, eval, user_id, rule->path(), rule->get(), rule->idx);
 }
 catch(const ctx::interrupted &)
 {
@@ -169,23 +114,13 @@ catch(const ctx::interrupted &)
 }
 catch(const std::exception &e)
 {
-	const auto &[scope, kind, ruleid]
-	{
-		path
-	};
-
 	log::error
 	{
-		log, "Push rule matching in %s for %s at { %s, %s, %s } :%s",
+		log, "Push rule matching in %s for %s :%s",
 		string_view{event.event_id},
 		string_view{user_id},
-		scope,
-		kind,
-		ruleid,
 		e.what(),
 	};
-
-	return false;
 }
 
 void
@@ -163,11 +163,17 @@ get__download_local(client &client,
 static m::resource::method
 method_get
 {
-	download_resource, "GET", get__download
+	download_resource, "GET", get__download,
+	{
+		method_get.READ_ONLY
+	}
 };
 
 static m::resource::method
 method_get__legacy
 {
-	download_resource__legacy, "GET", get__download
+	download_resource__legacy, "GET", get__download,
+	{
+		method_get__legacy.READ_ONLY
+	}
 };
@@ -269,44 +269,82 @@ try
 	if(exists(room_id))
 		return room_id;
 
+	// A secondary cannot store what it would fetch; the request has to be
+	// routed to the primary.
+	if(ircd::secondary)
+		throw m::error
+		{
+			http::SERVICE_UNAVAILABLE, "M_MEDIA_UNAVAILABLE",
+			"Remote media '%s/%s' is not available on this instance.",
+			mxc.server,
+			mxc.mediaid,
+		};
+
 	if(!remote)
 		remote = mxc.server;
 
+	// The content is not copied into a contiguous buffer when the remote
+	// uses chunked encoding; we consume each chunk in place as it arrives.
+	server::request::opts sopts;
+	sopts.contiguous_content = false;
+
+	// Views of content which has arrived but has not yet been consumed.
+	// In content-length mode the progress callback indicates the amount of
+	// the dynamic buffer which is available; in chunked mode each completed
+	// chunk is queued. These are only updated by the receiving context,
+	// which then wakes the downloading context through the request's dock.
+	std::deque<const_buffer> chunks;
+	size_t received(0);
+	ctx::dock *arrived {nullptr};
+
 	const unique_buffer<mutable_buffer> buf
 	{
 		16_KiB
 	};
 
-	const auto pair
+	mutable_buffer uribuf{buf};
+	fed::request::opts fedopts;
+	fedopts.remote = remote;
+	fedopts.sopts = &sopts;
+	json::get<"method"_>(fedopts.request) = "GET";
+	json::get<"uri"_>(fedopts.request) = fmt::sprintf
 	{
-		download(buf, mxc, remote)
+		uribuf, "/_matrix/media/r0/download/%s/%s",
+		mxc.server,
+		mxc.mediaid,
 	};
+	consume(uribuf, size(json::get<"uri"_>(fedopts.request)));
 
-	const auto &head
+	fedopts.in.progress = [&received, &arrived]
+	(const const_buffer &, const const_buffer &all)
 	{
-		pair.first
+		received = std::max(received, size(all));
+		if(arrived)
+			arrived->notify_all();
 	};
 
-	const const_buffer &content
+	fedopts.in.chunk = [&chunks, &arrived]
+	(const const_buffer &chunk)
 	{
-		pair.second
+		chunks.emplace_back(chunk);
+		if(arrived)
+			arrived->notify_all();
 	};
 
-	char mime_type_buf[64];
-	const auto &content_type
+	fed::request remote_request
 	{
-		magic::mime(mime_type_buf, content)
+		uribuf, std::move(fedopts)
 	};
 
-	if(content_type != head.content_type) log::dwarning
+	// The request's own dock is notified when it completes; arrivals of
+	// content notify it as well so one wait covers both.
+	auto &state
 	{
-		log, "Server %s claims thumbnail %s is '%s' but we think it is '%s'",
-		remote,
-		mxc.mediaid,
-		head.content_type,
-		content_type,
+		ctx::state(remote_request)
 	};
 
+	arrived = &state.cond;
+
 	m::vm::copts vmopts;
 	vmopts.history = false;
 	const m::room room
@@ -314,17 +352,183 @@ try
 		room_id, &vmopts
 	};
 
-	create(room, user_id, "file");
-	const unwind_exceptional purge{[&room]
+	const unwind_exceptional purge{[&room, &room_id]
 	{
-		m::room::purge(room);
+		if(exists(room_id))
+			m::room::purge(room);
 	}};
 
-	const size_t written
+	// Blocks are cut at fixed offsets regardless of how the data arrives;
+	// a partial block is carried here until the next data completes it.
+	const unique_buffer<mutable_buffer> carry
 	{
-		file::write(room, user_id, content, content_type)
+		32_KiB
 	};
 
+	size_t carried(0), consumed(0), wrote(0);
+	char mime_type_buf[64];
+	string_view content_type;
+	const auto write{[&](const_buffer data)
+	{
+		if(!content_type)
+		{
+			const http::response::head head
+			{
+				server::in::gethead(remote_request)
+			};
+
+			if(http::status(head.status) != http::OK)
+				return false;
+
+			content_type = magic::mime(mime_type_buf, data);
+			if(content_type != head.content_type) log::dwarning
+			{
+				log, "Server %s claims thumbnail %s is '%s' but we think it is '%s'",
+				remote,
+				mxc.mediaid,
+				head.content_type,
+				content_type,
+			};
+
+			create(room, user_id, "file");
+		}
+
+		while(!empty(data))
+		{
+			// Aligned data is written as blocks directly from the receive
+			// buffers; otherwise it accumulates in the carry buffer.
+			if(!carried && size(data) >= size(carry))
+			{
+				block::set(room, user_id, const_buffer{data, size(carry)});
+				wrote += size(carry);
+				consume(data, size(carry));
+				continue;
+			}
+
+			const size_t copied
+			{
+				copy(carry + carried, data)
+			};
+
+			carried += copied;
+			consume(data, copied);
+			if(carried < size(carry))
+				continue;
+
+			block::set(room, user_id, const_buffer{carry, carried});
+			wrote += carried;
+			carried = 0;
+		}
+
+		return true;
+	}};
+
+	// Chunks are released from the request once written; the k'th chunk
+	// received is the k'th buffer in the request's chunks vector.
+	size_t released(0);
+	const auto drain{[&]
+	{
+		for(; !chunks.empty(); chunks.pop_front())
+		{
+			if(!write(chunks.front()))
+				return false;
+
+			auto &buffer
+			{
+				remote_request.in.chunks.at(released++)
+			};
+
+			assert(data(buffer) == data(chunks.front()));
+			buffer = {};
+		}
+
+		if(received > consumed && !null(remote_request.in.content))
+		{
+			const const_buffer content
+			{
+				data(remote_request.in.content) + consumed, received - consumed
+			};
+
+			consumed = received;
+			if(!write(content))
+				return false;
+		}
+
+		return true;
+	}};
+
+	const auto timeout
+	{
+		now<system_point>() + seconds(download_timeout)
+	};
+
+	bool ok(true), done(false);
+	while(!done)
+	{
+		// Once the content is rejected only the completion is awaited.
+		state.cond.wait_until(timeout, [&]
+		{
+			return !ctx::is(state, ctx::future_state::PENDING)
+			|| (ok && (!chunks.empty() || received > consumed));
+		});
+
+		done = !ctx::is(state, ctx::future_state::PENDING);
+		if(!done && now<system_point>() > timeout)
+			throw m::error
+			{
+				http::GATEWAY_TIMEOUT, "M_MEDIA_DOWNLOAD_TIMEOUT",
+				"Server '%s' did not respond with media for '%s/%s' in time",
+				remote,
+				mxc.server,
+				mxc.mediaid
+			};
+
+		// Errors are propagated by the future once it is done.
+		if(!done && !ok)
+			continue;
+
+		// The final segment of content-length mode is not reported by the
+		// progress callback; the dynamic buffer is complete at this point.
+		if(done && !null(remote_request.in.content))
+			received = size(remote_request.in.content);
+
+		ok = ok && drain();
+	}
+
+	const auto &code
+	{
+		remote_request.get()
+	};
+
+	if(!ok || code != http::OK || !content_type)
+		throw m::error
+		{
+			http::BAD_GATEWAY, "M_MEDIA_UNAVAILABLE",
+			"Server '%s' did not provide content for '%s/%s'",
+			remote,
+			mxc.server,
+			mxc.mediaid,
+		};
+
+	if(carried)
+	{
+		block::set(room, user_id, const_buffer{carry, carried});
+		wrote += carried;
+		carried = 0;
+	}
+
+	//TODO: TXN
+	send(room, user_id, "ircd.file.stat", "size", json::members
+	{
+		{ "value", long(wrote) }
+	});
+
+	//TODO: TXN
+	send(room, user_id, "ircd.file.stat", "type", json::members
+	{
+		{ "value", content_type }
+	});
+
 	return room;
 }
 catch(const ircd::server::unavailable &e)
@@ -373,7 +577,6 @@ ircd::m::media::file::download(const mutable_buffer &buf_,
 	};
 	consume(buf, size(json::get<"uri"_>(fedopts.request)));
 
-	//TODO: --- This should use the progress callback to build blocks
 	fed::request remote_request
 	{
 		buf, std::move(fedopts)
@@ -687,7 +890,14 @@ bool
 IRCD_MODULE_EXPORT
 ircd::m::media::block::prefetch(const string_view &b58hash)
 {
-	return db::prefetch(blocks, b58hash);
+	// Blocks are prefetched speculatively ahead of the reader; these are
+	// put in the bulk class so they don't delay interactive requests.
+	static const db::gopts opts
+	{
+		db::get::PRIO_LOW
+	};
+
+	return db::prefetch(blocks, b58hash, opts);
 }
 
 //